@@ -6,6 +6,7 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 #include <dlfcn.h>
 #include <sstream>
@@ -32,6 +33,14 @@ namespace comet
                 * glm::scale(identity, scale);
         }
 
+        // Same rotation as getTransform()
+        glm::quat getRotation() const
+        {
+            return glm::angleAxis(rotation.x, glm::vec3(1, 0, 0))
+                * glm::angleAxis(rotation.y, glm::vec3(0, 1, 0))
+                * glm::angleAxis(rotation.z, glm::vec3(0, 0, 1));
+        }
+
         glm::vec3 translation{0.0f};
         glm::vec3 scale{1.0f};
         glm::vec3 rotation{0.0f};
@@ -13,9 +13,9 @@ namespace comet
         
         ~DirectionalLight() {}
 
-        void loadUniforms(Shader* shader) override;
+        LightType getType() const override { return LightType::DIRECTIONAL; }
 
-        void setDirection(const glm::vec3& dir) { m_direction = dir; }
+        void setDirection(const glm::vec3& dir) { m_direction = dir; markChanged(); }
         const glm::vec3& getDirection() const { return m_direction; }
 
     private:
@@ -48,6 +48,14 @@ namespace comet
             return m_scene->m_registry.get<T>(m_entityId);
         }
 
+        // Modifies the component and notifies the observers (the renderer only uploads patched instances)
+        template<typename T, typename... Func>
+        T& patchComponent(Func&&... func)
+        {
+            ASSERT(hasComponent<T>(), "Component is not in this entity");
+            return m_scene->m_registry.patch<T>(m_entityId, std::forward<Func>(func)...);
+        }
+
         inline bool isValid() { return m_scene != nullptr && m_scene->m_registry.valid(m_entityId); }
 
         inline bool operator==(const Entity& other)
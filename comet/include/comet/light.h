@@ -2,9 +2,16 @@
 
 #include <glm/vec3.hpp>
 
+#include <cstdint>
+
 namespace comet
 {
-    class Shader;
+    enum class LightType
+    {
+        DIRECTIONAL = 0,
+        POINT,
+        SPOT
+    };
 
     class Light
     {
@@ -12,21 +19,30 @@ namespace comet
         Light() {}
         virtual ~Light() {}
 
-        virtual void loadUniforms(Shader* shader) = 0;
+        virtual LightType getType() const = 0;
+
+        // Incremented by the setters: the scene lights buffer is uploaded again only when a version changed
+        uint32_t getVersion() const { return m_version; }
 
-        void setAmbient(const glm::vec3& ambient) { m_ambient = ambient; }
+        void setAmbient(const glm::vec3& ambient) { m_ambient = ambient; markChanged(); }
         const glm::vec3& getAmbient() const { return m_ambient; }
 
-        void setDiffuse(const glm::vec3& diffuse) { m_diffuse = diffuse; }
+        void setDiffuse(const glm::vec3& diffuse) { m_diffuse = diffuse; markChanged(); }
         const glm::vec3& getDiffuse() const { return m_diffuse; }
 
-        void setSpecular(const glm::vec3& specular) { m_specular = specular; }
+        void setSpecular(const glm::vec3& specular) { m_specular = specular; markChanged(); }
         const glm::vec3& getSpecular() const { return m_specular; }
 
+    protected:
+        void markChanged() { m_version++; }
+
     protected:
         glm::vec3 m_ambient{0.01f};
         glm::vec3 m_diffuse{0.9f};
         glm::vec3 m_specular{0.5f};
+
+    private:
+        uint32_t m_version{0};
     };
 
 } // namespace comet
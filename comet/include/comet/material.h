@@ -8,7 +8,7 @@ namespace comet
 {
 
     class Shader;
-    class Texture2DArray;
+    class Texture2DArrayPool;
     class MaterialRegistry;
     class VertexBufferLayout;
     
@@ -30,23 +30,29 @@ namespace comet
 
         void setAlbedoTexture(const std::string& filename);
         const std::string& getAlbedoTextureFilename() const { return m_albedoTextureFilename; }
+        // Handle of the albedo texture in the albedo texture pool, -1 without texture
         int32_t getAlbedoTextureIndex() const { return m_albedoTextureIndex; }
+        // (array index << 16) | layer, -1 until the albedo texture is resident: the shaders sample the white texture meanwhile
+        int32_t getAlbedoTextureLocation();
 
-        void setDiffuse(const glm::vec3& diffuse) { m_diffuse = diffuse; }
+        // The parameters are only modified through the setters: a changed material is uploaded again to the GPU material table
+        void setDiffuse(const glm::vec3& diffuse);
         const glm::vec3& getDiffuse() const { return m_diffuse; }
-        glm::vec3& getDiffuse() { return m_diffuse; }
 
-        void setSpecular(const glm::vec3& specular) { m_specular = specular; }
+        void setSpecular(const glm::vec3& specular);
         const glm::vec3& getSpecular() const { return m_specular; }
-        glm::vec3& getSpecular() { return m_specular; }
 
-        void setShininess(float shininess) { m_shininess = shininess; }
+        void setShininess(float shininess);
         float getShininess() const { return m_shininess; }
 
+        // Bind the textures (the parameters of all the material instances are in the GPU material table)
         void loadUniforms();
+        // Drawn this frame: its textures stay resident (see TextureResidencyManager)
+        void markTexturesUsed();
 
     private:
-        Texture2DArray* getAlbedoTextureArray();
+        Texture2DArrayPool* getAlbedoTexturePool();
+        void markDirty();
 
     private:
         static const char* MATERIAL_ALBEDO_TEXTURE_NAME;
@@ -61,7 +67,7 @@ namespace comet
         float m_shininess{1.0f};
         std::string m_albedoTextureFilename;
         int32_t m_albedoTextureIndex{-1};
-
+        bool m_dirty{false};
     };
 
 } // namespace comet
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <comet/singleton.h>
 #include <comet/material.h>
+#include <rendering/vertexBuffer.h>
 
 #include <cstdint>
 #include <vector>
@@ -23,6 +24,7 @@ namespace comet
             uint32_t instanceId = m_materials.size();
             materialInstancePtr->m_instanceID = instanceId;
             m_materials.push_back(std::move(materialInstancePtr));
+            m_materials.back()->markDirty();
             
             return m_materials.back().get();
         }
@@ -51,8 +53,19 @@ namespace comet
             return material;
         }
 
+        // GPU material table: shader storage buffer indexed by the material instance id.
+        // Only the materials modified since the last update are uploaded.
+        static constexpr uint32_t MATERIALS_BINDING = 7;
+
+        void markDirty(uint32_t instanceId) { m_dirtyMaterials.push_back(instanceId); }
+        void updateMaterialTable();
+        void bindMaterialTable() const;
+
     private:
         std::vector<std::unique_ptr<Material>> m_materials;
+        std::vector<uint32_t> m_dirtyMaterials;
+        std::unique_ptr<VertexBuffer> m_materialTable;
+        uint32_t m_albedoResidencyVersion{0};
     };
     
 } // namespace comet
@@ -36,6 +36,12 @@ namespace comet
         {
             return entity.getComponent<T>();
         }
+
+        template<typename T, typename... Func>
+        T& patchComponent(Entity& entity, Func&&... func)
+        {
+            return entity.patchComponent<T>(std::forward<Func>(func)...);
+        }
         
     private:
         PropertiesExposerInterface* m_propertiesExposer{nullptr};
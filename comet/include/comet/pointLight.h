@@ -8,26 +8,27 @@ namespace comet
     {
     public:
         PointLight(const glm::vec3& pos)
-            : Light(), m_position(pos) { m_index = s_pointLightsCount++; }
+            : Light(), m_position(pos) {}
         ~PointLight() {}
 
-        void loadUniforms(Shader* shader) override;
+        LightType getType() const override { return LightType::POINT; }
 
-        void setPosition(const glm::vec3& pos) { m_position = pos; }
+        void setPosition(const glm::vec3& pos) { m_position = pos; markChanged(); }
         const glm::vec3& getPosition() const { return m_position; }
 
-        void setLinearAttenuation(float attenuation) { m_linearAttenuation = attenuation; }
+        void setLinearAttenuation(float attenuation) { m_linearAttenuation = attenuation; markChanged(); }
         float getLinearAttenuation() const { return m_linearAttenuation; }
 
-        void setQuadraticAttenuation(float attenuation) { m_quadraticAttenuation = attenuation; }
+        void setQuadraticAttenuation(float attenuation) { m_quadraticAttenuation = attenuation; markChanged(); }
         float getQuadraticAttenuation() const { return m_quadraticAttenuation; }
 
+        // Distance where the attenuation becomes negligible (used to assign the light to the clusters)
+        float getRange() const;
+
     private:
         glm::vec3 m_position;
         float m_linearAttenuation{0.14};
         float m_quadraticAttenuation{0.07f};
-        uint16_t m_index;
-        static uint16_t s_pointLightsCount;
     };
 
 } // namespace comet
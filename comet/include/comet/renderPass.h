@@ -10,6 +10,8 @@ namespace comet
     {
         std::shared_ptr<Framebuffer> target;
         Framebuffer* inputFramebuffer{nullptr};
+        // Depth-only pass before the shading pass, so that each pixel is shaded once
+        bool depthPrePass{false};
     };
     
     class RenderPass
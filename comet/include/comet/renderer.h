@@ -1,15 +1,26 @@
 #pragma once
 
 #include <glm/mat4x4.hpp>
+#include <entt/entt.hpp>
+#include <rendering/renderQueue.h>
+#include <rendering/lightGrid.h>
+#include <rendering/uniformBuffer.h>
 
+#include <chrono>
 #include <unordered_map>
+#include <vector>
 
 namespace comet
 {
-    class ShaderDrawContext;
+    struct ShaderDrawContext;
+    struct MultiDrawIndirectContext;
+    struct MeshAndInstances;
     class Material;
+    class StaticMesh;
+    class Shader;
     class Light;
     class Scene;
+    class VertexFormat;
 
     class Renderer
     {
@@ -22,6 +33,11 @@ namespace comet
         virtual void prepare() = 0;
         virtual void reloadData() = 0;
         virtual void render() = 0;
+
+        virtual void setDepthPrePass(bool /*enabled*/) {}
+
+        // Once per application frame, before the scenes are rendered: work shared by all the renderers
+        static void beginFrame();
     };
 
     class SceneRenderer : public Renderer
@@ -51,6 +67,10 @@ namespace comet
         void reloadData() override;
         void render() override;
 
+        // Draw the depth only (same indirect commands) before shading the fragments with a GL_EQUAL depth test
+        void setDepthPrePass(bool enabled) override { m_depthPrePass = enabled; }
+        bool isDepthPrePassEnabled() const { return m_depthPrePass; }
+
         void registerPreRenderCallback(PreRenderFunc func, void* userData)
         {
             m_preRenderFunction = func;
@@ -60,15 +80,105 @@ namespace comet
         void setViewMatrix(const glm::mat4& view) { m_view = view; }
         void setProjectionMatrix(const glm::mat4& projection) { m_projection = projection; }
 
+        // Frustum culling of the instances:
+        // - GPU: compute pass writing the indirect commands (NONE runs the same pass without the frustum test)
+        // - CPU: multi-threaded SIMD test, only the visible instances are uploaded (fallback for software renderers)
+        enum class CullingMode
+        {
+            NONE = 0,
+            GPU,
+            CPU
+        };
+
+        void setCullingMode(CullingMode cullingMode);
+        CullingMode getCullingMode() const { return m_cullingMode; }
+
+        // Submission order of the draw contexts (sorted render queue):
+        // - STATE: grouped by shader, then material, to minimize the state changes
+        // - FRONT_TO_BACK: nearest draw contexts first, to reduce the overdraw of opaque geometry
+        enum class DrawOrder
+        {
+            STATE = 0,
+            FRONT_TO_BACK
+        };
+
+        void setDrawOrder(DrawOrder drawOrder) { m_drawOrder = drawOrder; }
+        DrawOrder getDrawOrder() const { return m_drawOrder; }
+
+        // Incremental topology updates, applied to the affected draw contexts on the next reloadData().
+        // The registry signals of Transform, Mesh and Material components already call them.
+        void addEntity(entt::entity entity);
+        void removeEntity(entt::entity entity);
+        void updateEntityMaterial(entt::entity entity);
+
     private:
+        // Stable location of an entity instance data in the instance buffer of its draw context
+        struct InstanceSlot
+        {
+            entt::entity entity{entt::null};
+            MultiDrawIndirectContext* drawContext{nullptr};
+            uint32_t meshIndex{0};
+            uint32_t slot{0};
+        };
+
         void initFromScene();
-        void allocateBuffersAndSetupLayouts();
-        void loadDataToBuffers();
+        void assignInstanceSlots();
+        void applyTopologyChanges();
+        void addInstance(entt::entity entity);
+        void removeInstance(entt::entity entity);
+        void growInstanceBlock(MultiDrawIndirectContext* drawContext, MeshAndInstances& meshAndInstances);
+        void compactInstances(MultiDrawIndirectContext* drawContext);
+        void updateDrawContextBuffers(MultiDrawIndirectContext* drawContext);
+        void setupLayouts(MultiDrawIndirectContext* drawContext);
+        void loadDrawCommands(MultiDrawIndirectContext* drawContext);
+        void updateDirtyInstances();
+        void uploadDirtyInstances();
+        void updateStatistics();
+        void cullInstances();
+        void cullInstancesOnCpu();
+        void uploadVisibleInstances(MultiDrawIndirectContext* drawContext);
+        void updateDrawContextBounds(MultiDrawIndirectContext* drawContext);
+        void buildRenderQueue();
+        void renderDepthPrePass();
+        void uploadFrameData();
+        void drawIndirect(MultiDrawIndirectContext* drawContext, const VertexFormat*& currentFormat);
         void cleanUp();
 
+        // Instance slots are indexed by entity index (dense, no hashing)
+        InstanceSlot* findInstanceSlot(entt::entity entity);
+        void setInstanceSlot(entt::entity entity, MultiDrawIndirectContext* drawContext, uint32_t meshIndex, uint32_t slot);
+
+        Material* getEntityMaterial(entt::entity entity, uint32_t& materialInstanceId);
+        MultiDrawIndirectContext* getDrawContext(Material* material, const StaticMesh& staticMesh);
+        uint32_t getDrawContextMesh(MultiDrawIndirectContext* drawContext, uint32_t staticMeshId, StaticMesh* staticMesh);
+
+        void onRenderableConstructed(entt::registry& /*registry*/, entt::entity entity) { addEntity(entity); }
+        void onRenderableUpdated(entt::registry& /*registry*/, entt::entity entity) { removeEntity(entity); addEntity(entity); }
+        void onRenderableDestroyed(entt::registry& /*registry*/, entt::entity entity) { removeEntity(entity); }
+        void onMaterialChanged(entt::registry& /*registry*/, entt::entity entity) { updateEntityMaterial(entity); }
+
     private:
         std::unordered_map<uint32_t, ShaderDrawContext*> m_shaderDrawContexts;
+        std::vector<InstanceSlot> m_instanceSlots;
+
+        // Change tracking: only the instances of the entities patched since the last frame are uploaded
+        entt::observer m_transformObserver;
+        std::vector<entt::entity> m_addedEntities;
+        std::vector<entt::entity> m_removedEntities;
+        std::vector<entt::entity> m_materialChangedEntities;
+
         Material* m_defaultMaterial{nullptr};
+        Shader* m_cullingShader{nullptr};
+        Shader* m_depthOnlyShader{nullptr};
+        bool m_depthPrePass{false};
+        CullingMode m_cullingMode{CullingMode::GPU};
+        DrawOrder m_drawOrder{DrawOrder::STATE};
+        RenderQueue m_renderQueue;
+        std::unique_ptr<LightGrid> m_lightGrid;
+        std::unique_ptr<UniformBuffer> m_frameDataBuffer;
+        std::chrono::steady_clock::time_point m_startTime{std::chrono::steady_clock::now()};
+        // Compact ids of the shaders, used in the sort keys
+        uint16_t m_shaderSortIdCounter{0};
         Scene* m_scene{nullptr};
 
         PreRenderFunc m_preRenderFunction{nullptr};
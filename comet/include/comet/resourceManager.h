@@ -43,6 +43,8 @@ namespace comet
         ResourceHandler<StaticMesh> createStaticMesh(const char* name, Vertex* vertices, uint32_t vertexCount,
                     const uint32_t* indices, uint32_t indexCount);
         ResourceHandler<StaticMesh> getStaticMesh(uint32_t staticMeshId);
+        // The mesh and its GeometryPool ranges are freed: no entity may reference it anymore
+        void unloadStaticMesh(uint32_t staticMeshId);
 
     private:
         const char* SHADER_SUBFOLDER = "shaders";
@@ -4,6 +4,7 @@
 #include <comet/renderer.h>
 #include <comet/light.h>
 #include <comet/renderPass.h>
+#include <rendering/lightBuffer.h>
 
 #include <entt/entt.hpp>
 
@@ -20,6 +21,20 @@ namespace comet
         uint32_t indicesCount{0};
         uint32_t drawCalls{0};
         uint32_t drawCommandsCount{0};
+        uint32_t updatedInstancesCount{0};
+        // CPU culling only (the GPU culling results are not read back)
+        uint32_t visibleInstancesCount{0};
+        uint32_t culledInstancesCount{0};
+        float cullingNsPerInstance{0.0f};
+        // Graphic API state changes issued / skipped because redundant
+        uint32_t issuedStateCalls{0};
+        uint32_t skippedStateCalls{0};
+        // GPU texture memory (TextureResidencyManager)
+        uint32_t residentTexturesCount{0};
+        uint32_t reducedTexturesCount{0};
+        uint32_t evictedTexturesCount{0};
+        size_t textureResidentBytes{0};
+        size_t textureBudgetBytes{0};
 
         SceneStats& clear()
         {
@@ -29,6 +44,17 @@ namespace comet
             indicesCount = 0;
             drawCalls = 0;
             drawCommandsCount = 0;
+            updatedInstancesCount = 0;
+            visibleInstancesCount = 0;
+            culledInstancesCount = 0;
+            cullingNsPerInstance = 0.0f;
+            issuedStateCalls = 0;
+            skippedStateCalls = 0;
+            residentTexturesCount = 0;
+            reducedTexturesCount = 0;
+            evictedTexturesCount = 0;
+            textureResidentBytes = 0;
+            textureBudgetBytes = 0;
 
             return *this;
         }
@@ -59,6 +85,10 @@ namespace comet
         void addLight(std::unique_ptr<Light>&& light);
         const std::vector<std::unique_ptr<Light>>& getLights() { return m_lights; }
 
+        // Packs and uploads the lights if one of them changed since the last call
+        void updateLightBuffer() { m_lightBuffer.update(m_lights, m_lightsVersion); }
+        const LightBuffer& getLightBuffer() const { return m_lightBuffer; }
+
         uint32_t addRenderPass(const RenderPassSpec& renderPassSpec, std::unique_ptr<Renderer>&& renderer);
         void removeRenderPass(size_t index);
         void removeAllRenderPasses();
@@ -110,6 +140,9 @@ namespace comet
         bool m_runtime;
         // TODO(jcp): Move lights management to Environment
         std::vector<std::unique_ptr<Light>> m_lights{};
+        // Incremented when a light is added
+        uint32_t m_lightsVersion{0};
+        LightBuffer m_lightBuffer;
         std::vector<std::unique_ptr<RenderPass>> m_renderPasses{};
     };
     
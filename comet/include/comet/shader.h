@@ -13,6 +13,25 @@
 
 namespace comet
 {
+    // Handle of a uniform (or uniform / storage block), hashed from its name at compile time:
+    //     static constexpr UniformId FRUSTUM_PLANES{"frustum_planes"};
+    struct UniformId
+    {
+#ifndef NDEBUG
+        constexpr explicit UniformId(const char* name) : hash(utils::hashStr(name)), name(name) {}
+#else
+        constexpr explicit UniformId(const char* name) : hash(utils::hashStr(name)) {}
+#endif
+
+        bool operator==(const UniformId& other) const { return hash == other.hash; }
+
+        uint32_t hash;
+#ifndef NDEBUG
+        // Only valid during the call taking the UniformId when it is built from a std::string
+        const char* name;
+#endif
+    };
+
     class Shader
     {
     public:
@@ -21,7 +40,8 @@ namespace comet
             NONE = 0,
             VERTEX,
             FRAGMENT,
-            GEOMETRY
+            GEOMETRY,
+            COMPUTE
         };
 
         Shader(const std::string& name) : m_name(name) {};
@@ -46,6 +66,10 @@ namespace comet
             {
                 return Type::GEOMETRY;
             }
+            else if (suffix == "cs")
+            {
+                return Type::COMPUTE;
+            }
 
             return Type::NONE;
         }
@@ -57,22 +81,35 @@ namespace comet
         virtual void validateProgram() = 0;
 
         // Uniform methods
+        // The active uniforms and blocks are reflected when the program is linked,
+        // the locations are then looked up by UniformId without any allocation.
+        // Returns -1 if the uniform is not active in the program
+        virtual int getUniformLocation(UniformId id) = 0;
+        // Binding point of a uniform or shader storage block, -1 if the block is not active in the program
+        virtual int getBlockBinding(UniformId id) const = 0;
+
         // scalars
-        virtual int getUniformLocation(const std::string& name) = 0;
-        virtual void setUniform(const std::string& name, int value) = 0;
-        virtual void setUniform(const std::string& name, uint32_t value) = 0;
-        virtual void setUniform(const std::string& name, float value) = 0;
-        virtual void setUniform(const std::string& name, const glm::vec2& value) = 0;
-        virtual void setUniform(const std::string& name, const glm::vec3& value) = 0;
-        virtual void setUniform(const std::string& name, const glm::vec4& value) = 0;
-        virtual void setUniform(const std::string& name, const glm::mat4& value) = 0;
+        virtual void setUniform(UniformId id, int value) = 0;
+        virtual void setUniform(UniformId id, uint32_t value) = 0;
+        virtual void setUniform(UniformId id, float value) = 0;
+        virtual void setUniform(UniformId id, const glm::vec2& value) = 0;
+        virtual void setUniform(UniformId id, const glm::vec3& value) = 0;
+        virtual void setUniform(UniformId id, const glm::vec4& value) = 0;
+        virtual void setUniform(UniformId id, const glm::mat4& value) = 0;
 
         // arrays
-        virtual void setUniform(const std::string& name, uint32_t count, const int* values) = 0;
-        virtual void setUniform(const std::string& name, uint32_t count, const uint32_t* values) = 0;
-        virtual void setUniform(const std::string& name, uint32_t count, const float* values) = 0;
-        virtual void setUniform(const std::string& name, uint32_t count, const glm::vec3* values) = 0;
-        virtual void setUniform(const std::string& name, uint32_t count, const glm::vec4* values) = 0;
+        virtual void setUniform(UniformId id, uint32_t count, const int* values) = 0;
+        virtual void setUniform(UniformId id, uint32_t count, const uint32_t* values) = 0;
+        virtual void setUniform(UniformId id, uint32_t count, const float* values) = 0;
+        virtual void setUniform(UniformId id, uint32_t count, const glm::vec3* values) = 0;
+        virtual void setUniform(UniformId id, uint32_t count, const glm::vec4* values) = 0;
+
+        // Names hashed at runtime (prefer UniformId constants in the per-frame code)
+        int getUniformLocation(const std::string& name) { return getUniformLocation(UniformId(name.c_str())); }
+        template<typename T>
+        void setUniform(const std::string& name, const T& value) { setUniform(UniformId(name.c_str()), value); }
+        template<typename T>
+        void setUniform(const std::string& name, uint32_t count, const T* values) { setUniform(UniformId(name.c_str()), count, values); }
 
         virtual void bind() const = 0;
         virtual void unbind() const = 0;
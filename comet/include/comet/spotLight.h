@@ -10,30 +10,33 @@ namespace comet
     {
     public:
         SpotLight(const glm::vec3& pos)
-            : Light(), m_position(pos) { m_index = s_spotLightsCount++; }
+            : Light(), m_position(pos) {}
         ~SpotLight() {}
 
-        void loadUniforms(Shader* shader) override;
+        LightType getType() const override { return LightType::SPOT; }
 
-        void setPosition(const glm::vec3& pos) { m_position = pos; }
+        void setPosition(const glm::vec3& pos) { m_position = pos; markChanged(); }
         const glm::vec3& getPosition() const { return m_position; }
 
-        void setDirection(const glm::vec3& dir) { m_direction = dir; }
+        void setDirection(const glm::vec3& dir) { m_direction = dir; markChanged(); }
         const glm::vec3& getDirection() const { return m_direction; }
 
-        void setCutoffAngle(float cutoffAngle) { m_cutoffAngle = cutoffAngle; }
+        void setCutoffAngle(float cutoffAngle) { m_cutoffAngle = cutoffAngle; markChanged(); }
         float getCutoffAngle() const { return m_cutoffAngle; }
 
-        void setOuterCutoffAngle(float cutoffAngle) { m_outerCutoffAngle = cutoffAngle; }
+        void setOuterCutoffAngle(float cutoffAngle) { m_outerCutoffAngle = cutoffAngle; markChanged(); }
         float getOuterCutoffAngle() const { return m_outerCutoffAngle; }
 
+        // The light fades out smoothly up to this distance
+        void setRange(float range) { m_range = range; markChanged(); }
+        float getRange() const { return m_range; }
+
     private:
         glm::vec3 m_position;
         glm::vec3 m_direction{0.0f, -1.0f, 0.0f};
         float m_cutoffAngle{glm::radians(30.0f)};
         float m_outerCutoffAngle{glm::radians(45.0f)};
-        uint16_t m_index;
-        static uint16_t s_spotLightsCount;
+        float m_range{50.0f};
     };
 
 } // namespace comet
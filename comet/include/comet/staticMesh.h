@@ -2,6 +2,7 @@
 
 #include <comet/vertex.h>
 #include <rendering/vertexBufferLayout.h>
+#include <rendering/indexBuffer.h>
 
 #include <vector>
 #include <memory>
@@ -27,18 +28,34 @@ namespace comet
         size_t getVerticesSize() const { return m_vertexCount * sizeof(Vertex); }
 
         bool hasIndices() const { return m_indexCount != 0; }
+        // The indices are stored on 16 bits when they all fit
         void setIndices(const uint32_t* indices, uint32_t indexCount);
-        const std::vector<uint32_t>& getIndices() const { return m_indices; }
-        std::vector<uint32_t>& getIndices() { return m_indices; }
+        IndexType getIndexType() const { return m_indexType; }
+        const void* getIndexData() const;
         uint32_t getIndexCount() const { return m_indexCount; }
-        size_t getIndicesSize() const { return m_indexCount * sizeof(uint32_t); }
+        size_t getIndicesSize() const { return m_indexCount * getIndexSize(m_indexType); }
+
+        // Bounds in model space, computed when the vertices are set (used for culling)
+        const glm::vec3& getAabbMin() const { return m_aabbMin; }
+        const glm::vec3& getAabbMax() const { return m_aabbMax; }
+        const glm::vec3& getBoundingSphereCenter() const { return m_boundingSphereCenter; }
+        float getBoundingSphereRadius() const { return m_boundingSphereRadius; }
+
+    private:
+        void computeBounds();
 
     private:
         std::string m_name;
         uint32_t m_indexCount{0};
         uint32_t m_vertexCount{0};
-        std::vector<uint32_t> m_indices{};
+        IndexType m_indexType{IndexType::UINT32};
+        std::vector<uint16_t> m_indices16{};
+        std::vector<uint32_t> m_indices32{};
         std::vector<Vertex> m_vertices{};
+        glm::vec3 m_aabbMin{0.0f};
+        glm::vec3 m_aabbMax{0.0f};
+        glm::vec3 m_boundingSphereCenter{0.0f};
+        float m_boundingSphereRadius{0.0f};
     };
 
 } // namespace comet
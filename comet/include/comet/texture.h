@@ -6,6 +6,44 @@
 namespace comet
 {
 
+	// Block compressed formats are stored in blocks of 4x4 pixels: BC1 (RGB + 1 bit alpha) in 8 bytes,
+	// BC3 (RGBA), BC5 (two channels, normal maps) and BC7 (RGBA, higher quality) in 16 bytes
+	enum class TextureFormat : uint8_t
+	{
+		RGBA8,
+		BC1,
+		BC3,
+		BC5,
+		BC7
+	};
+
+	enum class TextureFilter : uint8_t
+	{
+		NEAREST,
+		LINEAR
+	};
+
+	enum class TextureWrap : uint8_t
+	{
+		REPEAT,
+		MIRRORED_REPEAT,
+		CLAMP_TO_EDGE
+	};
+
+	// How a texture is sampled. With mipmaps, the full mip chain is allocated and generated when
+	// the texture is loaded: minified textures read the level matching their footprint.
+	struct SamplerDescription
+	{
+		TextureFilter minFilter{TextureFilter::LINEAR};
+		TextureFilter magFilter{TextureFilter::NEAREST};
+		// Filter between two mip levels: LINEAR with LINEAR minFilter is trilinear filtering
+		TextureFilter mipmapFilter{TextureFilter::LINEAR};
+		TextureWrap wrap{TextureWrap::REPEAT};
+		// 1 disables the anisotropic filtering, clamped to the maximum supported by the device
+		float maxAnisotropy{1.0f};
+		bool mipmaps{true};
+	};
+
 	class Texture
 	{
 	public:
@@ -16,9 +54,17 @@ namespace comet
 		Texture& operator=(const Texture& other) = delete;
 
 		virtual void cleanUp() = 0;
+		// Textures loaded from files are decoded and uploaded asynchronously: load() returns right away
 		virtual void load() = 0;
 		virtual void bind(uint32_t textureSlot = 0) const = 0;
 		virtual void unbind() const = 0;
+
+		// Changing the mipmaps of a loaded texture loads it again
+		virtual void setSamplerDescription(const SamplerDescription& samplerDescription) = 0;
+		virtual const SamplerDescription& getSamplerDescription() const = 0;
+
+		// Number of levels in the mip chain of a 'width' x 'height' image
+		static uint32_t getMipLevelCount(uint32_t width, uint32_t height);
 	};
 
     class Texture2D : public Texture
@@ -32,6 +78,10 @@ namespace comet
 
 		virtual void makeItWhite() = 0;
 
+		// Until then, bind() binds the white 1x1 texture and the size is 0
+		virtual bool isResident() const = 0;
+		virtual TextureFormat getFormat() const = 0;
+
         virtual uint32_t getWidth() const = 0;
         virtual uint32_t getHeight() const = 0;
 	};
@@ -48,8 +98,49 @@ namespace comet
 		virtual uint32_t getTextureCount() const = 0;
 		virtual bool needToLoadTextureArray() const = 0;
 
+		// Layers are streamed independently, the version changes each time a layer becomes resident
+		virtual bool isLayerResident(uint32_t index) const = 0;
+		virtual uint32_t getResidencyVersion() const = 0;
+		// Defined by the first layer streamed, all the layers share it
+		virtual TextureFormat getFormat() const = 0;
+
         virtual uint32_t getWidth() const = 0;
         virtual uint32_t getHeight() const = 0;
 	};
 
+    // Texture arrays grouped by (width, height, format, levels): the textures of different sizes can be mixed.
+    // A texture is located by its array (bound to firstTextureSlot + arrayIndex) and its layer in that array.
+    class Texture2DArrayPool
+	{
+	public:
+		// Must match ALBEDO_TEXTURE_ARRAYS in the shaders
+		static constexpr uint32_t MAX_ARRAY_COUNT = 8;
+
+		Texture2DArrayPool() = default;
+		virtual ~Texture2DArrayPool() = default;
+
+		Texture2DArrayPool(const Texture2DArrayPool&) = delete;
+		Texture2DArrayPool& operator=(const Texture2DArrayPool&) = delete;
+
+		static std::unique_ptr<Texture2DArrayPool> create();
+
+		// Returns the handle of the texture, the same file gives the same handle.
+		// The handles are reference counted: each addTexture2D() is paired with a releaseTexture2D().
+		virtual uint32_t addTexture2D(const char* filename) = 0;
+		// The layer of the texture is reused once it is not referenced anymore
+		virtual void releaseTexture2D(uint32_t handle) = 0;
+		// Sampled by this frame: the array of the texture stays resident, or is streamed back
+		virtual void markUsed(uint32_t handle) = 0;
+		// False until the texture is resident
+		virtual bool getTextureLocation(uint32_t handle, uint32_t& arrayIndex, uint32_t& layer) const = 0;
+		virtual uint32_t getArrayCount() const = 0;
+		// Changes each time a texture becomes resident or the locations are reset
+		virtual uint32_t getResidencyVersion() const = 0;
+
+		virtual void setSamplerDescription(const SamplerDescription& samplerDescription) = 0;
+		virtual const SamplerDescription& getSamplerDescription() const = 0;
+
+		virtual void bind(uint32_t firstTextureSlot) const = 0;
+	};
+
 } // namespace comet
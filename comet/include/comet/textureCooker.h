@@ -0,0 +1,22 @@
+#pragma once
+
+#include <comet/texture.h>
+
+#include <string>
+
+namespace comet
+{
+
+    // Asset pipeline step: converts a source image (PNG...) to a block compressed DDS file with its full mip chain,
+    // written next to the source. Once cooked, the textures stream the DDS file instead of decoding the source,
+    // as long as it is not older than the source.
+    class TextureCooker
+    {
+    public:
+        // 'filename' is in the texture resources. BC1 for opaque textures, BC3 with alpha.
+        static bool cook(const std::string& filename, TextureFormat format = TextureFormat::BC1);
+
+        static std::string getCookedFilepath(const std::string& sourceFilepath);
+    };
+
+} // namespace comet
@@ -3,21 +3,29 @@
 #include <comet/singleton.h>
 #include <comet/texture.h>
 
+#include <memory>
 #include <unordered_map>
 #include <string>
 
 namespace comet
 {
+    // Shared by its users, the texture is deleted with the last handle
+    using Texture2DHandle = std::shared_ptr<Texture2D>;
+
     class TextureRegistry : public Singleton<TextureRegistry>
     {
     public:
-        Texture2D* getTexture2D(const std::string& filepath);
+        TextureRegistry();
+
+        Texture2DHandle getTexture2D(const std::string& filepath);
         Texture2D* getWhiteTexture2D();
         Texture2DArray* getTexture2DArray(const std::string& uniqueName);
+        Texture2DArrayPool* getTexture2DArrayPool(const std::string& uniqueName);
 
     private:
-        std::unordered_map<std::string, std::unique_ptr<Texture2D>> m_texture2DRegistry;
+        std::unordered_map<std::string, std::weak_ptr<Texture2D>> m_texture2DRegistry;
         std::unordered_map<std::string, std::unique_ptr<Texture2DArray>> m_texture2DArrayRegistry;
+        std::unordered_map<std::string, std::unique_ptr<Texture2DArrayPool>> m_texture2DArrayPoolRegistry;
         std::unique_ptr<Texture2D> m_generatedWhiteTexture2d{nullptr};
     };
 
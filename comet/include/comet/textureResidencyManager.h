@@ -0,0 +1,81 @@
+#pragma once
+
+#include <comet/singleton.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+namespace comet
+{
+
+    // GPU memory of a texture (or of a texture array) managed by the TextureResidencyManager
+    class ResidentTexture
+    {
+    public:
+        virtual ~ResidentTexture() = default;
+
+        // Bytes of the levels allocated on the GPU
+        virtual size_t getResidentSize() const = 0;
+        virtual bool isEvicted() const = 0;
+        // Top levels not allocated anymore (the texture samples its smaller levels)
+        virtual uint32_t getDroppedLevelCount() const = 0;
+
+        // Both refused (false) while the texture is streaming
+        virtual bool dropTopLevel(uint32_t minTopLevelSize) = 0;
+        virtual bool evict() = 0;
+        // Streams back the dropped levels, or the whole texture once evicted
+        virtual void restore() = 0;
+    };
+
+    struct TextureResidencyStats
+    {
+        size_t budget{0};
+        size_t residentBytes{0};
+        uint32_t residentTexturesCount{0};
+        // Resident with their top levels dropped
+        uint32_t reducedTexturesCount{0};
+        uint32_t evictedTexturesCount{0};
+    };
+
+    // Keeps the GPU memory of the textures under a budget.
+    // The textures not used during the last frame are reduced first (largest levels dropped, least recently used first),
+    // then evicted. A texture used again is streamed back.
+    class TextureResidencyManager : public Singleton<TextureResidencyManager>
+    {
+    public:
+        static constexpr size_t DEFAULT_BUDGET = size_t{1024} * 1024 * 1024;
+        // Textures are not reduced below this size, they are evicted instead
+        static constexpr uint32_t MIN_TOP_LEVEL_SIZE = 64;
+
+        void setBudget(size_t budget) { m_budget = budget; }
+        size_t getBudget() const { return m_budget; }
+
+        void registerTexture(ResidentTexture* texture);
+        void unregisterTexture(const ResidentTexture* texture);
+        // When the texture is bound, or when a material sampling it is drawn
+        void markUsed(const ResidentTexture* texture);
+
+        // Once per frame, on the render thread, before the texture streaming
+        void update();
+
+        const TextureResidencyStats& getStatistics() const { return m_statistics; }
+
+    private:
+        struct Entry
+        {
+            ResidentTexture* texture{nullptr};
+            uint64_t lastUsedFrame{0};
+        };
+
+        void enforceBudget(size_t residentBytes);
+
+    private:
+        std::unordered_map<const ResidentTexture*, Entry> m_textures;
+        size_t m_budget{DEFAULT_BUDGET};
+        uint64_t m_frame{0};
+        bool m_overBudgetReported{false};
+        TextureResidencyStats m_statistics;
+    };
+
+} // namespace comet
@@ -0,0 +1,6 @@
+#version 430 core
+
+// Depth pre-pass: only the depth buffer is written
+void main()
+{
+}
@@ -0,0 +1,35 @@
+#version 430 core
+
+// Vertex attributes
+layout (location = 0) in vec3 position;
+
+// Instance attributes: model = translation * rotation * scale
+layout (location = 10) in vec4 instance_rotation;
+layout (location = 11) in vec3 instance_translation;
+layout (location = 12) in vec3 instance_scale;
+
+// Per-frame data (SceneRenderer FrameData)
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 view_matrix;
+    mat4 projection_matrix;
+    mat4 view_projection_matrix;
+    mat4 inverse_view_matrix;
+    vec4 camera_position;
+    vec2 viewport_size;
+    float time;
+};
+
+// Same computation as the shading pass (tested with GL_EQUAL)
+invariant gl_Position;
+
+vec3 rotateByQuaternion(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void main()
+{
+    vec4 world_position = vec4(instance_translation + rotateByQuaternion(instance_rotation, instance_scale * position), 1.0);
+    gl_Position = view_projection_matrix * world_position;
+}
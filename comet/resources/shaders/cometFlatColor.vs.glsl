@@ -1,17 +1,51 @@
 #version 430 core
 
 layout (location = 0) in vec3 position;
-layout (location = 10) in mat4 instance_model_matrix;
+layout (location = 10) in vec4 instance_rotation;
+layout (location = 11) in vec3 instance_translation;
+layout (location = 12) in vec3 instance_scale;
 layout (location = 14) in uint instance_materialID;
 
 out vec4 pass_color;
 
-uniform mat4 vp_matrix;
+// Must match the depth pre-pass (cometDepthOnly) exactly
+invariant gl_Position;
 
-uniform vec4 u_flatColor[32];
+// Per-frame data (SceneRenderer FrameData)
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 view_matrix;
+    mat4 projection_matrix;
+    mat4 view_projection_matrix;
+    mat4 inverse_view_matrix;
+    vec4 camera_position;
+    vec2 viewport_size;
+    float time;
+};
+
+// Material instance (MaterialRegistry material table)
+struct MaterialInstance
+{
+    vec3 diffuse;
+    float shininess;
+    vec3 specular;
+    int albedo_texture_location;
+};
+
+// Materials, indexed by material instance id
+layout (std430, binding = 7) readonly buffer Materials
+{
+    MaterialInstance material_instances[];
+};
+
+vec3 rotateByQuaternion(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
 
 void main()
 {
-    pass_color = u_flatColor[instance_materialID];
-    gl_Position = vp_matrix * instance_model_matrix * vec4(position, 1.0);
+    pass_color = vec4(material_instances[instance_materialID].diffuse, 1.0);
+    vec3 world_position = instance_translation + rotateByQuaternion(instance_rotation, instance_scale * position);
+    gl_Position = view_projection_matrix * vec4(world_position, 1.0);
 }
\ No newline at end of file
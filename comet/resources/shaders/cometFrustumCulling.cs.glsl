@@ -0,0 +1,134 @@
+#version 430 core
+
+#define WORKGROUP_SIZE 64
+// MeshInstanceData: vec4 rotation (quaternion), vec3 translation, uint material instance id, vec3 scale (tightly packed)
+#define INSTANCE_STRIDE 11
+// Command index of the instance slots not used by any mesh
+#define NO_COMMAND 0xFFFFFFFFu
+
+layout (local_size_x = WORKGROUP_SIZE) in;
+
+struct MeshCullingData
+{
+    vec4 boundingSphere; // xyz: center (model space), w: radius
+    vec3 positionOffset; // Dequantization of the vertex positions
+    uint baseInstance;
+    vec3 positionScale;
+    uint padding;
+};
+
+// Instances written by the CPU this frame
+// Read as uints: the material id must be copied bit for bit (small uints are float denormals)
+layout (std430, binding = 0) readonly buffer InstancesIn
+{
+    uint instances_in[];
+};
+
+// Visible instances, compacted per mesh (the buffer used by the draw calls)
+layout (std430, binding = 1) writeonly buffer InstancesOut
+{
+    uint instances_out[];
+};
+
+layout (std430, binding = 2) readonly buffer Meshes
+{
+    MeshCullingData meshes[];
+};
+
+// Draw(Elements|Arrays)IndirectCommand: instanceCount is the 2nd field, baseInstance the last one
+layout (std430, binding = 3) buffer Commands
+{
+    uint commands[];
+};
+
+// Command index of each instance slot
+layout (std430, binding = 4) readonly buffer SlotCommands
+{
+    uint slot_commands[];
+};
+
+uniform vec4 frustum_planes[6];
+uniform uint command_count;
+uniform uint slot_count;
+uniform uint command_stride;
+uniform bool reset_commands;
+uniform bool culling_enabled;
+
+vec3 rotateByQuaternion(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+bool isSphereVisible(vec3 center, float radius)
+{
+    for (int i = 0; i < 6; ++i)
+    {
+        if (dot(frustum_planes[i].xyz, center) + frustum_planes[i].w < -radius)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void main()
+{
+    // First pass: one invocation per draw command
+    if (reset_commands)
+    {
+        uint commandIndex = gl_GlobalInvocationID.x;
+        if (commandIndex < command_count)
+        {
+            commands[commandIndex * command_stride + 1] = 0;
+            commands[commandIndex * command_stride + command_stride - 1] = meshes[commandIndex].baseInstance;
+        }
+        return;
+    }
+
+    // Second pass: one invocation per instance slot
+    uint slot = gl_GlobalInvocationID.x;
+    if (slot >= slot_count)
+    {
+        return;
+    }
+
+    uint commandIndex = slot_commands[slot];
+    if (commandIndex == NO_COMMAND)
+    {
+        return;
+    }
+
+    MeshCullingData mesh = meshes[commandIndex];
+    uint src = slot * INSTANCE_STRIDE;
+    vec4 rotation = uintBitsToFloat(uvec4(instances_in[src + 0], instances_in[src + 1], instances_in[src + 2], instances_in[src + 3]));
+    vec3 translation = uintBitsToFloat(uvec3(instances_in[src + 4], instances_in[src + 5], instances_in[src + 6]));
+    vec3 scale = uintBitsToFloat(uvec3(instances_in[src + 8], instances_in[src + 9], instances_in[src + 10]));
+
+    if (culling_enabled)
+    {
+        vec3 center = translation + rotateByQuaternion(rotation, scale * mesh.boundingSphere.xyz);
+        vec3 absScale = abs(scale);
+        if (!isSphereVisible(center, mesh.boundingSphere.w * max(absScale.x, max(absScale.y, absScale.z))))
+        {
+            return;
+        }
+    }
+
+    // The vertex shaders read quantized positions: the dequantization is applied to the drawn transform
+    translation += rotateByQuaternion(rotation, scale * mesh.positionOffset);
+    scale *= mesh.positionScale;
+
+    uint visibleIndex = atomicAdd(commands[commandIndex * command_stride + 1], 1);
+    uint dst = (mesh.baseInstance + visibleIndex) * INSTANCE_STRIDE;
+    for (uint i = 0; i < 4; ++i)
+    {
+        instances_out[dst + i] = floatBitsToUint(rotation[i]);
+    }
+    for (uint i = 0; i < 3; ++i)
+    {
+        instances_out[dst + 4 + i] = floatBitsToUint(translation[i]);
+        instances_out[dst + 8 + i] = floatBitsToUint(scale[i]);
+    }
+    instances_out[dst + 7] = instances_in[src + 7];
+}
@@ -1,86 +1,125 @@
 #version 430 core
 
-#define MAX_MATERIAL_INSTANCES 32
-#define MAX_POINT_LIGHTS 4
-#define MAX_SPOT_LIGHTS 4
+// Light grid dimensions, must be the same values as in LightGrid
+#define LIGHT_GRID_TILES_X 16
+#define LIGHT_GRID_TILES_Y 9
+#define LIGHT_GRID_SLICES 24
+
+// Albedo texture arrays, must be the same value as Texture2DArrayPool::MAX_ARRAY_COUNT
+#define ALBEDO_TEXTURE_ARRAYS 8
 
 in VS_OUT
 {
     vec2 tex_coord;
     vec3 normal;
+    vec3 world_position;
     vec3 to_camera;
-    vec3 to_point_lights[MAX_POINT_LIGHTS];
-    vec3 to_spot_lights[MAX_SPOT_LIGHTS];
-    float distances_to_point_lights[MAX_POINT_LIGHTS];
+    float view_depth;
     flat uint instance_materialID;
 } fs_in;
 
+// Directional light (DirectionalLightData)
 struct DirectionalLight
 {
-    vec3 direction;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
+    vec4 direction;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
 };
 
-struct PointLight
+// Point / Spot light (LightData)
+struct Light
 {
-    vec3 position;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    float linear_attenuation;
-    float quadratic_attenuation;
+    vec4 position_range;        // xyz: world position, w: range
+    vec4 direction_type;        // xyz: spot direction, w: 0 point, 1 spot
+    vec4 ambient_linear;        // xyz: ambient, w: linear attenuation
+    vec4 diffuse_quadratic;     // xyz: diffuse, w: quadratic attenuation
+    vec4 specular_cutoff;       // xyz: specular, w: cos(cutoff)
+    vec4 outer_cutoff;          // x: cos(outer cutoff)
 };
 
-struct SpotLight
+// Material instance (MaterialRegistry material table)
+struct MaterialInstance
 {
-    vec3 position;
-    vec3 direction;
-    float cutoff;
-    float outer_cutoff;
-    vec3 ambient;
     vec3 diffuse;
+    float shininess;
     vec3 specular;
+    int albedo_texture_location;    // (array << 16) | layer, -1 until the texture is resident
 };
 
-struct MaterialInstance
+// Materials, indexed by material instance id
+layout (std430, binding = 7) readonly buffer Materials
 {
-    vec3 diffuse;
-    vec3 specular;
-    float shininess;
-    int albedo_texture_idx;
+    MaterialInstance material_instances[];
 };
 
-
 // Material uniforms
-uniform MaterialInstance material_instances[MAX_MATERIAL_INSTANCES];
 uniform sampler2D white_1x1_texture;
-uniform sampler2DArray albedo_textures;
+uniform sampler2DArray albedo_textures[ALBEDO_TEXTURE_ARRAYS];
+
+// Scene lights (LightBuffer)
+layout (std430, binding = 4) readonly buffer Lights
+{
+    DirectionalLight dir_light;
+    uint dir_light_count;
+    uint light_count;
+    Light lights[];
+};
+
+// Light grid: depth slices parameters, then (offset, count) in light_indices, per cluster
+layout (std430, binding = 5) readonly buffer LightClusters
+{
+    vec4 light_grid_depth_params;       // slice = log(depth) * x + y
+    uvec2 light_clusters[];
+};
 
-// Lights uniforms
-uniform uint active_point_lights_count;
-uniform uint active_spot_lights_count;
-uniform DirectionalLight dir_light;
-uniform PointLight point_lights[MAX_POINT_LIGHTS];
-uniform SpotLight spot_lights[MAX_SPOT_LIGHTS];
+layout (std430, binding = 6) readonly buffer LightIndices
+{
+    uint light_indices[];
+};
+
+// Per-frame data (SceneRenderer FrameData)
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 view_matrix;
+    mat4 projection_matrix;
+    mat4 view_projection_matrix;
+    mat4 inverse_view_matrix;
+    vec4 camera_position;
+    vec2 viewport_size;
+    float time;
+};
 
 out vec4 color;
 
-vec3 compute_common_light_effect(vec3 to_light, vec3 light_ambient, vec3 light_diffuse, vec3 light_specular, vec3 normal, vec3 to_camera)
+// The array index is not dynamically uniform (instances of different materials): constant indices only
+vec3 sample_albedo(int location)
 {
-    MaterialInstance material_instance = material_instances[fs_in.instance_materialID];
-    // vec3 tex_color = texture(albedo_textures, vec3(fs_in.tex_coord, material_instance.albedo_texture_idx)).xyz;
-    vec3 tex_color;
-    
-    if (material_instance.albedo_texture_idx >= 0)
+    if (location < 0)
     {
-        tex_color = texture(albedo_textures, vec3(fs_in.tex_coord, material_instance.albedo_texture_idx)).xyz;
+        return texture(white_1x1_texture, vec2(0)).xyz;
     }
-    else
+
+    vec3 coord = vec3(fs_in.tex_coord, float(location & 0xFFFF));
+    switch (location >> 16)
     {
-        tex_color = texture(white_1x1_texture, vec2(0)).xyz;
+        case 0: return texture(albedo_textures[0], coord).xyz;
+        case 1: return texture(albedo_textures[1], coord).xyz;
+        case 2: return texture(albedo_textures[2], coord).xyz;
+        case 3: return texture(albedo_textures[3], coord).xyz;
+        case 4: return texture(albedo_textures[4], coord).xyz;
+        case 5: return texture(albedo_textures[5], coord).xyz;
+        case 6: return texture(albedo_textures[6], coord).xyz;
+        default: return texture(albedo_textures[7], coord).xyz;
     }
+}
+
+// Sampled once per fragment, shared by all the lights
+vec3 tex_color;
+
+vec3 compute_common_light_effect(vec3 to_light, vec3 light_ambient, vec3 light_diffuse, vec3 light_specular, vec3 normal, vec3 to_camera)
+{
+    MaterialInstance material_instance = material_instances[fs_in.instance_materialID];
 
     // Ambient Light
     vec3 ambient = light_ambient * tex_color;
@@ -99,56 +138,92 @@ vec3 compute_common_light_effect(vec3 to_light, vec3 light_ambient, vec3 light_d
 
 vec3 compute_dir_light_effect(DirectionalLight light, vec3 normal, vec3 to_camera)
 {
-    vec3 to_light = normalize(-light.direction);
+    vec3 to_light = normalize(-light.direction.xyz);
 
-    return compute_common_light_effect(to_light, light.ambient, light.diffuse, light.specular, normal, to_camera);
+    return compute_common_light_effect(to_light, light.ambient.xyz, light.diffuse.xyz, light.specular.xyz, normal, to_camera);
 }
 
-vec3 compute_point_light_effect(PointLight light, vec3 normal, vec3 to_camera, vec3 to_light, float distance)
+// Smooth fade out up to the light range
+float compute_range_factor(Light light, float distance)
 {
-    vec3 result = compute_common_light_effect(to_light, light.ambient, light.diffuse, light.specular, normal, to_camera);
+    float range_factor = clamp(1.0 - pow(distance / light.position_range.w, 4.0), 0.0, 1.0);
+    return range_factor * range_factor;
+}
+
+vec3 compute_point_light_effect(Light light, vec3 normal, vec3 to_camera, vec3 to_light, float distance)
+{
+    vec3 result = compute_common_light_effect(to_light, light.ambient_linear.xyz, light.diffuse_quadratic.xyz,
+                                              light.specular_cutoff.xyz, normal, to_camera);
 
     float attenuation;
-    attenuation = 1.0 / (1.0 + light.linear_attenuation * distance
-                        + light.quadratic_attenuation * distance * distance);
+    attenuation = 1.0 / (1.0 + light.ambient_linear.w * distance
+                        + light.diffuse_quadratic.w * distance * distance);
+    attenuation *= compute_range_factor(light, distance);
 
     return result * attenuation;
 }
 
-vec3 compute_spot_light_effect(SpotLight light, vec3 normal, vec3 to_camera, vec3 to_light)
+vec3 compute_spot_light_effect(Light light, vec3 normal, vec3 to_camera, vec3 to_light, float distance)
 {
     vec3 result;
-    float theta = dot(to_light, normalize(-light.direction));
-    float epsilon = light.cutoff - light.outer_cutoff;
-    float intensity = clamp((theta - light.outer_cutoff) / epsilon, 0.0, 1.0);
+    float theta = dot(to_light, normalize(-light.direction_type.xyz));
+    float epsilon = light.specular_cutoff.w - light.outer_cutoff.x;
+    float intensity = clamp((theta - light.outer_cutoff.x) / epsilon, 0.0, 1.0);
+
+    intensity *= compute_range_factor(light, distance);
 
-    result = compute_common_light_effect(to_light, light.ambient, light.diffuse, light.specular, normal, to_camera);
+    result = compute_common_light_effect(to_light, light.ambient_linear.xyz, light.diffuse_quadratic.xyz,
+                                         light.specular_cutoff.xyz, normal, to_camera);
     result *= intensity;
 
     return result;
 }
 
+uint get_light_cluster()
+{
+    vec2 tile_size = viewport_size / vec2(LIGHT_GRID_TILES_X, LIGHT_GRID_TILES_Y);
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / tile_size), uvec2(LIGHT_GRID_TILES_X - 1, LIGHT_GRID_TILES_Y - 1));
+    float slice = log(max(fs_in.view_depth, 1e-4)) * light_grid_depth_params.x + light_grid_depth_params.y;
+    uint slice_index = uint(clamp(slice, 0.0, float(LIGHT_GRID_SLICES - 1)));
+
+    return (slice_index * LIGHT_GRID_TILES_Y + tile.y) * LIGHT_GRID_TILES_X + tile.x;
+}
+
 void main()
 {
     vec3 unit_normal = normalize(fs_in.normal);
     vec3 unit_to_camera = normalize(fs_in.to_camera);
+    tex_color = sample_albedo(material_instances[fs_in.instance_materialID].albedo_texture_location);
 
     // Directional Light
-    vec3 frag_color;
-    frag_color = compute_dir_light_effect(dir_light, unit_normal, unit_to_camera);
-
-    // Point Light(s)
-    for(int i = 0; i < active_point_lights_count; i++)
+    vec3 frag_color = vec3(0.0);
+    if (dir_light_count > 0)
     {
-        frag_color += compute_point_light_effect(point_lights[i], unit_normal, unit_to_camera,
-                                                    fs_in.to_point_lights[i], fs_in.distances_to_point_lights[i]);
+        frag_color = compute_dir_light_effect(dir_light, unit_normal, unit_to_camera);
     }
 
-    // Spot Light(s)
-    for(int i = 0; i < active_spot_lights_count; i++)
+    // Point & Spot Lights of the fragment cluster
+    uvec2 cluster = light_clusters[get_light_cluster()];
+    for (uint i = 0; i < cluster.y; i++)
     {
-        frag_color += compute_spot_light_effect(spot_lights[i], unit_normal, unit_to_camera,
-                                                    fs_in.to_spot_lights[i]);
+        Light light = lights[light_indices[cluster.x + i]];
+        vec3 to_light = light.position_range.xyz - fs_in.world_position;
+        float distance = length(to_light);
+        // The range fade is 0 from there
+        if (distance >= light.position_range.w)
+        {
+            continue;
+        }
+        to_light /= distance;
+
+        if (light.direction_type.w == 0.0)
+        {
+            frag_color += compute_point_light_effect(light, unit_normal, unit_to_camera, to_light, distance);
+        }
+        else
+        {
+            frag_color += compute_spot_light_effect(light, unit_normal, unit_to_camera, to_light, distance);
+        }
     }
 
     color = vec4(frag_color, 1.0f);
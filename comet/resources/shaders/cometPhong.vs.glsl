@@ -1,96 +1,74 @@
 #version 430 core
 
-#define MAX_POINT_LIGHTS 4
-#define MAX_SPOT_LIGHTS 4
-
-// Vertex attributes
+// Vertex attributes (quantized position, octahedral encoded normal)
 layout (location = 0) in vec3 position;
-layout (location = 1) in vec3 normal;
+layout (location = 1) in vec2 normal_oct;
 layout (location = 2) in vec2 texCoordinate;
 
-// Instance attributes
-layout (location = 10) in mat4 instance_model_matrix;
+// Instance attributes: model = translation * rotation * scale (the scale and translation include
+// the dequantization of the positions)
+layout (location = 10) in vec4 instance_rotation;
+layout (location = 11) in vec3 instance_translation;
+layout (location = 12) in vec3 instance_scale;
 layout (location = 14) in uint instance_materialID;
 
-// View & Projection Matrices uniforms
-uniform mat4 projection_matrix;
-uniform mat4 view_matrix;
-
-struct DirectionalLight
-{
-    vec3 direction;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct PointLight
+// Per-frame data (SceneRenderer FrameData)
+layout (std140, binding = 0) uniform FrameData
 {
-    vec3 position;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    float linear_attenuation;
-    float quadratic_attenuation;
+    mat4 view_matrix;
+    mat4 projection_matrix;
+    mat4 view_projection_matrix;
+    mat4 inverse_view_matrix;
+    vec4 camera_position;
+    vec2 viewport_size;
+    float time;
 };
 
-struct SpotLight
-{
-    vec3 position;
-    vec3 direction;
-    float cutoff;
-    float outer_cutoff;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-// Light uniforms
-uniform DirectionalLight dir_light;
-
-// Point Lights uniforms
-uniform uint active_point_lights_count;
-uniform uint active_spot_lights_count;
-uniform PointLight point_lights[MAX_POINT_LIGHTS];
-uniform SpotLight spot_lights[MAX_SPOT_LIGHTS];
-
 out VS_OUT
 {
     vec2 tex_coord;
     vec3 normal;
+    vec3 world_position;
     vec3 to_camera;
-    vec3 to_point_lights[MAX_POINT_LIGHTS];
-    vec3 to_spot_lights[MAX_SPOT_LIGHTS];
-    float distances_to_point_lights[MAX_POINT_LIGHTS];
+    float view_depth;
     flat uint instance_materialID;
 } vs_out;
 
+// Must match the depth pre-pass (cometDepthOnly) exactly
+invariant gl_Position;
+
+vec3 rotateByQuaternion(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+
+    return normalize(n);
+}
 
 void main()
 {
     vs_out.tex_coord = texCoordinate;
     
-    vec3 world_normal = mat3(instance_model_matrix) * normal;
+    // Inverse transpose of rotation * scale
+    vec3 world_normal = rotateByQuaternion(instance_rotation, decodeOctahedral(normal_oct) / instance_scale);
     world_normal = normalize(world_normal);
-    vec4 world_position = instance_model_matrix * vec4(position, 1.0);
-    
-    for (int i = 0; i < active_point_lights_count; i++)
-    {
-        vs_out.to_point_lights[i] = point_lights[i].position - world_position.xyz;
-        vs_out.distances_to_point_lights[i] = length(vs_out.to_point_lights[i]);
-        vs_out.to_point_lights[i] = normalize(vs_out.to_point_lights[i]);
-    }
-    
-    for (int i = 0; i < active_spot_lights_count; i++)
-    {
-        vs_out.to_spot_lights[i] = normalize(spot_lights[i].position - world_position.xyz);
-    }
+    vec4 world_position = vec4(instance_translation + rotateByQuaternion(instance_rotation, instance_scale * position), 1.0);
+    vec4 view_position = view_matrix * world_position;
 
-    vec3 to_camera = (inverse(view_matrix) * vec4(0.0, 0.0, 0.0, 1.0)).xyz - world_position.xyz;
+    vec3 to_camera = camera_position.xyz - world_position.xyz;
 
     vs_out.normal = world_normal;
+    vs_out.world_position = world_position.xyz;
     vs_out.to_camera = to_camera;
+    vs_out.view_depth = -view_position.z;
     vs_out.instance_materialID = instance_materialID;
 
-    gl_Position = projection_matrix * view_matrix * world_position;
-}
\ No newline at end of file
+    gl_Position = view_projection_matrix * world_position;
+}
@@ -3,23 +3,42 @@
 // Vertex attributes
 layout (location = 0) in vec3 position;
 
-// Instance attributes
-layout (location = 10) in mat4 instance_model_matrix;
+// Instance attributes: model = translation * rotation * scale
+layout (location = 10) in vec4 instance_rotation;
+layout (location = 11) in vec3 instance_translation;
+layout (location = 12) in vec3 instance_scale;
 
-// View & Projection Matrices uniform
-uniform mat4 vp_matrix;
+// Per-frame data (SceneRenderer FrameData)
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 view_matrix;
+    mat4 projection_matrix;
+    mat4 view_projection_matrix;
+    mat4 inverse_view_matrix;
+    vec4 camera_position;
+    vec2 viewport_size;
+    float time;
+};
 
 out VS_OUT
 {
     vec3 color;
 } vs_out;
 
+// Must match the depth pre-pass (cometDepthOnly) exactly
+invariant gl_Position;
+
+vec3 rotateByQuaternion(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
 void main()
 {
-    vec4 world_position = instance_model_matrix * vec4(position, 1.0);
+    vec4 world_position = vec4(instance_translation + rotateByQuaternion(instance_rotation, instance_scale * position), 1.0);
 
     float value = (world_position.z + 2.0f) / 4.0f;
     vs_out.color = vec3(value, value, value);
 
-    gl_Position = vp_matrix * world_position;
+    gl_Position = view_projection_matrix * world_position;
 }
\ No newline at end of file
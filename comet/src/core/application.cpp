@@ -1,5 +1,6 @@
 #include <comet/application.h>
 #include <comet/window.h>
+#include <comet/renderer.h>
 #include <platforms/sfml/SFMLWindow.h>
 
 #include <functional>
@@ -157,6 +158,10 @@ namespace comet
                 // RENDER: Scene Rendering Callback
                 T_render.resume();
                 m_window->clearBuffers();
+
+                // Once per frame for all the scene renderers
+                Renderer::beginFrame();
+
                 m_activeScene->render();
 
                 // Application Render Callback
@@ -2,6 +2,7 @@
 #include <comet/log.h>
 #include <core/objLoader.h>
 #include <comet/utils.h>
+#include <rendering/geometryPool.h>
 
 namespace comet
 {
@@ -57,6 +58,7 @@ namespace comet
             ObjLoader loader;
             auto meshResourcePath = ResourceManager::getInstance().getResourcePath(ResourceType::MESH, filename);
             auto staticMesh = std::make_unique<StaticMesh>(filename);
+            GeometryPool::getInstance().upload(staticMeshId, *staticMesh.get());
             m_meshMap[staticMeshId] = std::move(staticMesh);
         }
         
@@ -74,6 +76,7 @@ namespace comet
         if (m_meshMap.find(staticMeshId) == m_meshMap.end())
         {
             auto staticMesh = std::make_unique<StaticMesh>(name, vertices, vertexCount);
+            GeometryPool::getInstance().upload(staticMeshId, *staticMesh.get());
             m_meshMap[staticMeshId] = std::move(staticMesh);
         }
         
@@ -92,6 +95,7 @@ namespace comet
         if (m_meshMap.find(staticMeshId) == m_meshMap.end())
         {
             auto staticMesh = std::make_unique<StaticMesh>(name, vertices, vertexCount, indices, indexCount);
+            GeometryPool::getInstance().upload(staticMeshId, *staticMesh.get());
             m_meshMap[staticMeshId] = std::move(staticMesh);
         }
         
@@ -113,4 +117,13 @@ namespace comet
         return staticMeshHandler;
     }
 
+    void ResourceManager::unloadStaticMesh(uint32_t staticMeshId)
+    {
+        if (auto it = m_meshMap.find(staticMeshId); it != m_meshMap.end())
+        {
+            GeometryPool::getInstance().release(staticMeshId);
+            m_meshMap.erase(it);
+        }
+    }
+
 } // namespace comet
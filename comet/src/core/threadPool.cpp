@@ -0,0 +1,159 @@
+#include <core/threadPool.h>
+
+#include <algorithm>
+
+namespace comet
+{
+
+    ThreadPool::ThreadPool()
+    {
+        // The calling thread takes its share of the work in parallelFor()
+        auto hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+        auto workerCount = hardwareThreads - 1;
+        m_workers.reserve(workerCount);
+        for (uint32_t i = 0; i < workerCount; ++i)
+        {
+            m_workers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_all();
+
+        for (auto& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    bool ThreadPool::canRunBackgroundTask() const
+    {
+        auto maxBackgroundTasks = std::max<size_t>(m_workers.size(), 2) - 1;
+        return !m_backgroundTasks.empty() && m_runningBackgroundTasks < maxBackgroundTasks;
+    }
+
+    void ThreadPool::workerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            bool isBackgroundTask{false};
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty() || canRunBackgroundTask(); });
+                if (m_stop && m_tasks.empty())
+                {
+                    return;
+                }
+
+                if (!m_tasks.empty())
+                {
+                    task = std::move(m_tasks.front());
+                    m_tasks.pop_front();
+                }
+                else
+                {
+                    task = std::move(m_backgroundTasks.front());
+                    m_backgroundTasks.pop_front();
+                    m_runningBackgroundTasks++;
+                    isBackgroundTask = true;
+                }
+            }
+
+            task();
+
+            if (isBackgroundTask)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_runningBackgroundTasks--;
+                }
+                m_condition.notify_one();
+            }
+        }
+    }
+
+    void ThreadPool::submit(std::function<void()> task)
+    {
+        // Without workers, the task is run right away
+        if (m_workers.empty())
+        {
+            task();
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_backgroundTasks.push_back(std::move(task));
+        }
+        m_condition.notify_one();
+    }
+
+    void ThreadPool::parallelFor(size_t count, size_t minChunkSize, const std::function<void(size_t begin, size_t end)>& func)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        minChunkSize = std::max<size_t>(minChunkSize, 1);
+        size_t chunkCount = std::min<size_t>(m_workers.size() + 1, (count + minChunkSize - 1) / minChunkSize);
+        if (chunkCount <= 1)
+        {
+            func(0, count);
+            return;
+        }
+
+        size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+        size_t remainingChunks = chunkCount - 1;
+        std::mutex doneMutex;
+        std::condition_variable doneCondition;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (size_t chunk = 1; chunk < chunkCount; ++chunk)
+            {
+                auto begin = chunk * chunkSize;
+                auto end = std::min(begin + chunkSize, count);
+                m_tasks.emplace_back([&, begin, end]()
+                {
+                    func(begin, end);
+
+                    std::lock_guard<std::mutex> doneLock(doneMutex);
+                    if (--remainingChunks == 0)
+                    {
+                        doneCondition.notify_one();
+                    }
+                });
+            }
+        }
+        m_condition.notify_all();
+
+        // First chunk on the calling thread, then the chunks no worker has picked yet
+        // (the workers may be busy with background tasks)
+        func(0, std::min(chunkSize, count));
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_tasks.empty())
+                {
+                    break;
+                }
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+        }
+
+        std::unique_lock<std::mutex> doneLock(doneMutex);
+        doneCondition.wait(doneLock, [&remainingChunks]() { return remainingChunks == 0; });
+    }
+
+} // namespace comet
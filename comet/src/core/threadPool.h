@@ -0,0 +1,47 @@
+#pragma once
+
+#include <comet/singleton.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace comet
+{
+
+    class ThreadPool : public Singleton<ThreadPool>
+    {
+    public:
+        ThreadPool();
+        ~ThreadPool();
+
+        uint32_t getWorkerCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+        // Split [0, count[ in chunks of at least 'minChunkSize' elements and run 'func(begin, end)'
+        // on the workers and the calling thread. Returns once every chunk has been processed.
+        void parallelFor(size_t count, size_t minChunkSize, const std::function<void(size_t begin, size_t end)>& func);
+
+        // Run a long task (file decoding...) on a worker without waiting for it. The parallelFor() chunks
+        // are picked first and one worker is always left for them.
+        void submit(std::function<void()> task);
+
+    private:
+        void workerLoop();
+        bool canRunBackgroundTask() const;
+
+    private:
+        std::vector<std::thread> m_workers;
+        std::deque<std::function<void()>> m_tasks;
+        std::deque<std::function<void()>> m_backgroundTasks;
+        uint32_t m_runningBackgroundTasks{0};
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_stop{false};
+    };
+
+} // namespace comet
@@ -46,6 +46,7 @@ namespace comet
     void Scene::addLight(std::unique_ptr<Light>&& light)
     {
         m_lights.push_back(std::move(light));
+        m_lightsVersion++;
         m_sceneStatistics.lightsCount++;
     }
 
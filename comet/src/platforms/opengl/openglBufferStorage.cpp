@@ -0,0 +1,87 @@
+#include "openglBufferStorage.h"
+#include "openglStateCache.h"
+
+#include <glad/glad.h>
+
+namespace comet
+{
+    namespace openglBufferStorage
+    {
+
+        static GLbitfield getStorageFlags(uint32_t usage)
+        {
+            // The storage is written with glNamedBufferSubData or through a mapping
+            GLbitfield flags = GL_DYNAMIC_STORAGE_BIT | GL_MAP_WRITE_BIT;
+            if (usage == GL_STATIC_READ || usage == GL_DYNAMIC_READ || usage == GL_STREAM_READ)
+            {
+                flags |= GL_MAP_READ_BIT;
+            }
+
+            return flags;
+        }
+
+        uint32_t create(size_t size, uint32_t usage)
+        {
+            GLuint bufferId{0};
+            glCreateBuffers(1, &bufferId);
+            glNamedBufferStorage(bufferId, size, nullptr, getStorageFlags(usage));
+
+            return bufferId;
+        }
+
+        void destroy(uint32_t& bufferId)
+        {
+            if (bufferId)
+            {
+                OpenglStateCache::getInstance().onBufferDeleted(bufferId);
+                glDeleteBuffers(1, &bufferId);
+                bufferId = 0;
+            }
+        }
+
+        uint32_t grow(uint32_t bufferId, size_t copySize, size_t size, uint32_t usage)
+        {
+            auto newBufferId = create(size, usage);
+            if (bufferId && copySize)
+            {
+                glCopyNamedBufferSubData(bufferId, newBufferId, 0, 0, copySize);
+            }
+            destroy(bufferId);
+
+            return newBufferId;
+        }
+
+        void* map(uint32_t bufferId, size_t size, uint32_t access)
+        {
+            GLbitfield flags{0};
+            switch (access)
+            {
+                case GL_READ_ONLY:
+                    flags = GL_MAP_READ_BIT;
+                    break;
+
+                case GL_WRITE_ONLY:
+                    flags = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT;
+                    break;
+
+                default:
+                    flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT;
+                    break;
+            }
+
+            return glMapNamedBufferRange(bufferId, 0, size, flags);
+        }
+
+        bool unmap(uint32_t bufferId, uint32_t access, size_t writtenSize)
+        {
+            if (access == GL_WRITE_ONLY && writtenSize)
+            {
+                glFlushMappedNamedBufferRange(bufferId, 0, writtenSize);
+            }
+
+            return glUnmapNamedBuffer(bufferId) == GL_TRUE;
+        }
+
+    } // namespace openglBufferStorage
+
+} // namespace comet
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace comet
+{
+    // Direct State Access helpers shared by the OpenGL buffer classes.
+    // The buffers use immutable storage: resizing one creates a new buffer object.
+    namespace openglBufferStorage
+    {
+        // New buffer object with an immutable storage of 'size' bytes, the usage hint selects the storage flags
+        uint32_t create(size_t size, uint32_t usage);
+        void destroy(uint32_t& bufferId);
+
+        // Replace the buffer object by a larger one, keeping the first 'copySize' bytes
+        uint32_t grow(uint32_t bufferId, size_t copySize, size_t size, uint32_t usage);
+
+        // Map the whole storage (GL_READ_ONLY / GL_WRITE_ONLY / GL_READ_WRITE access).
+        // A write only mapping invalidates the previous content and its written range is flushed explicitly on unmap.
+        void* map(uint32_t bufferId, size_t size, uint32_t access);
+        bool unmap(uint32_t bufferId, uint32_t access, size_t writtenSize);
+
+    } // namespace openglBufferStorage
+
+} // namespace comet
@@ -1,4 +1,6 @@
 #include "openglCommandBuffer.h"
+#include "openglStateCache.h"
+#include "openglBufferStorage.h"
 #include <comet/log.h>
 
 #include <glad/glad.h>
@@ -6,19 +8,15 @@
 namespace comet
 {
 
+    // The buffer object is created with its storage (immutable)
     OpenglCommandBuffer::OpenglCommandBuffer(uint32_t usage)
         : m_usage(usage)
     {
-        glGenBuffers(1, &m_bufferId);
     }
 
     OpenglCommandBuffer::~OpenglCommandBuffer()
     {
-        if (m_bufferId)
-        {
-            unbind();
-            glDeleteBuffers(1, &m_bufferId);
-        }
+        openglBufferStorage::destroy(m_bufferId);
     };
 
     OpenglCommandBuffer::OpenglCommandBuffer(OpenglCommandBuffer&& other)
@@ -26,7 +24,9 @@ namespace comet
         m_bufferId(std::move(other.m_bufferId)),
         m_size(std::move(other.m_size)),
         m_count(std::move(other.m_count)),
-        m_pMappedMemory(std::move(other.m_pMappedMemory))
+        m_pMappedMemory(std::move(other.m_pMappedMemory)),
+        m_pMappedBase(std::move(other.m_pMappedBase)),
+        m_mapAccess(std::move(other.m_mapAccess))
     {
         other.m_bufferId = 0;
     }
@@ -37,17 +37,15 @@ namespace comet
         {
             return *this;
         }
-        if (m_bufferId)
-        {
-            unbind();
-            glDeleteBuffers(1, &m_bufferId);
-        }
+        openglBufferStorage::destroy(m_bufferId);
 
         m_usage = std::move(other.m_usage);
         m_bufferId = std::move(other.m_bufferId);
         m_size = std::move(other.m_size);
         m_count = std::move(other.m_count);
         m_pMappedMemory = std::move(other.m_pMappedMemory);
+        m_pMappedBase = std::move(other.m_pMappedBase);
+        m_mapAccess = std::move(other.m_mapAccess);
 
         other.m_bufferId = 0;
 
@@ -61,28 +59,51 @@ namespace comet
 
     void OpenglCommandBuffer::bind() const
     {
-        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_bufferId);
+        OpenglStateCache::getInstance().bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_bufferId);
     }
 
     void OpenglCommandBuffer::unbind() const
     {
-        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        OpenglStateCache::getInstance().bindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    void OpenglCommandBuffer::bindStorage(uint32_t bindingIndex, size_t offset /*= 0*/, size_t size /*= 0*/) const
+    {
+        if (size == 0)
+        {
+            OpenglStateCache::getInstance().bindBufferRange(GL_SHADER_STORAGE_BUFFER, bindingIndex, m_bufferId);
+        }
+        else
+        {
+            OpenglStateCache::getInstance().bindBufferRange(GL_SHADER_STORAGE_BUFFER, bindingIndex, m_bufferId, offset, size);
+        }
     }
 
     void OpenglCommandBuffer::allocate()
     {
         if (m_size)
         {
-            bind();
-            glBufferData(GL_DRAW_INDIRECT_BUFFER, m_size, nullptr, m_usage);
+            allocate(m_size);
         }
     }
 
     void OpenglCommandBuffer::allocate(size_t size)
     {
-        bind();
+        // Immutable storage can't be reallocated: start over from a new buffer object
+        openglBufferStorage::destroy(m_bufferId);
+        m_size = size;
+        m_bufferId = openglBufferStorage::create(size, m_usage);
+    }
+
+    void OpenglCommandBuffer::grow(size_t size)
+    {
+        if (size <= m_size)
+        {
+            return;
+        }
+
+        m_bufferId = openglBufferStorage::grow(m_bufferId, m_size, size, m_usage);
         m_size = size;
-        glBufferData(GL_DRAW_INDIRECT_BUFFER, size, nullptr, m_usage);
     }
 
     void OpenglCommandBuffer::loadDataInMappedMemory(const void* data, size_t size, uint32_t count, uint32_t offset /*= 0*/)
@@ -105,19 +126,26 @@ namespace comet
 
     void* OpenglCommandBuffer::mapMemory(uint32_t access)
     {
-        bind();
-        m_pMappedMemory = glMapBuffer(GL_DRAW_INDIRECT_BUFFER, (GLenum)access);
+        m_mapAccess = access;
+        m_pMappedMemory = openglBufferStorage::map(m_bufferId, m_size, access);
+        m_pMappedBase = m_pMappedMemory;
         return m_pMappedMemory;
     }
 
     void OpenglCommandBuffer::unmapMemory()
     {
-        bind();
-        if (!glUnmapBuffer(GL_DRAW_INDIRECT_BUFFER))
+        auto writtenSize = static_cast<size_t>(static_cast<char*>(m_pMappedMemory) - static_cast<char*>(m_pMappedBase));
+        if (!openglBufferStorage::unmap(m_bufferId, m_mapAccess, writtenSize))
         {
             CM_CORE_LOG_ERROR("Error while unmapping OpenglCommandBuffer");
         }
         m_pMappedMemory = nullptr;
+        m_pMappedBase = nullptr;
+    }
+
+    void OpenglCommandBuffer::loadData(const void* data, size_t size, size_t offset)
+    {
+        glNamedBufferSubData(m_bufferId, offset, size, data);
     }
 
 } // namespace comet
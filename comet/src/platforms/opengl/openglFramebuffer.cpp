@@ -1,4 +1,5 @@
 #include "openglFramebuffer.h"
+#include "openglStateCache.h"
 
 #include <comet/texture.h>
 #include <comet/application.h>
@@ -33,73 +34,66 @@ namespace comet
         glCreateTextures(getTextureTarget(isMultisampled), count, textureIds);
     }
 
-    static void bindTexture(bool isMultisampled, uint32_t id)
-    {
-        glBindTexture(getTextureTarget(isMultisampled), id);
-    }
-
-    static void attachColorTexture(uint32_t id, uint16_t samples, GLenum format, uint16_t width, uint16_t height, uint16_t index)
+    static void attachColorTexture(uint32_t framebufferId, uint32_t id, uint16_t samples, GLenum format, uint16_t width, uint16_t height, uint16_t index)
     {
         // Multisampled?
         if (samples > 1)
         {
-            glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, samples, format, width, height, GL_FALSE);
+            glTextureStorage2DMultisample(id, samples, format, width, height, GL_FALSE);
         }
         else
         {
-            glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTextureStorage2D(id, 1, format, width, height);
+            glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTextureParameteri(id, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         }
         
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + index,
-                                getTextureTarget(samples > 1), id, 0);
+        glNamedFramebufferTexture(framebufferId, GL_COLOR_ATTACHMENT0 + index, id, 0);
     }
 
-    static void attachDepthTexture(uint32_t id, uint16_t samples, GLenum format, GLenum attachmentType, uint16_t width, uint16_t height)
+    static void attachDepthTexture(uint32_t framebufferId, uint32_t id, uint16_t samples, GLenum format, GLenum attachmentType, uint16_t width, uint16_t height)
     {
         // Multisampled?
         if (samples > 1)
         {
-            glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, samples, format, width, height, GL_FALSE);
+            glTextureStorage2DMultisample(id, samples, format, width, height, GL_FALSE);
         }
         else
         {
-            glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTextureStorage2D(id, 1, format, width, height);
+            glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTextureParameteri(id, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         }
         
-        glFramebufferTexture2D(GL_FRAMEBUFFER, attachmentType, getTextureTarget(samples > 1), id, 0);
+        glNamedFramebufferTexture(framebufferId, attachmentType, id, 0);
     }
 
-    static void attachDepthRenderBuffer(uint32_t id, uint16_t samples, GLenum format, GLenum attachmentType, uint16_t width, uint16_t height)
+    static void attachDepthRenderBuffer(uint32_t framebufferId, uint32_t& id, uint16_t samples, GLenum format, GLenum attachmentType, uint16_t width, uint16_t height)
     {
-        glGenRenderbuffers(1, &id);
-        glBindRenderbuffer(GL_RENDERBUFFER, id);
+        glCreateRenderbuffers(1, &id);
 
         // Multisampled?
         if (samples > 1)
         {
-            glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, format, width, height);
+            glNamedRenderbufferStorageMultisample(id, samples, format, width, height);
         }
         else
         {
-            glRenderbufferStorage(GL_RENDERBUFFER, format, width, height);
+            glNamedRenderbufferStorage(id, format, width, height);
         }
 
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachmentType, GL_RENDERBUFFER, id);
+        glNamedFramebufferRenderbuffer(framebufferId, attachmentType, GL_RENDERBUFFER, id);
     }
 
     OpenglFramebuffer::OpenglFramebuffer(const FramebufferSpec& spec) : Framebuffer(spec)
     {
-        glGenFramebuffers(1, &m_bufferId);
+        glCreateFramebuffers(1, &m_bufferId);
 
         // Split attachmentSet to color attachments and depth attachment
         for (auto& attachment : m_spec.attachmentSet.attachments)
@@ -120,9 +114,14 @@ namespace comet
         if (m_bufferId)
         {
             unbind();
+            OpenglStateCache::getInstance().onFramebufferDeleted(m_bufferId);
             glDeleteFramebuffers(1, &m_bufferId);
+            for (auto colorAttachmentId : m_colorAttachmentIds)
+            {
+                OpenglStateCache::getInstance().onTextureDeleted(colorAttachmentId);
+            }
             glDeleteTextures(m_colorAttachmentIds.size(), m_colorAttachmentIds.data());
-            glDeleteTextures(1, &m_depthAttachmentId);
+            glDeleteRenderbuffers(1, &m_depthAttachmentId);
         }
     }
 
@@ -145,6 +144,7 @@ namespace comet
         if (m_bufferId)
         {
             unbind();
+            OpenglStateCache::getInstance().onFramebufferDeleted(m_bufferId);
             glDeleteFramebuffers(1, &m_bufferId);
         }
 
@@ -167,15 +167,16 @@ namespace comet
 
     void OpenglFramebuffer::invalidate()
     {
-        // Bind
-        glBindFramebuffer(GL_FRAMEBUFFER, m_bufferId);
-
         // Cleanup if reusing the framebuffer
         if (m_bufferId)
         {
+            for (auto colorAttachmentId : m_colorAttachmentIds)
+            {
+                OpenglStateCache::getInstance().onTextureDeleted(colorAttachmentId);
+            }
             glDeleteTextures(m_colorAttachmentIds.size(), m_colorAttachmentIds.data());
             m_colorAttachmentIds.clear();
-            glDeleteTextures(1, &m_depthAttachmentId);
+            glDeleteRenderbuffers(1, &m_depthAttachmentId);
             m_depthAttachmentId = 0;
         }
 
@@ -190,12 +191,10 @@ namespace comet
 
             for (size_t i = 0; i < m_colorAttachmentIds.size(); i++)
             {
-                bindTexture(isMultisampled, m_colorAttachmentIds[i]);
-
                 switch (m_colorAttachmentSpecs[i].format)
                 {
                 case FramebufferTextureFormat::RGBA8:
-                    attachColorTexture(m_colorAttachmentIds[i], m_spec.samples, GL_RGBA8,
+                    attachColorTexture(m_bufferId, m_colorAttachmentIds[i], m_spec.samples, GL_RGBA8,
                                         m_spec.width, m_spec.height, i);
                     break;
                 }
@@ -213,7 +212,7 @@ namespace comet
             switch (m_depthAttachmentSpec.format)
             {
             case FramebufferTextureFormat::DEPTH24_STENCIL8:
-                attachDepthRenderBuffer(m_depthAttachmentId, m_spec.samples, GL_DEPTH24_STENCIL8,
+                attachDepthRenderBuffer(m_bufferId, m_depthAttachmentId, m_spec.samples, GL_DEPTH24_STENCIL8,
                                     GL_DEPTH_STENCIL_ATTACHMENT, m_spec.width, m_spec.height);
 
                 break;
@@ -224,18 +223,15 @@ namespace comet
         {
             ASSERT(m_colorAttachmentIds.size() <= 4, "A maximum of 4 color attachments for Framebuffers are supported");
             GLenum buffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3 };
-            glDrawBuffers(m_colorAttachmentIds.size(), buffers);
+            glNamedFramebufferDrawBuffers(m_bufferId, m_colorAttachmentIds.size(), buffers);
         }
         else if (m_colorAttachmentIds.empty())
         {
-            glDrawBuffer(GL_NONE);
+            glNamedFramebufferDrawBuffer(m_bufferId, GL_NONE);
         }
 
         // Check Completeness
-        ASSERT(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE, "Framebuffer is incomplete!");
-
-        // Unbind
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        ASSERT(glCheckNamedFramebufferStatus(m_bufferId, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE, "Framebuffer is incomplete!");
     }
 
     void OpenglFramebuffer::renderToScreen()
@@ -272,7 +268,7 @@ namespace comet
 
         if (m_shader && m_spec.swapChainTarget == true)
         {
-            glDisable(GL_DEPTH_TEST);
+            OpenglStateCache::getInstance().setDepthTest(false);
 
             auto window = Application::getInstance()->getWindow();
             auto width = window->getWidth();
@@ -290,7 +286,7 @@ namespace comet
             glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
             m_vao->unbind();
 
-            glEnable(GL_DEPTH_TEST);
+            OpenglStateCache::getInstance().setDepthTest(true);
         }
     }
 
@@ -309,12 +305,12 @@ namespace comet
 
     void OpenglFramebuffer::bind() const
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, m_bufferId);
+        OpenglStateCache::getInstance().bindFramebuffer(m_bufferId);
     }
 
     void OpenglFramebuffer::unbind() const
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        OpenglStateCache::getInstance().bindFramebuffer(0);
     }
     
 } // namespace comet
@@ -1,4 +1,6 @@
 #include "openglIndexBuffer.h"
+#include "openglStateCache.h"
+#include "openglBufferStorage.h"
 #include <comet/log.h>
 
 #include <glad/glad.h>
@@ -6,27 +8,26 @@
 namespace comet
 {
 
-    OpenglIndexBuffer::OpenglIndexBuffer(uint32_t usage)
-        : m_usage(usage)
+    // The buffer object is created with its storage (immutable)
+    OpenglIndexBuffer::OpenglIndexBuffer(uint32_t usage, IndexType indexType)
+        : m_usage(usage), m_indexType(indexType)
     {
-        glGenBuffers(1, &m_bufferId);
     }
 
     OpenglIndexBuffer::~OpenglIndexBuffer()
     {
-        if (m_bufferId)
-        {
-            unbind();
-            glDeleteBuffers(1, &m_bufferId);
-        }
+        openglBufferStorage::destroy(m_bufferId);
     };
 
     OpenglIndexBuffer::OpenglIndexBuffer(OpenglIndexBuffer&& other)
         : m_usage(std::move(other.m_usage)),
+        m_indexType(std::move(other.m_indexType)),
         m_bufferId(std::move(other.m_bufferId)),
         m_size(std::move(other.m_size)),
         m_count(std::move(other.m_count)),
-        m_pMappedMemory(std::move(other.m_pMappedMemory))
+        m_pMappedMemory(std::move(other.m_pMappedMemory)),
+        m_pMappedBase(std::move(other.m_pMappedBase)),
+        m_mapAccess(std::move(other.m_mapAccess))
     {
         other.m_bufferId = 0;
     }
@@ -37,17 +38,16 @@ namespace comet
         {
             return *this;
         }
-        if (m_bufferId)
-        {
-            unbind();
-            glDeleteBuffers(1, &m_bufferId);
-        }
+        openglBufferStorage::destroy(m_bufferId);
 
         m_usage = std::move(other.m_usage);
+        m_indexType = std::move(other.m_indexType);
         m_bufferId = std::move(other.m_bufferId);
         m_size = std::move(other.m_size);
         m_count = std::move(other.m_count);
         m_pMappedMemory = std::move(other.m_pMappedMemory);
+        m_pMappedBase = std::move(other.m_pMappedBase);
+        m_mapAccess = std::move(other.m_mapAccess);
 
         other.m_bufferId = 0;
 
@@ -61,31 +61,54 @@ namespace comet
 
     void OpenglIndexBuffer::bind() const
     {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufferId);
+        OpenglStateCache::getInstance().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_bufferId);
     }
 
     void OpenglIndexBuffer::unbind() const
     {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        OpenglStateCache::getInstance().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+
+    void OpenglIndexBuffer::bindStorage(uint32_t bindingIndex, size_t offset /*= 0*/, size_t size /*= 0*/) const
+    {
+        if (size == 0)
+        {
+            OpenglStateCache::getInstance().bindBufferRange(GL_SHADER_STORAGE_BUFFER, bindingIndex, m_bufferId);
+        }
+        else
+        {
+            OpenglStateCache::getInstance().bindBufferRange(GL_SHADER_STORAGE_BUFFER, bindingIndex, m_bufferId, offset, size);
+        }
     }
 
     void OpenglIndexBuffer::allocate()
     {
         if (m_size)
         {
-            bind();
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_size, nullptr, m_usage);
+            allocate(m_size);
         }
     }
 
     void OpenglIndexBuffer::allocate(size_t size)
     {
-        bind();
+        // Immutable storage can't be reallocated: start over from a new buffer object
+        openglBufferStorage::destroy(m_bufferId);
         m_size = size;
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, nullptr, m_usage);
+        m_bufferId = openglBufferStorage::create(size, m_usage);
     }
 
-    void OpenglIndexBuffer::loadDataInMappedMemory(const uint32_t* data, uint32_t count, uint32_t offset /*= 0*/)
+    void OpenglIndexBuffer::grow(size_t size)
+    {
+        if (size <= m_size)
+        {
+            return;
+        }
+
+        m_bufferId = openglBufferStorage::grow(m_bufferId, m_size, size, m_usage);
+        m_size = size;
+    }
+
+    void OpenglIndexBuffer::loadDataInMappedMemory(const void* data, uint32_t count, uint32_t offset /*= 0*/)
     {
         if (m_pMappedMemory == nullptr)
         {
@@ -98,7 +121,7 @@ namespace comet
             m_pMappedMemory = static_cast<char*>(m_pMappedMemory) + offset;
         }
 
-        auto size = count * sizeof(uint32_t);
+        auto size = count * getIndexSize(m_indexType);
         memcpy(m_pMappedMemory, data, size);
         m_pMappedMemory = static_cast<char*>(m_pMappedMemory) + size;
         m_count += count;
@@ -106,20 +129,26 @@ namespace comet
 
     void* OpenglIndexBuffer::mapMemory(uint32_t access)
     {
-        bind();
-        m_pMappedMemory = glMapBuffer(GL_ELEMENT_ARRAY_BUFFER, (GLenum)access);
+        m_mapAccess = access;
+        m_pMappedMemory = openglBufferStorage::map(m_bufferId, m_size, access);
+        m_pMappedBase = m_pMappedMemory;
         return m_pMappedMemory;
     }
 
     void OpenglIndexBuffer::unmapMemory()
     {
-        bind();
-        if (!glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER))
+        auto writtenSize = static_cast<size_t>(static_cast<char*>(m_pMappedMemory) - static_cast<char*>(m_pMappedBase));
+        if (!openglBufferStorage::unmap(m_bufferId, m_mapAccess, writtenSize))
         {
             CM_CORE_LOG_ERROR("Error while unmapping OpenglIndexBuffer");
         }
         m_pMappedMemory = nullptr;
+        m_pMappedBase = nullptr;
+    }
+
+    void OpenglIndexBuffer::loadData(const void* data, size_t size, size_t offset)
+    {
+        glNamedBufferSubData(m_bufferId, offset, size, data);
     }
 
-    
 } // namespace comet
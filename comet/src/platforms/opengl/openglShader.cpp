@@ -1,7 +1,9 @@
 #include "openglShader.h"
+#include "openglStateCache.h"
 #include <comet/log.h>
 #include <comet/assert.h>
 
+#include <algorithm>
 #include <fstream>
 #include <string>
 
@@ -19,6 +21,7 @@ namespace comet
     OpenglShader::~OpenglShader()
     {
         if (m_program) {
+            OpenglStateCache::getInstance().onProgramDeleted(m_program);
             glDeleteProgram(m_program);
             m_program = 0;
         }
@@ -64,6 +67,11 @@ namespace comet
         case Type::GEOMETRY:
             glShaderType = GL_GEOMETRY_SHADER;
             break;
+
+        case Type::COMPUTE:
+            glShaderType = GL_COMPUTE_SHADER;
+            m_hasComputeShader = true;
+            break;
         
         default:
             CM_CORE_LOG_FATAL("Unmanaged shader type {}", shaderType);
@@ -108,8 +116,14 @@ namespace comet
 
     void OpenglShader::linkProgram()
     {
-        // Check if there is at least a Vertext shader and a Fragment shader
-        if (!m_hasVertexShader || !m_hasFragmentShader)
+        // Check if there is at least a Vertext shader and a Fragment shader (or a standalone Compute shader)
+        if (m_hasComputeShader && m_numShaders != 1)
+        {
+            CM_CORE_LOG_FATAL("A Compute shader program can't be linked with other shader stages");
+            exit(EXIT_FAILURE);
+        }
+
+        if (!m_hasComputeShader && (!m_hasVertexShader || !m_hasFragmentShader))
         {
             CM_CORE_LOG_FATAL("Both a Vertex and a Fragment shader must be provided to build a shader program");
             exit(EXIT_FAILURE);
@@ -136,6 +150,7 @@ namespace comet
             glGetProgramInfoLog(m_program, maxLength, &maxLength, infoLog.data());
 
             // We don't need the program anymore.
+            OpenglStateCache::getInstance().onProgramDeleted(m_program);
             glDeleteProgram(m_program);
 
             // Don't leak shaders either.
@@ -162,6 +177,121 @@ namespace comet
         // In case we want to reuse this program with different shaders code.
         // TODO(jcp): Think more about this
         m_numShaders = 0;
+
+        reflectProgram();
+    }
+
+    void OpenglShader::insertEntry(std::vector<ReflectedEntry>& table, uint32_t hash, int value, const char* name)
+    {
+        auto mask = table.size() - 1;
+        for (auto index = hash & mask; ; index = (index + 1) & mask)
+        {
+            auto& entry = table[index];
+            if (!entry.used)
+            {
+                entry = {hash, value, true};
+                return;
+            }
+
+            if (entry.hash == hash)
+            {
+                CM_CORE_LOG_ERROR("Hash collision on uniform {}: rename it", name);
+                ASSERT(false, "Uniform names hash collision");
+                return;
+            }
+        }
+    }
+
+    const OpenglShader::ReflectedEntry* OpenglShader::findEntry(const std::vector<ReflectedEntry>& table, uint32_t hash)
+    {
+        if (table.empty())
+        {
+            return nullptr;
+        }
+
+        auto mask = table.size() - 1;
+        for (auto index = hash & mask; table[index].used; index = (index + 1) & mask)
+        {
+            if (table[index].hash == hash)
+            {
+                return &table[index];
+            }
+        }
+
+        return nullptr;
+    }
+
+    void OpenglShader::reflectResources(uint32_t programInterface, std::vector<ReflectedEntry>& table)
+    {
+        int resourceCount = 0;
+        glGetProgramInterfaceiv(m_program, programInterface, GL_ACTIVE_RESOURCES, &resourceCount);
+
+        int maxNameLength = 0;
+        glGetProgramInterfaceiv(m_program, programInterface, GL_MAX_NAME_LENGTH, &maxNameLength);
+        std::vector<char> name(std::max(maxNameLength, 1));
+
+        for (int i = 0; i < resourceCount; ++i)
+        {
+            int value = -1;
+            if (programInterface == GL_UNIFORM)
+            {
+                // The members of the uniform blocks don't have a location
+                const GLenum properties[] = {GL_BLOCK_INDEX, GL_LOCATION};
+                int values[2];
+                glGetProgramResourceiv(m_program, programInterface, i, 2, properties, 2, nullptr, values);
+                if (values[0] != -1)
+                {
+                    continue;
+                }
+                value = values[1];
+            }
+            else
+            {
+                const GLenum property = GL_BUFFER_BINDING;
+                glGetProgramResourceiv(m_program, programInterface, i, 1, &property, 1, nullptr, &value);
+            }
+
+            glGetProgramResourceName(m_program, programInterface, i, static_cast<GLsizei>(name.size()), nullptr, name.data());
+
+            // Arrays are reported as "name[0]", they are set by their name
+            std::string resourceName(name.data());
+            if (resourceName.size() > 3 && resourceName.compare(resourceName.size() - 3, 3, "[0]") == 0)
+            {
+                resourceName.resize(resourceName.size() - 3);
+            }
+
+            insertEntry(table, UniformId(resourceName.c_str()).hash, value, resourceName.c_str());
+        }
+    }
+
+    void OpenglShader::reflectProgram()
+    {
+        auto tableSize = [this](std::initializer_list<uint32_t> programInterfaces)
+        {
+            int count = 0;
+            for (auto programInterface : programInterfaces)
+            {
+                int resourceCount = 0;
+                glGetProgramInterfaceiv(m_program, programInterface, GL_ACTIVE_RESOURCES, &resourceCount);
+                count += resourceCount;
+            }
+
+            // Power of two, at most half full
+            size_t size = 8;
+            while (size < 2 * static_cast<size_t>(count))
+            {
+                size *= 2;
+            }
+            return size;
+        };
+
+        m_uniformLocations.assign(tableSize({GL_UNIFORM}), {});
+        m_blockBindings.assign(tableSize({GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK}), {});
+        m_reportedUniforms.clear();
+
+        reflectResources(GL_UNIFORM, m_uniformLocations);
+        reflectResources(GL_UNIFORM_BLOCK, m_blockBindings);
+        reflectResources(GL_SHADER_STORAGE_BLOCK, m_blockBindings);
     }
 
     void OpenglShader::validateProgram()
@@ -180,96 +310,105 @@ namespace comet
         }
     }
 
-    int OpenglShader::getUniformLocation(const std::string& name)
+    int OpenglShader::getUniformLocation(UniformId id)
     {
-        if (auto location = m_uniformLocationsCache.find(name); location != m_uniformLocationsCache.end())
+        if (auto entry = findEntry(m_uniformLocations, id.hash))
         {
-            return location->second;
+            return entry->value;
         }
 
-        int location = glGetUniformLocation(m_program, name.c_str());
-        if (location == GL_INVALID_INDEX)
+        if (std::find(m_reportedUniforms.begin(), m_reportedUniforms.end(), id.hash) == m_reportedUniforms.end())
         {
-            CM_CORE_LOG_WARN("Uniform {} not found in sharder program {}", name, m_name);
+#ifndef NDEBUG
+            CM_CORE_LOG_WARN("Uniform {} not found in shader program {}", id.name, m_name);
+#else
+            CM_CORE_LOG_WARN("Uniform {:#x} not found in shader program {}", id.hash, m_name);
+#endif
+            m_reportedUniforms.push_back(id.hash);
         }
-        m_uniformLocationsCache[name] = location;
 
-        return location;
+        return -1;
+    }
+
+    int OpenglShader::getBlockBinding(UniformId id) const
+    {
+        auto entry = findEntry(m_blockBindings, id.hash);
+        return entry ? entry->value : -1;
     }
 
-    void OpenglShader::setUniform(const std::string& name, float value)
+    void OpenglShader::setUniform(UniformId id, float value)
     {
-        int location = getUniformLocation(name);
+        int location = getUniformLocation(id);
         glUniform1f(location, value);
     }
 
-    void OpenglShader::setUniform(const std::string& name, int value)
+    void OpenglShader::setUniform(UniformId id, int value)
     {
-        int location = getUniformLocation(name);
+        int location = getUniformLocation(id);
         glUniform1i(location, value);
     }
 
-    void OpenglShader::setUniform(const std::string& name, uint32_t value)
+    void OpenglShader::setUniform(UniformId id, uint32_t value)
     {
-        int location = getUniformLocation(name);
+        int location = getUniformLocation(id);
         glUniform1ui(location, value);
     }
 
-    void OpenglShader::setUniform(const std::string& name, const glm::vec2& value)
+    void OpenglShader::setUniform(UniformId id, const glm::vec2& value)
     {
-        int location = getUniformLocation(name);
+        int location = getUniformLocation(id);
         glUniform2fv(location, 1, &value[0]);
     }
 
-    void OpenglShader::setUniform(const std::string& name, const glm::vec3& value)
+    void OpenglShader::setUniform(UniformId id, const glm::vec3& value)
     {
-        int location = getUniformLocation(name);
+        int location = getUniformLocation(id);
         glUniform3fv(location, 1, &value[0]);
     }
 
-    void OpenglShader::setUniform(const std::string& name, const glm::vec4& value)
+    void OpenglShader::setUniform(UniformId id, const glm::vec4& value)
     {
-        int location = getUniformLocation(name);
+        int location = getUniformLocation(id);
         glUniform4fv(location, 1, &value[0]);
     }
 
-    void OpenglShader::setUniform(const std::string& name, const glm::mat4& value)
+    void OpenglShader::setUniform(UniformId id, const glm::mat4& value)
     {
-        int location = getUniformLocation(name);
+        int location = getUniformLocation(id);
         glUniformMatrix4fv(location, 1, false, &value[0][0]);
     }
 
-    void OpenglShader::setUniform(const std::string& name, uint32_t count, const int* values)
+    void OpenglShader::setUniform(UniformId id, uint32_t count, const int* values)
     {
-        int location = getUniformLocation(name);
+        int location = getUniformLocation(id);
         glUniform1iv(location, count, (GLint*)values);
     }
 
-    void OpenglShader::setUniform(const std::string& name, uint32_t count, const uint32_t* values)
+    void OpenglShader::setUniform(UniformId id, uint32_t count, const uint32_t* values)
     {
-        int location = getUniformLocation(name);
+        int location = getUniformLocation(id);
         glUniform1uiv(location, count, (GLuint*)values);
     }
 
-    void OpenglShader::setUniform(const std::string& name, uint32_t count, const float* values)
+    void OpenglShader::setUniform(UniformId id, uint32_t count, const float* values)
     {
-        int location = getUniformLocation(name);
+        int location = getUniformLocation(id);
         glUniform1fv(location, count, (GLfloat*)values);
     }
 
-    void OpenglShader::setUniform(const std::string& name, uint32_t count, const glm::vec3* values)
+    void OpenglShader::setUniform(UniformId id, uint32_t count, const glm::vec3* values)
     {
-        int location = getUniformLocation(name);
+        int location = getUniformLocation(id);
         glUniform3fv(location, count, (GLfloat*)values);
     }
 
-    void OpenglShader::setUniform(const std::string& name, uint32_t count, const glm::vec4* values)
+    void OpenglShader::setUniform(UniformId id, uint32_t count, const glm::vec4* values)
     {
-        int location = getUniformLocation(name);
+        int location = getUniformLocation(id);
         glUniform4fv(location, count, (GLfloat*)values);
     }
 
-    void OpenglShader::bind() const { glUseProgram(m_program); }
-    void OpenglShader::unbind() const { glUseProgram(0); }
+    void OpenglShader::bind() const { OpenglStateCache::getInstance().useProgram(m_program); }
+    void OpenglShader::unbind() const { OpenglStateCache::getInstance().useProgram(0); }
     
 } // namespace comet
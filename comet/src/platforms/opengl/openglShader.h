@@ -2,6 +2,8 @@
 
 #include <comet/shader.h>
 
+#include <vector>
+
 namespace comet
 {
 
@@ -18,37 +20,60 @@ namespace comet
         virtual void validateProgram() override;
 
         // Uniform methods
+        using Shader::getUniformLocation;
+        using Shader::setUniform;
+
+        virtual int getUniformLocation(UniformId id) override;
+        virtual int getBlockBinding(UniformId id) const override;
+
         // scalars
-        virtual int getUniformLocation(const std::string& name) override;
-        virtual void setUniform(const std::string& name, int value) override;
-        virtual void setUniform(const std::string& name, uint32_t value) override;
-        virtual void setUniform(const std::string& name, float value) override;
-        virtual void setUniform(const std::string& name, const glm::vec2& value) override;
-        virtual void setUniform(const std::string& name, const glm::vec3& value) override;
-        virtual void setUniform(const std::string& name, const glm::vec4& value) override;
-        virtual void setUniform(const std::string& name, const glm::mat4& value) override;
+        virtual void setUniform(UniformId id, int value) override;
+        virtual void setUniform(UniformId id, uint32_t value) override;
+        virtual void setUniform(UniformId id, float value) override;
+        virtual void setUniform(UniformId id, const glm::vec2& value) override;
+        virtual void setUniform(UniformId id, const glm::vec3& value) override;
+        virtual void setUniform(UniformId id, const glm::vec4& value) override;
+        virtual void setUniform(UniformId id, const glm::mat4& value) override;
 
         // arrays
-        virtual void setUniform(const std::string& name, uint32_t count, const int* values) override;
-        virtual void setUniform(const std::string& name, uint32_t count, const uint32_t* values) override;
-        virtual void setUniform(const std::string& name, uint32_t count, const float* values) override;
-        virtual void setUniform(const std::string& name, uint32_t count, const glm::vec3* values) override;
-        virtual void setUniform(const std::string& name, uint32_t count, const glm::vec4* values) override;
+        virtual void setUniform(UniformId id, uint32_t count, const int* values) override;
+        virtual void setUniform(UniformId id, uint32_t count, const uint32_t* values) override;
+        virtual void setUniform(UniformId id, uint32_t count, const float* values) override;
+        virtual void setUniform(UniformId id, uint32_t count, const glm::vec3* values) override;
+        virtual void setUniform(UniformId id, uint32_t count, const glm::vec4* values) override;
 
         virtual void bind() const override;
         virtual void unbind() const override;
 
     private:
-        // Only Vertex, Fragment and Geometry shaders are managed for now
-        static const unsigned int NB_SHADERS = 3;
+        // Open addressing table (linear probing) of the reflected names hashes
+        struct ReflectedEntry
+        {
+            uint32_t hash{0};
+            int value{-1};
+            bool used{false};
+        };
+
+        void reflectProgram();
+        void reflectResources(uint32_t programInterface, std::vector<ReflectedEntry>& table);
+        static void insertEntry(std::vector<ReflectedEntry>& table, uint32_t hash, int value, const char* name);
+        static const ReflectedEntry* findEntry(const std::vector<ReflectedEntry>& table, uint32_t hash);
+
+    private:
+        // Only Vertex, Fragment, Geometry and Compute shaders are managed for now
+        static const unsigned int NB_SHADERS = 4;
 
         uint32_t m_program = 0;
         uint32_t m_numShaders = 0;
         uint32_t m_shaders[NB_SHADERS];
-        std::unordered_map<std::string, int> m_uniformLocationsCache;
+        std::vector<ReflectedEntry> m_uniformLocations;
+        std::vector<ReflectedEntry> m_blockBindings;
+        // Unknown uniforms are only reported once
+        std::vector<uint32_t> m_reportedUniforms;
 
         bool m_hasVertexShader{false};
         bool m_hasFragmentShader{false};
+        bool m_hasComputeShader{false};
     };
 
 } // namespace comet
@@ -0,0 +1,313 @@
+#include "openglStateCache.h"
+
+#include <glad/glad.h>
+
+namespace comet
+{
+
+    static int getBufferTargetIndex(uint32_t target)
+    {
+        switch (target)
+        {
+            case GL_ARRAY_BUFFER: return 0;
+            case GL_ELEMENT_ARRAY_BUFFER: return 1;
+            case GL_DRAW_INDIRECT_BUFFER: return 2;
+            case GL_COPY_READ_BUFFER: return 3;
+            case GL_COPY_WRITE_BUFFER: return 4;
+            case GL_UNIFORM_BUFFER: return 5;
+            case GL_SHADER_STORAGE_BUFFER: return 6;
+            case GL_PIXEL_UNPACK_BUFFER: return 7;
+        }
+
+        return -1;
+    }
+
+    static int getIndexedBufferTargetIndex(uint32_t target)
+    {
+        switch (target)
+        {
+            case GL_UNIFORM_BUFFER: return 0;
+            case GL_SHADER_STORAGE_BUFFER: return 1;
+        }
+
+        return -1;
+    }
+
+    static int getTextureTargetIndex(uint32_t target)
+    {
+        switch (target)
+        {
+            case GL_TEXTURE_2D: return 0;
+            case GL_TEXTURE_2D_ARRAY: return 1;
+            case GL_TEXTURE_2D_MULTISAMPLE: return 2;
+            case GL_TEXTURE_CUBE_MAP: return 3;
+        }
+
+        return -1;
+    }
+
+    bool OpenglStateCache::update(uint32_t& current, uint32_t value)
+    {
+        if (current == value)
+        {
+            m_counters.skippedCalls++;
+            return false;
+        }
+
+        current = value;
+        m_counters.issuedCalls++;
+        return true;
+    }
+
+    void OpenglStateCache::useProgram(uint32_t program)
+    {
+        if (update(m_program, program))
+        {
+            glUseProgram(program);
+        }
+    }
+
+    void OpenglStateCache::bindVertexArray(uint32_t vertexArray)
+    {
+        if (update(m_vertexArray, vertexArray))
+        {
+            glBindVertexArray(vertexArray);
+
+            // The element array buffer binding is part of the vertex array state
+            m_buffers[getBufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+        }
+    }
+
+    void OpenglStateCache::bindFramebuffer(uint32_t framebuffer)
+    {
+        if (update(m_framebuffer, framebuffer))
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        }
+    }
+
+    void OpenglStateCache::bindBuffer(uint32_t target, uint32_t buffer)
+    {
+        auto targetIndex = getBufferTargetIndex(target);
+        if (targetIndex < 0)
+        {
+            m_counters.issuedCalls++;
+            glBindBuffer(target, buffer);
+            return;
+        }
+
+        if (update(m_buffers[targetIndex], buffer))
+        {
+            glBindBuffer(target, buffer);
+        }
+    }
+
+    void OpenglStateCache::bindBufferRange(uint32_t target, uint32_t index, uint32_t buffer, size_t offset /*= 0*/, size_t size /*= 0*/)
+    {
+        auto targetIndex = getIndexedBufferTargetIndex(target);
+        if (targetIndex >= 0 && index < MAX_INDEXED_BINDINGS)
+        {
+            auto& range = m_indexedBuffers[targetIndex][index];
+            if (range.buffer == buffer && range.offset == offset && range.size == size)
+            {
+                m_counters.skippedCalls++;
+                return;
+            }
+            range = {buffer, offset, size};
+        }
+        m_counters.issuedCalls++;
+
+        if (size == 0)
+        {
+            glBindBufferBase(target, index, buffer);
+        }
+        else
+        {
+            glBindBufferRange(target, index, buffer, offset, size);
+        }
+
+        // The generic binding point is also modified
+        if (auto genericIndex = getBufferTargetIndex(target); genericIndex >= 0)
+        {
+            m_buffers[genericIndex] = buffer;
+        }
+    }
+
+    void OpenglStateCache::bindTexture(uint32_t target, uint32_t texture)
+    {
+        if (m_activeTextureUnit == UNKNOWN)
+        {
+            // The texture unit must be known to track the binding
+            bindTexture(0, target, texture);
+            return;
+        }
+
+        bindTexture(m_activeTextureUnit, target, texture);
+    }
+
+    void OpenglStateCache::bindTexture(uint32_t unit, uint32_t target, uint32_t texture)
+    {
+        auto targetIndex = getTextureTargetIndex(target);
+        if (targetIndex >= 0 && unit < MAX_TEXTURE_UNITS)
+        {
+            if (m_textures[unit][targetIndex] == texture)
+            {
+                m_counters.skippedCalls++;
+                return;
+            }
+            m_textures[unit][targetIndex] = texture;
+        }
+
+        if (update(m_activeTextureUnit, unit))
+        {
+            glActiveTexture(GL_TEXTURE0 + unit);
+        }
+
+        m_counters.issuedCalls++;
+        glBindTexture(target, texture);
+    }
+
+    void OpenglStateCache::setDepthTest(bool enabled)
+    {
+        if (update(m_depthTest, enabled))
+        {
+            if (enabled)
+            {
+                glEnable(GL_DEPTH_TEST);
+            }
+            else
+            {
+                glDisable(GL_DEPTH_TEST);
+            }
+        }
+    }
+
+    void OpenglStateCache::setDepthFunc(uint32_t func)
+    {
+        if (update(m_depthFunc, func))
+        {
+            glDepthFunc(func);
+        }
+    }
+
+    void OpenglStateCache::setDepthMask(bool enabled)
+    {
+        if (update(m_depthMask, enabled))
+        {
+            glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+        }
+    }
+
+    void OpenglStateCache::setColorMask(bool enabled)
+    {
+        if (update(m_colorMask, enabled))
+        {
+            auto mask = enabled ? GL_TRUE : GL_FALSE;
+            glColorMask(mask, mask, mask, mask);
+        }
+    }
+
+    void OpenglStateCache::onBufferDeleted(uint32_t buffer)
+    {
+        m_bufferDeletionCount++;
+
+        for (auto& boundBuffer : m_buffers)
+        {
+            if (boundBuffer == buffer)
+            {
+                boundBuffer = 0;
+            }
+        }
+
+        for (auto& indexedBuffers : m_indexedBuffers)
+        {
+            for (auto& range : indexedBuffers)
+            {
+                if (range.buffer == buffer)
+                {
+                    range = {0, 0, 0};
+                }
+            }
+        }
+    }
+
+    void OpenglStateCache::onTextureDeleted(uint32_t texture)
+    {
+        for (auto& unitTextures : m_textures)
+        {
+            for (auto& boundTexture : unitTextures)
+            {
+                if (boundTexture == texture)
+                {
+                    boundTexture = 0;
+                }
+            }
+        }
+    }
+
+    void OpenglStateCache::onVertexArrayDeleted(uint32_t vertexArray)
+    {
+        if (m_vertexArray == vertexArray)
+        {
+            m_vertexArray = 0;
+            m_buffers[getBufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+        }
+    }
+
+    void OpenglStateCache::onElementBufferChanged(uint32_t vertexArray)
+    {
+        if (m_vertexArray == vertexArray)
+        {
+            m_buffers[getBufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+        }
+    }
+
+    void OpenglStateCache::onProgramDeleted(uint32_t program)
+    {
+        // A program deleted while in use stays in use: only forget it
+        if (m_program == program)
+        {
+            m_program = UNKNOWN;
+        }
+    }
+
+    void OpenglStateCache::onFramebufferDeleted(uint32_t framebuffer)
+    {
+        if (m_framebuffer == framebuffer)
+        {
+            m_framebuffer = 0;
+        }
+    }
+
+    void OpenglStateCache::invalidate()
+    {
+        m_program = UNKNOWN;
+        m_vertexArray = UNKNOWN;
+        m_framebuffer = UNKNOWN;
+        for (auto& buffer : m_buffers)
+        {
+            buffer = UNKNOWN;
+        }
+        for (auto& indexedBuffers : m_indexedBuffers)
+        {
+            for (auto& range : indexedBuffers)
+            {
+                range = {UNKNOWN, 0, 0};
+            }
+        }
+        m_activeTextureUnit = UNKNOWN;
+        for (auto& unitTextures : m_textures)
+        {
+            for (auto& texture : unitTextures)
+            {
+                texture = UNKNOWN;
+            }
+        }
+
+        m_depthTest = UNKNOWN;
+        m_depthFunc = UNKNOWN;
+        m_depthMask = UNKNOWN;
+        m_colorMask = UNKNOWN;
+    }
+
+} // namespace comet
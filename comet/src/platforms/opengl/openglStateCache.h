@@ -0,0 +1,97 @@
+#pragma once
+
+#include <comet/singleton.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace comet
+{
+
+    // Shadow copy of the OpenGL context state: the calls that would not change the current state are skipped.
+    // Every bind of the OpenGL backend goes through it (code calling OpenGL directly must call invalidate()).
+    class OpenglStateCache : public Singleton<OpenglStateCache>
+    {
+    public:
+        struct Counters
+        {
+            uint32_t issuedCalls{0};
+            uint32_t skippedCalls{0};
+        };
+
+        OpenglStateCache() { invalidate(); }
+
+        void useProgram(uint32_t program);
+        void bindVertexArray(uint32_t vertexArray);
+        void bindFramebuffer(uint32_t framebuffer);
+
+        void bindBuffer(uint32_t target, uint32_t buffer);
+        // Uniform and shader storage binding points (size 0 binds the whole buffer)
+        void bindBufferRange(uint32_t target, uint32_t index, uint32_t buffer, size_t offset = 0, size_t size = 0);
+
+        // Binds the texture to the given unit, or to the active one
+        void bindTexture(uint32_t target, uint32_t texture);
+        void bindTexture(uint32_t unit, uint32_t target, uint32_t texture);
+
+        void setDepthTest(bool enabled);
+        void setDepthFunc(uint32_t func);
+        void setDepthMask(bool enabled);
+        void setColorMask(bool enabled);
+
+        // The deleted objects names can be reused by OpenGL: they must not be considered bound anymore
+        void onBufferDeleted(uint32_t buffer);
+        void onTextureDeleted(uint32_t texture);
+        void onVertexArrayDeleted(uint32_t vertexArray);
+        // The element array buffer of a vertex array was modified with Direct State Access
+        void onElementBufferChanged(uint32_t vertexArray);
+        void onProgramDeleted(uint32_t program);
+        void onFramebufferDeleted(uint32_t framebuffer);
+
+        // Incremented on each buffer deletion: the vertex arrays attachments recorded by name must be checked again,
+        // a new buffer object can reuse the name of a deleted one
+        uint32_t getBufferDeletionCount() const { return m_bufferDeletionCount; }
+
+        // Forget all the state (after third party code changed it)
+        void invalidate();
+
+        const Counters& getCounters() const { return m_counters; }
+        void resetCounters() { m_counters = {}; }
+
+    private:
+        // Returns true if the call must be issued, and records the new value
+        bool update(uint32_t& current, uint32_t value);
+
+    private:
+        static constexpr uint32_t UNKNOWN = 0xFFFFFFFF;
+        static constexpr uint32_t BUFFER_TARGETS = 8;
+        static constexpr uint32_t INDEXED_BUFFER_TARGETS = 2;
+        static constexpr uint32_t MAX_INDEXED_BINDINGS = 16;
+        static constexpr uint32_t TEXTURE_TARGETS = 4;
+        static constexpr uint32_t MAX_TEXTURE_UNITS = 32;
+
+        struct BufferRange
+        {
+            uint32_t buffer;
+            size_t offset;
+            size_t size;
+        };
+
+        uint32_t m_program;
+        uint32_t m_vertexArray;
+        uint32_t m_framebuffer;
+        uint32_t m_buffers[BUFFER_TARGETS];
+        BufferRange m_indexedBuffers[INDEXED_BUFFER_TARGETS][MAX_INDEXED_BINDINGS];
+        uint32_t m_activeTextureUnit;
+        uint32_t m_textures[MAX_TEXTURE_UNITS][TEXTURE_TARGETS];
+
+        uint32_t m_depthTest;
+        uint32_t m_depthFunc;
+        uint32_t m_depthMask;
+        uint32_t m_colorMask;
+
+        uint32_t m_bufferDeletionCount{0};
+
+        Counters m_counters;
+    };
+
+} // namespace comet
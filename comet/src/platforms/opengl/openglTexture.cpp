@@ -1,20 +1,125 @@
 #include "openglTexture.h"
+#include "openglStateCache.h"
+#include "openglTextureStreamer.h"
 
+#include <comet/textureRegistry.h>
 #include <comet/resourceManager.h>
 #include <comet/log.h>
 #include <comet/assert.h>
 
-#include <fstream>
+#include <algorithm>
 
-#include <stb/stb_image.h>
 #include <glad/glad.h>
 
 namespace comet
 {
 
+    static GLint getMinFilter(const SamplerDescription& samplerDescription, uint32_t levelCount)
+    {
+        bool linear = samplerDescription.minFilter == TextureFilter::LINEAR;
+        if (levelCount <= 1)
+        {
+            return linear ? GL_LINEAR : GL_NEAREST;
+        }
+
+        if (samplerDescription.mipmapFilter == TextureFilter::LINEAR)
+        {
+            return linear ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST_MIPMAP_LINEAR;
+        }
+        return linear ? GL_LINEAR_MIPMAP_NEAREST : GL_NEAREST_MIPMAP_NEAREST;
+    }
+
+    static GLint getWrap(TextureWrap wrap)
+    {
+        switch (wrap)
+        {
+            case TextureWrap::REPEAT: return GL_REPEAT;
+            case TextureWrap::MIRRORED_REPEAT: return GL_MIRRORED_REPEAT;
+            case TextureWrap::CLAMP_TO_EDGE: return GL_CLAMP_TO_EDGE;
+        }
+
+        return GL_REPEAT;
+    }
+
+    static float getMaxSupportedAnisotropy()
+    {
+        static float maxSupportedAnisotropy = []()
+        {
+            GLfloat maxAnisotropy{1.0f};
+            glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &maxAnisotropy);
+            return std::max(maxAnisotropy, 1.0f);
+        }();
+        return maxSupportedAnisotropy;
+    }
+
+    static void applySamplerDescription(uint32_t textureId, const SamplerDescription& samplerDescription, uint32_t levelCount)
+    {
+        auto wrap = getWrap(samplerDescription.wrap);
+        glTextureParameteri(textureId, GL_TEXTURE_WRAP_S, wrap);
+        glTextureParameteri(textureId, GL_TEXTURE_WRAP_T, wrap);
+        glTextureParameteri(textureId, GL_TEXTURE_MIN_FILTER, getMinFilter(samplerDescription, levelCount));
+        glTextureParameteri(textureId, GL_TEXTURE_MAG_FILTER, samplerDescription.magFilter == TextureFilter::LINEAR ? GL_LINEAR : GL_NEAREST);
+        glTextureParameteri(textureId, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+        auto maxAnisotropy = std::clamp(samplerDescription.maxAnisotropy, 1.0f, getMaxSupportedAnisotropy());
+        glTextureParameterf(textureId, GL_TEXTURE_MAX_ANISOTROPY, maxAnisotropy);
+    }
+
+    // The levels of the compressed images can't be generated: only the ones stored in the file are allocated
+    static uint32_t getLevelCount(const SamplerDescription& samplerDescription, const DecodedImage& image)
+    {
+        if (!samplerDescription.mipmaps)
+        {
+            return 1;
+        }
+
+        auto levelCount = Texture::getMipLevelCount(image.width, image.height);
+        if (image.format != TextureFormat::RGBA8)
+        {
+            levelCount = std::min(levelCount, static_cast<uint32_t>(image.levels.size()));
+        }
+        return levelCount;
+    }
 
+    // 'levelCount' levels of the source, from 'srcLevel' ('width' x 'height'), to the destination levels from 'dstLevel'
+    static void copyTextureLevels(uint32_t target, uint32_t srcTextureId, uint32_t srcLevel, uint32_t dstTextureId, uint32_t dstLevel,
+                                  uint32_t levelCount, uint32_t width, uint32_t height, uint32_t depth)
+    {
+        for (uint32_t level = 0; level < levelCount; ++level)
+        {
+            glCopyImageSubData(srcTextureId, target, srcLevel + level, 0, 0, 0,
+                               dstTextureId, target, dstLevel + level, 0, 0, 0,
+                               std::max(width >> level, 1u), std::max(height >> level, 1u), depth);
+        }
+    }
+
+    static size_t getLevelsSize(TextureFormat format, uint32_t width, uint32_t height, uint32_t levelCount)
+    {
+        size_t size{0};
+        for (uint32_t level = 0; level < levelCount; ++level)
+        {
+            size += getTextureFormatLevelSize(format, std::max(width >> level, 1u), std::max(height >> level, 1u));
+        }
+        return size;
+    }
+
+    uint32_t getOpenglInternalFormat(TextureFormat format)
+    {
+        switch (format)
+        {
+            case TextureFormat::RGBA8: return GL_RGBA8;
+            case TextureFormat::BC1: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+            case TextureFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            case TextureFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+            case TextureFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+        }
+
+        return GL_RGBA8;
+    }
+
+    // OpenglTexture2D
     OpenglTexture2D::OpenglTexture2D(uint32_t textureId)
-        : m_textureId(textureId), m_isProxy{true} {}
+        : m_textureId(textureId), m_isResident{true}, m_isProxy{true} {}
 
     OpenglTexture2D::OpenglTexture2D(const char* filename /*= nullptr*/)
     {
@@ -22,6 +127,7 @@ namespace comet
         {
             auto textureResourcePath = ResourceManager::getInstance().getResourcePath(ResourceType::TEXTURE, filename);
             m_filepath = textureResourcePath.string();
+            TextureResidencyManager::getInstance().registerTexture(this);
             load();
         }
     }
@@ -29,13 +135,39 @@ namespace comet
  	OpenglTexture2D::OpenglTexture2D(OpenglTexture2D&& other)
         : m_textureId(std::move(other.m_textureId)),
         m_width(std::move(other.m_width)),
-        m_height(std::move(other.m_height))
+        m_height(std::move(other.m_height)),
+        m_levelCount(std::move(other.m_levelCount)),
+        m_droppedLevelCount(std::move(other.m_droppedLevelCount)),
+        m_baseLevel(std::move(other.m_baseLevel)),
+        m_format(std::move(other.m_format)),
+        m_samplerDescription(std::move(other.m_samplerDescription)),
+        m_filepath(std::move(other.m_filepath)),
+        m_isResident(std::move(other.m_isResident)),
+        m_isEvicted(std::move(other.m_isEvicted)),
+        m_isProxy(std::move(other.m_isProxy))
     {
         other.m_textureId = 0;
+        other.m_isResident = false;
+
+        auto& residencyManager = TextureResidencyManager::getInstance();
+        residencyManager.unregisterTexture(&other);
+        if (!m_filepath.empty())
+        {
+            residencyManager.registerTexture(this);
+        }
+
+        // The streaming callbacks are bound to the other texture
+        if (other.m_streamRequest)
+        {
+            other.m_streamRequest->cancel();
+            other.m_streamRequest.reset();
+            load();
+        }
     }
 
  	OpenglTexture2D::~OpenglTexture2D()
     {
+        TextureResidencyManager::getInstance().unregisterTexture(this);
         if (!m_isProxy)
             cleanUp();
     }
@@ -51,110 +183,425 @@ namespace comet
         m_textureId = std::move(other.m_textureId);
         m_width = std::move(other.m_width);
         m_height = std::move(other.m_height);
+        m_levelCount = std::move(other.m_levelCount);
+        m_droppedLevelCount = std::move(other.m_droppedLevelCount);
+        m_baseLevel = std::move(other.m_baseLevel);
+        m_format = std::move(other.m_format);
+        m_samplerDescription = std::move(other.m_samplerDescription);
+        m_filepath = std::move(other.m_filepath);
+        m_isResident = std::move(other.m_isResident);
+        m_isEvicted = std::move(other.m_isEvicted);
+        m_isProxy = std::move(other.m_isProxy);
 
         other.m_textureId = 0;
+        other.m_isResident = false;
+
+        auto& residencyManager = TextureResidencyManager::getInstance();
+        residencyManager.unregisterTexture(&other);
+        if (!m_filepath.empty())
+        {
+            residencyManager.registerTexture(this);
+        }
+
+        if (other.m_streamRequest)
+        {
+            other.m_streamRequest->cancel();
+            other.m_streamRequest.reset();
+            load();
+        }
+
+        return *this;
     }
 
     void OpenglTexture2D::makeItWhite()
     {
         cleanUp();
         glCreateTextures(GL_TEXTURE_2D, 1, &m_textureId);
-        glBindTexture(GL_TEXTURE_2D, m_textureId);
         m_width = 1;
         m_height = 1;
+        m_levelCount = 1;
+        m_samplerDescription.minFilter = TextureFilter::NEAREST;
+        m_samplerDescription.mipmaps = false;
         glTextureStorage2D(m_textureId, 1, GL_RGB8, m_width, m_height);
-        
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        applySamplerDescription(m_textureId, m_samplerDescription, m_levelCount);
 
         uint32_t whitePixel = 0xFFFFFFFF;
         glTextureSubImage2D(m_textureId, 0, 0, 0, m_width, m_height, GL_RGB, GL_UNSIGNED_BYTE, &whitePixel);
+        m_isResident = true;
     }
 
     void OpenglTexture2D::cleanUp()
+    {
+        if (m_streamRequest)
+        {
+            m_streamRequest->cancel();
+            m_streamRequest.reset();
+        }
+
+        releaseStorage();
+    }
+
+    void OpenglTexture2D::releaseStorage()
     {
         if (m_textureId)
         {
+            OpenglStateCache::getInstance().onTextureDeleted(m_textureId);
             glDeleteTextures(1, &m_textureId);
             m_textureId = 0;
         }
+        m_droppedLevelCount = 0;
+        m_baseLevel = 0;
+        m_isResident = false;
     }
 
-    // OpenglTexture2D
     void OpenglTexture2D::load()
     {
         cleanUp();
-		std::ifstream ifs(m_filepath);
-		if (ifs.fail())
+        m_isEvicted = false;
+        if (m_filepath.empty())
         {
-            CM_CORE_LOG_ERROR("Failed loading texture file {}", m_filepath);
             return;
-		}
+        }
 
-		if (ifs)
-        {
-            int width, height, channels;
-            stbi_set_flip_vertically_on_load(1);
-            auto data = stbi_load(m_filepath.c_str(), &width, &height, &channels, 0);
-            ASSERT(data, "Failed to load texture");
-            m_width = width;
-            m_height = height;
+        requestImage();
+    }
 
-            GLenum internalFormat, fileFormat;
-            if (channels == 3)
-            {
-                internalFormat = GL_RGB8;
-                fileFormat = GL_RGB;
-            }
-            else if (channels == 4)
-            {  
-                internalFormat = GL_RGBA8;
-                fileFormat = GL_RGBA;
-            }
-            else
-            {
-                CM_CORE_LOG_ERROR("Image with {} channels is not a supported format (in file {})", channels, m_filepath);
-                return;
-            }
+    void OpenglTexture2D::requestImage()
+    {
+        m_streamRequest = OpenglTextureStreamer::getInstance().request(m_filepath, m_samplerDescription.mipmaps,
+            [this](TextureStreamRequest& request, const DecodedImage& image) { onDecoded(request, image); },
+            [this](TextureStreamRequest& request) { onUploaded(request); });
+    }
+
+    void OpenglTexture2D::onDecoded(TextureStreamRequest& request, const DecodedImage& image)
+    {
+        if (!image.isValid())
+        {
+            m_streamRequest.reset();
+            return;
+        }
 
+        // The storage is kept when its dropped levels are streamed back (see restore())
+        auto levelCount = getLevelCount(m_samplerDescription, image);
+        if (!m_textureId || image.width != m_width || image.height != m_height || image.format != m_format || levelCount != m_levelCount)
+        {
+            releaseStorage();
+            m_width = image.width;
+            m_height = image.height;
+            m_format = image.format;
+            m_levelCount = levelCount;
             glCreateTextures(GL_TEXTURE_2D, 1, &m_textureId);
-            glBindTexture(GL_TEXTURE_2D, m_textureId);
-            glTextureStorage2D(m_textureId, 1, internalFormat, m_width, m_height);
-            
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTextureStorage2D(m_textureId, m_levelCount, getOpenglInternalFormat(m_format), m_width, m_height);
+            applySamplerDescription(m_textureId, m_samplerDescription, m_levelCount);
+        }
+
+        request.setDestination(m_textureId, 0, false, m_levelCount);
+    }
+
+    void OpenglTexture2D::onUploaded(TextureStreamRequest& request)
+    {
+        if (m_baseLevel)
+        {
+            glTextureParameteri(m_textureId, GL_TEXTURE_BASE_LEVEL, 0);
+            m_baseLevel = 0;
+        }
+
+        // Fallback when the mip levels were not generated with the image
+        if (request.getLevelCount() < m_levelCount)
+        {
+            glGenerateTextureMipmap(m_textureId);
+        }
+
+        m_isResident = true;
+        m_streamRequest.reset();
+    }
+
+    size_t OpenglTexture2D::getResidentSize() const
+    {
+        if (!m_textureId || m_isProxy)
+        {
+            return 0;
+        }
+
+        return getLevelsSize(m_format, std::max(m_width >> m_droppedLevelCount, 1u), std::max(m_height >> m_droppedLevelCount, 1u),
+                             m_levelCount - m_droppedLevelCount);
+    }
 
-            glTextureSubImage2D(m_textureId, 0, 0, 0, m_width, m_height, fileFormat, GL_UNSIGNED_BYTE, data);
+    bool OpenglTexture2D::dropTopLevel(uint32_t minTopLevelSize)
+    {
+        if (m_streamRequest || !m_isResident || m_baseLevel)
+        {
+            return false;
+        }
 
-            stbi_image_free(data);
+        auto levelCount = m_levelCount - m_droppedLevelCount - 1;
+        auto width = std::max(m_width >> (m_droppedLevelCount + 1), 1u);
+        auto height = std::max(m_height >> (m_droppedLevelCount + 1), 1u);
+        if (levelCount == 0 || std::max(width, height) < minTopLevelSize)
+        {
+            return false;
+        }
+
+        uint32_t textureId{0};
+        glCreateTextures(GL_TEXTURE_2D, 1, &textureId);
+        glTextureStorage2D(textureId, levelCount, getOpenglInternalFormat(m_format), width, height);
+        applySamplerDescription(textureId, m_samplerDescription, levelCount);
+        copyTextureLevels(GL_TEXTURE_2D, m_textureId, 1, textureId, 0, levelCount, width, height, 1);
+
+        OpenglStateCache::getInstance().onTextureDeleted(m_textureId);
+        glDeleteTextures(1, &m_textureId);
+        m_textureId = textureId;
+        m_droppedLevelCount++;
+
+        return true;
+    }
+
+    bool OpenglTexture2D::evict()
+    {
+        if (m_streamRequest || !m_isResident)
+        {
+            return false;
+        }
+
+        releaseStorage();
+        m_isEvicted = true;
+        return true;
+    }
+
+    // The levels kept are copied to the full texture and sampled until the file is streamed again
+    void OpenglTexture2D::restore()
+    {
+        if (m_streamRequest || m_filepath.empty())
+        {
+            return;
+        }
+
+        if (m_isEvicted)
+        {
+            load();
+            return;
+        }
+
+        if (!m_droppedLevelCount)
+        {
+            return;
+        }
+
+        uint32_t textureId{0};
+        glCreateTextures(GL_TEXTURE_2D, 1, &textureId);
+        glTextureStorage2D(textureId, m_levelCount, getOpenglInternalFormat(m_format), m_width, m_height);
+        applySamplerDescription(textureId, m_samplerDescription, m_levelCount);
+        copyTextureLevels(GL_TEXTURE_2D, m_textureId, 0, textureId, m_droppedLevelCount, m_levelCount - m_droppedLevelCount,
+                          std::max(m_width >> m_droppedLevelCount, 1u), std::max(m_height >> m_droppedLevelCount, 1u), 1);
+        glTextureParameteri(textureId, GL_TEXTURE_BASE_LEVEL, m_droppedLevelCount);
+
+        OpenglStateCache::getInstance().onTextureDeleted(m_textureId);
+        glDeleteTextures(1, &m_textureId);
+        m_textureId = textureId;
+        m_baseLevel = m_droppedLevelCount;
+        m_droppedLevelCount = 0;
+
+        requestImage();
+    }
+
+    void OpenglTexture2D::setSamplerDescription(const SamplerDescription& samplerDescription)
+    {
+        bool mipmapsChanged = samplerDescription.mipmaps != m_samplerDescription.mipmaps;
+        m_samplerDescription = samplerDescription;
+
+        if (mipmapsChanged && (m_textureId || m_streamRequest || m_isEvicted) && !m_filepath.empty())
+        {
+            load();
+        }
+        else if (m_textureId)
+        {
+            applySamplerDescription(m_textureId, m_samplerDescription, m_levelCount - m_droppedLevelCount);
         }
     }
 
     void OpenglTexture2D::bind(uint32_t textureSlot /*= 0*/) const
     {
-		glActiveTexture(GL_TEXTURE0 + textureSlot);
-		glBindTexture(GL_TEXTURE_2D, m_textureId);
+        TextureResidencyManager::getInstance().markUsed(this);
+
+        // Placeholder until the pixels are uploaded (or once evicted)
+        if (!m_isResident)
+        {
+            TextureRegistry::getInstance().getWhiteTexture2D()->bind(textureSlot);
+            return;
+        }
+
+        OpenglStateCache::getInstance().bindTexture(textureSlot, GL_TEXTURE_2D, m_textureId);
     }
 
     void OpenglTexture2D::unbind() const
     {
-        glBindTexture(GL_TEXTURE_2D, 0);
+        OpenglStateCache::getInstance().bindTexture(GL_TEXTURE_2D, 0);
+    }
+
+
+    // OpenglTextureArrayStorage
+    void OpenglTextureArrayStorage::define(uint32_t width, uint32_t height, TextureFormat format, uint32_t levelCount)
+    {
+        ASSERT(m_textureId == 0, "The layers of an allocated texture array can't be redefined");
+        m_width = width;
+        m_height = height;
+        m_format = format;
+        m_levelCount = levelCount;
+    }
+
+    bool OpenglTextureArrayStorage::matches(uint32_t width, uint32_t height, TextureFormat format, uint32_t levelCount) const
+    {
+        return m_width == width && m_height == height && m_format == format && m_levelCount == levelCount;
+    }
+
+    bool OpenglTextureArrayStorage::reserve(uint32_t layerCount, const SamplerDescription& samplerDescription)
+    {
+        ASSERT(m_droppedLevelCount == 0, "The dropped levels of a texture array must be restored before it grows");
+        if (layerCount <= m_layerCapacity)
+        {
+            return false;
+        }
+
+        auto layerCapacity = std::max(layerCount, 2 * m_layerCapacity);
+        uint32_t textureId{0};
+        glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &textureId);
+        glTextureStorage3D(textureId, m_levelCount, getOpenglInternalFormat(m_format), m_width, m_height, layerCapacity);
+        applyTextureParameters(textureId, samplerDescription);
+
+        if (m_textureId)
+        {
+            // Layers partially uploaded are copied too, their remaining rows go to the new texture
+            copyTextureLevels(GL_TEXTURE_2D_ARRAY, m_textureId, 0, textureId, 0, m_levelCount, m_width, m_height, m_layerCapacity);
+
+            OpenglStateCache::getInstance().onTextureDeleted(m_textureId);
+            glDeleteTextures(1, &m_textureId);
+        }
+
+        m_textureId = textureId;
+        m_layerCapacity = layerCapacity;
+        return true;
+    }
+
+    void OpenglTextureArrayStorage::release()
+    {
+        if (m_textureId)
+        {
+            OpenglStateCache::getInstance().onTextureDeleted(m_textureId);
+            glDeleteTextures(1, &m_textureId);
+            m_textureId = 0;
+        }
+        m_droppedLevelCount = 0;
+        m_baseLevel = 0;
+        m_layerCapacity = 0;
+    }
+
+    bool OpenglTextureArrayStorage::dropTopLevel(const SamplerDescription& samplerDescription, uint32_t minTopLevelSize)
+    {
+        if (!m_textureId || m_baseLevel)
+        {
+            return false;
+        }
+
+        auto levelCount = m_levelCount - m_droppedLevelCount - 1;
+        auto width = std::max(m_width >> (m_droppedLevelCount + 1), 1u);
+        auto height = std::max(m_height >> (m_droppedLevelCount + 1), 1u);
+        if (levelCount == 0 || std::max(width, height) < minTopLevelSize)
+        {
+            return false;
+        }
+
+        uint32_t textureId{0};
+        glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &textureId);
+        glTextureStorage3D(textureId, levelCount, getOpenglInternalFormat(m_format), width, height, m_layerCapacity);
+        m_droppedLevelCount++;
+        applyTextureParameters(textureId, samplerDescription);
+        copyTextureLevels(GL_TEXTURE_2D_ARRAY, m_textureId, 1, textureId, 0, levelCount, width, height, m_layerCapacity);
+
+        OpenglStateCache::getInstance().onTextureDeleted(m_textureId);
+        glDeleteTextures(1, &m_textureId);
+        m_textureId = textureId;
+
+        return true;
+    }
+
+    void OpenglTextureArrayStorage::restoreTopLevels(const SamplerDescription& samplerDescription)
+    {
+        if (!m_textureId || !m_droppedLevelCount)
+        {
+            return;
+        }
+
+        uint32_t textureId{0};
+        glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &textureId);
+        glTextureStorage3D(textureId, m_levelCount, getOpenglInternalFormat(m_format), m_width, m_height, m_layerCapacity);
+        copyTextureLevels(GL_TEXTURE_2D_ARRAY, m_textureId, 0, textureId, m_droppedLevelCount, m_levelCount - m_droppedLevelCount,
+                          std::max(m_width >> m_droppedLevelCount, 1u), std::max(m_height >> m_droppedLevelCount, 1u), m_layerCapacity);
+
+        OpenglStateCache::getInstance().onTextureDeleted(m_textureId);
+        glDeleteTextures(1, &m_textureId);
+        m_textureId = textureId;
+        m_baseLevel = m_droppedLevelCount;
+        m_droppedLevelCount = 0;
+        applyTextureParameters(m_textureId, samplerDescription);
+    }
+
+    void OpenglTextureArrayStorage::resetBaseLevel()
+    {
+        if (m_textureId && m_baseLevel)
+        {
+            glTextureParameteri(m_textureId, GL_TEXTURE_BASE_LEVEL, 0);
+        }
+        m_baseLevel = 0;
+    }
+
+    size_t OpenglTextureArrayStorage::getSize() const
+    {
+        if (!m_textureId)
+        {
+            return 0;
+        }
+
+        return m_layerCapacity * getLevelsSize(m_format, std::max(m_width >> m_droppedLevelCount, 1u),
+                                               std::max(m_height >> m_droppedLevelCount, 1u), m_levelCount - m_droppedLevelCount);
+    }
+
+    void OpenglTextureArrayStorage::applyTextureParameters(uint32_t textureId, const SamplerDescription& samplerDescription) const
+    {
+        comet::applySamplerDescription(textureId, samplerDescription, m_levelCount - m_droppedLevelCount);
+        if (m_baseLevel)
+        {
+            glTextureParameteri(textureId, GL_TEXTURE_BASE_LEVEL, m_baseLevel);
+        }
+    }
+
+    void OpenglTextureArrayStorage::applySamplerDescription(const SamplerDescription& samplerDescription)
+    {
+        if (m_textureId)
+        {
+            applyTextureParameters(m_textureId, samplerDescription);
+        }
+    }
+
+    // Generated from the base level: not while the dropped levels are streamed back
+    void OpenglTextureArrayStorage::generateMipmaps()
+    {
+        if (m_textureId && m_levelCount > 1 && m_format == TextureFormat::RGBA8)
+        {
+            glGenerateTextureMipmap(m_textureId);
+        }
     }
 
 
     // OpenglTexture2DArray
  	OpenglTexture2DArray::OpenglTexture2DArray(OpenglTexture2DArray&& other)
-        : m_textureId(std::move(other.m_textureId)),
-        m_width(std::move(other.m_width)),
-        m_height(std::move(other.m_height)),
-        m_filepaths(std::move(other.m_filepaths)),
-        m_needToLoadTextureArray(std::move(other.m_needToLoadTextureArray))
+        : m_samplerDescription(std::move(other.m_samplerDescription)),
+        m_filepaths(std::move(other.m_filepaths))
     {
-        other.m_textureId = 0;
+        // The streaming callbacks are bound to the other array: the layers are streamed again
+        other.cleanUp();
+        m_residentLayers.resize(m_filepaths.size(), false);
+        m_streamRequests.resize(m_filepaths.size());
+        m_needToLoadTextureArray = !m_filepaths.empty();
     }
 
  	OpenglTexture2DArray::~OpenglTexture2DArray()
@@ -170,120 +617,472 @@ namespace comet
         }
         
         cleanUp();
-        m_textureId = std::move(other.m_textureId);
-        m_width = std::move(other.m_width);
-        m_height = std::move(other.m_height);
+        m_samplerDescription = std::move(other.m_samplerDescription);
         m_filepaths = std::move(other.m_filepaths);
-        m_needToLoadTextureArray = std::move(other.m_needToLoadTextureArray);
+        other.cleanUp();
+        m_residentLayers.assign(m_filepaths.size(), false);
+        m_streamRequests.assign(m_filepaths.size(), nullptr);
+        m_needToLoadTextureArray = !m_filepaths.empty();
 
-        other.m_textureId = 0;
+        return *this;
+    }
+
+    void OpenglTexture2DArray::cancelRequests()
+    {
+        for (auto& streamRequest : m_streamRequests)
+        {
+            if (streamRequest)
+            {
+                streamRequest->cancel();
+                streamRequest.reset();
+            }
+        }
     }
 
     void OpenglTexture2DArray::cleanUp()
     {
-        if (m_textureId)
+        cancelRequests();
+        m_storage.release();
+
+        if (std::find(m_residentLayers.begin(), m_residentLayers.end(), true) != m_residentLayers.end())
         {
-            glDeleteTextures(1, &m_textureId);
-            m_textureId = 0;
+            m_residencyVersion++;
         }
+        m_residentLayers.assign(m_filepaths.size(), false);
+        m_needToLoadTextureArray = !m_filepaths.empty();
     }
 
+    // Only the layers that are not resident or streaming yet are requested
 	void OpenglTexture2DArray::load()
     {
-        cleanUp();
-        bool firstTextureFile{true};
-        uint32_t referenceChannels;
-        
-        stbi_set_flip_vertically_on_load(1);
-
-        uint32_t textureIndex{0};
-        for (auto filepath : m_filepaths)
+        for (uint32_t index = 0; index < m_filepaths.size(); ++index)
         {
-            std::ifstream ifs(filepath);
-            if (ifs.fail())
+            if (!m_residentLayers[index] && !m_streamRequests[index])
             {
-                CM_CORE_LOG_ERROR("Failed loading texture file {}", filepath);
-                return;
+                requestLayer(index);
             }
+        }
 
-            if (ifs)
-            {
-                int width, height, channels;
-                GLenum internalFormat, fileFormat;
-                auto data = stbi_load(filepath.c_str(), &width, &height, &channels, 0);
-                ASSERT(data);
+        m_needToLoadTextureArray = false;
+    }
 
-                // Creation, Allocation and Sampler Parameter setup is done only on the first loaded texture
-                if (firstTextureFile)
-                {
-                    firstTextureFile = false;
-                    m_width = width;
-                    m_height = height;
-
-                    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &m_textureId);
-                    glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureId);
-
-                    if (channels == 3)
-                    {
-                        internalFormat = GL_RGB8;
-                        fileFormat = GL_RGB;
-                    }
-                    else if (channels == 4)
-                    {  
-                        internalFormat = GL_RGBA8;
-                        fileFormat = GL_RGBA;
-                    }
-                    else
-                    {
-                        CM_CORE_LOG_ERROR("Image with {} channels is not a supported format (check file {})", channels, filepath);
-                        return;
-                    }
-
-                    referenceChannels = channels;
-                    glTextureStorage3D(m_textureId, 1, internalFormat, m_width, m_height, m_filepaths.size());
-
-                    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
-                    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
-                    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-                }
-                
-                if (m_width != width || m_height != height || channels != referenceChannels)
+    void OpenglTexture2DArray::requestLayer(uint32_t index)
+    {
+        m_streamRequests[index] = OpenglTextureStreamer::getInstance().request(m_filepaths[index], m_samplerDescription.mipmaps,
+            [this, index](TextureStreamRequest& request, const DecodedImage& image) { onLayerDecoded(request, index, image); },
+            [this, index](TextureStreamRequest& request) { onLayerUploaded(request, index); });
+    }
+
+    void OpenglTexture2DArray::onLayerDecoded(TextureStreamRequest& request, uint32_t index, const DecodedImage& image)
+    {
+        if (!image.isValid())
+        {
+            m_streamRequests[index].reset();
+            return;
+        }
+
+        // The first decoded image defines the size, format and levels of the layers
+        auto levelCount = getLevelCount(m_samplerDescription, image);
+        if (!m_storage.getTextureId())
+        {
+            m_storage.define(image.width, image.height, image.format, levelCount);
+        }
+
+        if (!m_storage.matches(image.width, image.height, image.format, levelCount))
+        {
+            CM_CORE_LOG_ERROR("All images must have the same size ({} x {}), format and number of levels (check file {})",
+                              m_storage.getWidth(), m_storage.getHeight(), request.getFilepath());
+            m_streamRequests[index].reset();
+            return;
+        }
+
+        if (m_storage.reserve(std::max<uint32_t>(index + 1, m_filepaths.size()), m_samplerDescription))
+        {
+            for (uint32_t layer = 0; layer < m_streamRequests.size(); ++layer)
+            {
+                if (m_streamRequests[layer])
                 {
-                    CM_CORE_LOG_ERROR("All images must have the same size and number of channels ({} x {} x {}) (check file {})",
-                                        m_width, m_height, referenceChannels, filepath);
-                    return;
+                    m_streamRequests[layer]->setDestination(m_storage.getTextureId(), layer, true, m_storage.getLevelCount());
                 }
+            }
+        }
 
-                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, textureIndex, m_width, m_height, 1, fileFormat, GL_UNSIGNED_BYTE, data);
-                textureIndex++;
+        request.setDestination(m_storage.getTextureId(), index, true, m_storage.getLevelCount());
+    }
 
-                stbi_image_free(data);
-            }
+    void OpenglTexture2DArray::onLayerUploaded(TextureStreamRequest& request, uint32_t index)
+    {
+        // Fallback when the mip levels were not generated with the image (all the layers are filtered again)
+        if (request.getLevelCount() < m_storage.getLevelCount())
+        {
+            m_storage.generateMipmaps();
         }
 
-        m_needToLoadTextureArray = false;
+        m_streamRequests[index].reset();
+        m_residentLayers[index] = true;
+        m_residencyVersion++;
+    }
+
+    void OpenglTexture2DArray::setSamplerDescription(const SamplerDescription& samplerDescription)
+    {
+        bool mipmapsChanged = samplerDescription.mipmaps != m_samplerDescription.mipmaps;
+        m_samplerDescription = samplerDescription;
+
+        // The storage is allocated again with the new number of levels
+        if (mipmapsChanged && !m_filepaths.empty())
+        {
+            cleanUp();
+            load();
+        }
+        else
+        {
+            m_storage.applySamplerDescription(m_samplerDescription);
+        }
     }
 
 	void OpenglTexture2DArray::bind(uint32_t textureSlot /*= 0*/) const
     {
-		glActiveTexture(GL_TEXTURE0 + textureSlot);
-		glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureId);
+        OpenglStateCache::getInstance().bindTexture(textureSlot, GL_TEXTURE_2D_ARRAY, m_storage.getTextureId());
     }
 
 	void OpenglTexture2DArray::unbind() const
     {
-        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        OpenglStateCache::getInstance().bindTexture(GL_TEXTURE_2D_ARRAY, 0);
     }
 
-    // All textures added to the texture array must have the same size
+    // All textures added to the texture array must have the same size (see OpenglTexture2DArrayPool otherwise).
+    // The decoding starts right away, the layer is sampled once it is resident.
 	uint32_t OpenglTexture2DArray::addTexture2D(const char* filename)
     {
         auto textureResourcePath = ResourceManager::getInstance().getResourcePath(ResourceType::TEXTURE, filename);
         m_filepaths.push_back(textureResourcePath.string());
-        m_needToLoadTextureArray = true;
+        m_residentLayers.push_back(false);
+        m_streamRequests.push_back(nullptr);
+
+        uint32_t index = m_filepaths.size() - 1;
+        requestLayer(index);
         
-        return m_filepaths.size() - 1;
+        return index;
+    }
+
+
+    // OpenglTexture2DArrayPool
+    OpenglTexture2DArrayPool::Bucket::Bucket(OpenglTexture2DArrayPool& pool, uint32_t arrayIndex)
+        : pool(pool), arrayIndex(arrayIndex)
+    {
+        TextureResidencyManager::getInstance().registerTexture(this);
+    }
+
+    OpenglTexture2DArrayPool::Bucket::~Bucket()
+    {
+        TextureResidencyManager::getInstance().unregisterTexture(this);
+    }
+
+    bool OpenglTexture2DArrayPool::Bucket::dropTopLevel(uint32_t minTopLevelSize)
+    {
+        if (evicted || pool.isStreaming(*this))
+        {
+            return false;
+        }
+
+        return storage.dropTopLevel(pool.m_samplerDescription, minTopLevelSize);
+    }
+
+    // The layers are kept: the textures are streamed back to the same locations
+    bool OpenglTexture2DArrayPool::Bucket::evict()
+    {
+        if (evicted || !storage.getTextureId() || pool.isStreaming(*this))
+        {
+            return false;
+        }
+
+        storage.release();
+        evicted = true;
+        for (auto& texture : pool.m_textures)
+        {
+            if (texture.arrayIndex == static_cast<int32_t>(arrayIndex))
+            {
+                texture.isResident = false;
+            }
+        }
+        pool.m_residencyVersion++;
+
+        return true;
+    }
+
+    void OpenglTexture2DArrayPool::Bucket::restore()
+    {
+        if (!pool.isStreaming(*this))
+        {
+            pool.restoreBucket(*this);
+        }
+    }
+
+    OpenglTexture2DArrayPool::~OpenglTexture2DArrayPool()
+    {
+        reset();
+    }
+
+    void OpenglTexture2DArrayPool::reset()
+    {
+        for (auto& texture : m_textures)
+        {
+            if (texture.streamRequest)
+            {
+                texture.streamRequest->cancel();
+                texture.streamRequest.reset();
+            }
+            texture.arrayIndex = -1;
+            texture.layer = 0;
+            texture.isResident = false;
+        }
+
+        m_buckets.clear();
+        m_residencyVersion++;
+    }
+
+    // The same file gives the same handle
+    uint32_t OpenglTexture2DArrayPool::addTexture2D(const char* filename)
+    {
+        auto filepath = ResourceManager::getInstance().getResourcePath(ResourceType::TEXTURE, filename).string();
+        if (auto it = m_handles.find(filepath); it != m_handles.end())
+        {
+            m_textures[it->second].refCount++;
+            return it->second;
+        }
+
+        uint32_t handle;
+        if (!m_freeHandles.empty())
+        {
+            handle = m_freeHandles.back();
+            m_freeHandles.pop_back();
+        }
+        else
+        {
+            handle = static_cast<uint32_t>(m_textures.size());
+            m_textures.emplace_back();
+        }
+
+        m_textures[handle].filepath = filepath;
+        m_textures[handle].refCount = 1;
+        m_handles[filepath] = handle;
+        requestTexture(handle);
+
+        return handle;
+    }
+
+    void OpenglTexture2DArrayPool::releaseTexture2D(uint32_t handle)
+    {
+        ASSERT(handle < m_textures.size() && m_textures[handle].refCount > 0, "Texture handle released too many times");
+        auto& texture = m_textures[handle];
+        if (--texture.refCount > 0)
+        {
+            return;
+        }
+
+        if (texture.streamRequest)
+        {
+            texture.streamRequest->cancel();
+        }
+        if (texture.arrayIndex >= 0)
+        {
+            m_buckets[texture.arrayIndex]->freeLayers.push_back(texture.layer);
+        }
+
+        m_handles.erase(texture.filepath);
+        texture = PooledTexture{};
+        m_freeHandles.push_back(handle);
+    }
+
+    void OpenglTexture2DArrayPool::markUsed(uint32_t handle)
+    {
+        if (handle < m_textures.size() && m_textures[handle].arrayIndex >= 0)
+        {
+            TextureResidencyManager::getInstance().markUsed(m_buckets[m_textures[handle].arrayIndex].get());
+        }
+    }
+
+    bool OpenglTexture2DArrayPool::getTextureLocation(uint32_t handle, uint32_t& arrayIndex, uint32_t& layer) const
+    {
+        if (handle >= m_textures.size() || !m_textures[handle].isResident)
+        {
+            return false;
+        }
+
+        arrayIndex = m_textures[handle].arrayIndex;
+        layer = m_textures[handle].layer;
+        return true;
+    }
+
+    void OpenglTexture2DArrayPool::requestTexture(uint32_t handle)
+    {
+        m_textures[handle].streamRequest = OpenglTextureStreamer::getInstance().request(m_textures[handle].filepath, m_samplerDescription.mipmaps,
+            [this, handle](TextureStreamRequest& request, const DecodedImage& image) { onTextureDecoded(request, handle, image); },
+            [this, handle](TextureStreamRequest& request) { onTextureUploaded(request, handle); });
+    }
+
+    bool OpenglTexture2DArrayPool::isStreaming(const Bucket& bucket) const
+    {
+        return std::any_of(m_textures.begin(), m_textures.end(), [&bucket](const auto& texture)
+        {
+            return texture.arrayIndex == static_cast<int32_t>(bucket.arrayIndex) && texture.streamRequest;
+        });
+    }
+
+    // An evicted array is allocated again when the first texture is decoded.
+    // A reduced array keeps sampling its remaining levels until all its textures are streamed back.
+    void OpenglTexture2DArrayPool::restoreBucket(Bucket& bucket)
+    {
+        if (!bucket.evicted && !bucket.storage.getDroppedLevelCount())
+        {
+            return;
+        }
+
+        bucket.storage.restoreTopLevels(m_samplerDescription);
+        bucket.evicted = false;
+        for (uint32_t handle = 0; handle < m_textures.size(); ++handle)
+        {
+            auto& texture = m_textures[handle];
+            if (texture.arrayIndex == static_cast<int32_t>(bucket.arrayIndex) && !texture.filepath.empty() && !texture.streamRequest)
+            {
+                requestTexture(handle);
+            }
+        }
+    }
+
+    void OpenglTexture2DArrayPool::onTextureDecoded(TextureStreamRequest& request, uint32_t handle, const DecodedImage& image)
+    {
+        auto& texture = m_textures[handle];
+        if (!image.isValid())
+        {
+            texture.streamRequest.reset();
+            return;
+        }
+
+        // Streamed back after an eviction: the texture keeps its location
+        auto levelCount = getLevelCount(m_samplerDescription, image);
+        if (texture.arrayIndex >= 0)
+        {
+            if (!m_buckets[texture.arrayIndex]->storage.matches(image.width, image.height, image.format, levelCount))
+            {
+                CM_CORE_LOG_ERROR("The texture file changed size or format since it was loaded (check file {})", request.getFilepath());
+                texture.streamRequest.reset();
+                return;
+            }
+        }
+        else
+        {
+            auto bucketIt = std::find_if(m_buckets.begin(), m_buckets.end(), [&](const auto& bucket)
+            {
+                return bucket->storage.matches(image.width, image.height, image.format, levelCount);
+            });
+
+            if (bucketIt == m_buckets.end())
+            {
+                if (m_buckets.size() >= MAX_ARRAY_COUNT)
+                {
+                    CM_CORE_LOG_ERROR("No texture array left for the {} x {} textures (maximum {} sizes and formats) (check file {})",
+                                      image.width, image.height, MAX_ARRAY_COUNT, request.getFilepath());
+                    texture.streamRequest.reset();
+                    return;
+                }
+
+                CM_CORE_LOG_DEBUG("New texture array: {} x {}, format {}, {} levels", image.width, image.height, (int)image.format, levelCount);
+                m_buckets.push_back(std::make_unique<Bucket>(*this, static_cast<uint32_t>(m_buckets.size())));
+                m_buckets.back()->storage.define(image.width, image.height, image.format, levelCount);
+                bucketIt = m_buckets.end() - 1;
+            }
+
+            auto& bucket = **bucketIt;
+            texture.arrayIndex = static_cast<int32_t>(bucket.arrayIndex);
+            if (!bucket.freeLayers.empty())
+            {
+                texture.layer = bucket.freeLayers.back();
+                bucket.freeLayers.pop_back();
+            }
+            else
+            {
+                texture.layer = bucket.layerCount++;
+            }
+        }
+
+        // The array can only grow with all its levels
+        auto& bucket = *m_buckets[texture.arrayIndex];
+        restoreBucket(bucket);
+
+        // The layers of the textures still streaming to the previous texture are redirected
+        if (bucket.storage.reserve(bucket.layerCount, m_samplerDescription))
+        {
+            for (auto& pooledTexture : m_textures)
+            {
+                if (pooledTexture.arrayIndex == texture.arrayIndex && pooledTexture.streamRequest)
+                {
+                    pooledTexture.streamRequest->setDestination(bucket.storage.getTextureId(), pooledTexture.layer, true,
+                                                                bucket.storage.getLevelCount());
+                }
+            }
+        }
+
+        request.setDestination(bucket.storage.getTextureId(), texture.layer, true, bucket.storage.getLevelCount());
+    }
+
+    void OpenglTexture2DArrayPool::onTextureUploaded(TextureStreamRequest& request, uint32_t handle)
+    {
+        auto& texture = m_textures[handle];
+        auto& bucket = *m_buckets[texture.arrayIndex];
+        texture.streamRequest.reset();
+        texture.isResident = true;
+        m_residencyVersion++;
+
+        // The levels streamed back are sampled once all the layers have them
+        if (!isStreaming(bucket))
+        {
+            bucket.storage.resetBaseLevel();
+        }
+
+        if (request.getLevelCount() < bucket.storage.getLevelCount())
+        {
+            bucket.mipmapsPending = true;
+        }
+        if (bucket.mipmapsPending && bucket.storage.getBaseLevel() == 0)
+        {
+            bucket.storage.generateMipmaps();
+            bucket.mipmapsPending = false;
+        }
+    }
+
+    void OpenglTexture2DArrayPool::setSamplerDescription(const SamplerDescription& samplerDescription)
+    {
+        bool mipmapsChanged = samplerDescription.mipmaps != m_samplerDescription.mipmaps;
+        m_samplerDescription = samplerDescription;
+
+        // The arrays are allocated again with the new number of levels
+        if (mipmapsChanged && !m_textures.empty())
+        {
+            reset();
+            for (uint32_t handle = 0; handle < m_textures.size(); ++handle)
+            {
+                if (!m_textures[handle].filepath.empty())
+                {
+                    requestTexture(handle);
+                }
+            }
+            return;
+        }
+
+        for (auto& bucket : m_buckets)
+        {
+            bucket->storage.applySamplerDescription(m_samplerDescription);
+        }
+    }
+
+    void OpenglTexture2DArrayPool::bind(uint32_t firstTextureSlot) const
+    {
+        for (uint32_t arrayIndex = 0; arrayIndex < m_buckets.size(); ++arrayIndex)
+        {
+            OpenglStateCache::getInstance().bindTexture(firstTextureSlot + arrayIndex, GL_TEXTURE_2D_ARRAY,
+                                                        m_buckets[arrayIndex]->storage.getTextureId());
+        }
     }
 
 } // namespace comet
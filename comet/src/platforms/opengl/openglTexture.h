@@ -1,14 +1,22 @@
 #pragma once
 
 #include <comet/texture.h>
+#include <comet/textureResidencyManager.h>
 
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace comet
 {
-    
-    class OpenglTexture2D : public Texture2D
+    class TextureStreamRequest;
+    struct DecodedImage;
+
+    uint32_t getOpenglInternalFormat(TextureFormat format);
+
+    // The textures loaded from a file are managed by the TextureResidencyManager
+    class OpenglTexture2D : public Texture2D, public ResidentTexture
 	{
 	public:
 		
@@ -25,19 +33,101 @@ namespace comet
 		virtual void bind(uint32_t textureSlot = 0) const override;
 		virtual void unbind() const override;
 
+		virtual void setSamplerDescription(const SamplerDescription& samplerDescription) override;
+		virtual const SamplerDescription& getSamplerDescription() const override { return m_samplerDescription; }
+
 		virtual void makeItWhite() override;
 
+		virtual bool isResident() const override { return m_isResident; }
+		virtual TextureFormat getFormat() const override { return m_format; }
+
         virtual uint32_t getWidth() const override { return m_width; }
         virtual uint32_t getHeight() const override { return m_height; }
+
+		virtual size_t getResidentSize() const override;
+		virtual bool isEvicted() const override { return m_isEvicted; }
+		virtual uint32_t getDroppedLevelCount() const override { return m_droppedLevelCount; }
+		virtual bool dropTopLevel(uint32_t minTopLevelSize) override;
+		virtual bool evict() override;
+		virtual void restore() override;
         
+	private:
+		void requestImage();
+		void onDecoded(TextureStreamRequest& request, const DecodedImage& image);
+		void onUploaded(TextureStreamRequest& request);
+		void releaseStorage();
+
 	private:
 		uint32_t m_textureId{0};
         uint32_t m_width{0};
         uint32_t m_height{0};
+		uint32_t m_levelCount{0};
+		// Top levels not allocated, and top levels allocated but not sampled until they are streamed back
+		uint32_t m_droppedLevelCount{0};
+		uint32_t m_baseLevel{0};
+		TextureFormat m_format{TextureFormat::RGBA8};
+		SamplerDescription m_samplerDescription{};
 		std::string m_filepath{};
+		std::shared_ptr<TextureStreamRequest> m_streamRequest;
+		bool m_isResident{false};
+		bool m_isEvicted{false};
 		bool m_isProxy{false};
 	};
 
+    // Immutable GL_TEXTURE_2D_ARRAY storage: a larger texture is created and the levels are copied on the GPU when it grows
+    class OpenglTextureArrayStorage
+    {
+    public:
+        OpenglTextureArrayStorage() = default;
+        ~OpenglTextureArrayStorage() { release(); }
+
+        OpenglTextureArrayStorage(const OpenglTextureArrayStorage&) = delete;
+        OpenglTextureArrayStorage& operator=(const OpenglTextureArrayStorage&) = delete;
+
+        // Layers description, before the first reserve() (or after release())
+        void define(uint32_t width, uint32_t height, TextureFormat format, uint32_t levelCount);
+        bool matches(uint32_t width, uint32_t height, TextureFormat format, uint32_t levelCount) const;
+
+        // Returns true when the texture has been reallocated: the pending uploads must target the new texture id.
+        // The dropped levels must have been restored.
+        bool reserve(uint32_t layerCount, const SamplerDescription& samplerDescription);
+        void release();
+
+        // The texture is reallocated without its top level, unless the next level is smaller than 'minTopLevelSize'
+        bool dropTopLevel(const SamplerDescription& samplerDescription, uint32_t minTopLevelSize);
+        // The texture is reallocated with all its levels, only the levels kept are sampled until resetBaseLevel()
+        void restoreTopLevels(const SamplerDescription& samplerDescription);
+        void resetBaseLevel();
+
+        void applySamplerDescription(const SamplerDescription& samplerDescription);
+        // Fallback for the RGBA8 layers uploaded without their mip levels
+        void generateMipmaps();
+
+        uint32_t getTextureId() const { return m_textureId; }
+        uint32_t getWidth() const { return m_width; }
+        uint32_t getHeight() const { return m_height; }
+        TextureFormat getFormat() const { return m_format; }
+        uint32_t getLevelCount() const { return m_levelCount; }
+        uint32_t getDroppedLevelCount() const { return m_droppedLevelCount; }
+        uint32_t getBaseLevel() const { return m_baseLevel; }
+        uint32_t getLayerCapacity() const { return m_layerCapacity; }
+        // Bytes of the allocated levels of all the layers
+        size_t getSize() const;
+
+    private:
+        void applyTextureParameters(uint32_t textureId, const SamplerDescription& samplerDescription) const;
+
+    private:
+        uint32_t m_textureId{0};
+        uint32_t m_width{0};
+        uint32_t m_height{0};
+        TextureFormat m_format{TextureFormat::RGBA8};
+        uint32_t m_levelCount{0};
+        uint32_t m_droppedLevelCount{0};
+        uint32_t m_baseLevel{0};
+        uint32_t m_layerCapacity{0};
+    };
+
     class OpenglTexture2DArray : public Texture2DArray
 	{
 	public:
@@ -53,19 +143,105 @@ namespace comet
 		virtual void bind(uint32_t textureSlot = 0) const override;
 		virtual void unbind() const override;
 
+		virtual void setSamplerDescription(const SamplerDescription& samplerDescription) override;
+		virtual const SamplerDescription& getSamplerDescription() const override { return m_samplerDescription; }
+
 		virtual uint32_t addTexture2D(const char* filename) override;
 		virtual uint32_t getTextureCount() const override { return m_filepaths.size(); }
 		virtual bool needToLoadTextureArray() const override { return m_needToLoadTextureArray; }
 
-        virtual uint32_t getWidth() const override { return m_width; }
-        virtual uint32_t getHeight() const override { return m_height; }
+		virtual bool isLayerResident(uint32_t index) const override { return index < m_residentLayers.size() && m_residentLayers[index]; }
+		virtual uint32_t getResidencyVersion() const override { return m_residencyVersion; }
+		virtual TextureFormat getFormat() const override { return m_storage.getFormat(); }
+
+        virtual uint32_t getWidth() const override { return m_storage.getWidth(); }
+        virtual uint32_t getHeight() const override { return m_storage.getHeight(); }
         
 	private:
-		uint32_t m_textureId{0};
-        uint32_t m_width{0};
-        uint32_t m_height{0};
+		void requestLayer(uint32_t index);
+		void onLayerDecoded(TextureStreamRequest& request, uint32_t index, const DecodedImage& image);
+		void onLayerUploaded(TextureStreamRequest& request, uint32_t index);
+		void cancelRequests();
+
+	private:
+		OpenglTextureArrayStorage m_storage;
+		SamplerDescription m_samplerDescription{};
 		std::vector<std::string> m_filepaths{};
+		std::vector<std::shared_ptr<TextureStreamRequest>> m_streamRequests;
+		std::vector<bool> m_residentLayers;
+		uint32_t m_residencyVersion{0};
 		bool m_needToLoadTextureArray{true};
 	};
 
+    class OpenglTexture2DArrayPool : public Texture2DArrayPool
+    {
+    public:
+        OpenglTexture2DArrayPool() = default;
+        virtual ~OpenglTexture2DArrayPool();
+
+        virtual uint32_t addTexture2D(const char* filename) override;
+        virtual void releaseTexture2D(uint32_t handle) override;
+        virtual void markUsed(uint32_t handle) override;
+        virtual bool getTextureLocation(uint32_t handle, uint32_t& arrayIndex, uint32_t& layer) const override;
+        virtual uint32_t getArrayCount() const override { return static_cast<uint32_t>(m_buckets.size()); }
+        virtual uint32_t getResidencyVersion() const override { return m_residencyVersion; }
+
+        virtual void setSamplerDescription(const SamplerDescription& samplerDescription) override;
+        virtual const SamplerDescription& getSamplerDescription() const override { return m_samplerDescription; }
+
+        virtual void bind(uint32_t firstTextureSlot) const override;
+
+    private:
+        struct PooledTexture
+        {
+            std::string filepath;
+            std::shared_ptr<TextureStreamRequest> streamRequest;
+            int32_t arrayIndex{-1};
+            uint32_t layer{0};
+            uint32_t refCount{0};
+            bool isResident{false};
+        };
+
+        // Array of the textures sharing the same size, format and levels, managed by the TextureResidencyManager as a whole
+        struct Bucket : public ResidentTexture
+        {
+            Bucket(OpenglTexture2DArrayPool& pool, uint32_t arrayIndex);
+            virtual ~Bucket();
+
+            virtual size_t getResidentSize() const override { return storage.getSize(); }
+            virtual bool isEvicted() const override { return evicted; }
+            virtual uint32_t getDroppedLevelCount() const override { return storage.getDroppedLevelCount(); }
+            virtual bool dropTopLevel(uint32_t minTopLevelSize) override;
+            virtual bool evict() override;
+            virtual void restore() override;
+
+            OpenglTexture2DArrayPool& pool;
+            uint32_t arrayIndex;
+            OpenglTextureArrayStorage storage;
+            uint32_t layerCount{0};
+            // Layers of the released textures
+            std::vector<uint32_t> freeLayers;
+            bool evicted{false};
+            // Layers uploaded without their mip levels while the base level can't be filtered
+            bool mipmapsPending{false};
+        };
+
+        void requestTexture(uint32_t handle);
+        bool isStreaming(const Bucket& bucket) const;
+        // The textures of the bucket are streamed again to their layers
+        void restoreBucket(Bucket& bucket);
+        void onTextureDecoded(TextureStreamRequest& request, uint32_t handle, const DecodedImage& image);
+        void onTextureUploaded(TextureStreamRequest& request, uint32_t handle);
+        // Cancel the streaming and forget the locations: the textures are streamed again
+        void reset();
+
+    private:
+        SamplerDescription m_samplerDescription{};
+        std::vector<PooledTexture> m_textures;
+        std::unordered_map<std::string, uint32_t> m_handles;
+        std::vector<uint32_t> m_freeHandles;
+        std::vector<std::unique_ptr<Bucket>> m_buckets;
+        uint32_t m_residencyVersion{0};
+    };
+
 } // namespace comet
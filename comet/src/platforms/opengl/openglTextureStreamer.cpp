@@ -0,0 +1,195 @@
+#include "openglTextureStreamer.h"
+#include "openglStateCache.h"
+#include "openglTexture.h"
+#include <core/threadPool.h>
+
+#include <comet/log.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <glad/glad.h>
+
+namespace comet
+{
+
+    std::shared_ptr<TextureStreamRequest> OpenglTextureStreamer::request(const std::string& filepath, bool generateMipmaps,
+                                                                         TextureStreamRequest::DecodedCallback onDecoded,
+                                                                         TextureStreamRequest::UploadedCallback onUploaded)
+    {
+        auto streamRequest = std::make_shared<TextureStreamRequest>();
+        streamRequest->m_filepath = filepath;
+        streamRequest->m_onDecoded = std::move(onDecoded);
+        streamRequest->m_onUploaded = std::move(onUploaded);
+
+        // std::function must be copyable: the promise is shared with the task
+        auto decodedImage = std::make_shared<std::promise<DecodedImage>>();
+        streamRequest->m_decodedImage = decodedImage->get_future();
+        auto& threadPool = ThreadPool::getInstance();
+        generateMipmaps = generateMipmaps && threadPool.getWorkerCount() > 0;
+        threadPool.submit([filepath, generateMipmaps, decodedImage]()
+        {
+            decodedImage->set_value(DecodedImage::decode(filepath, generateMipmaps));
+        });
+
+        m_decodingRequests.push_back(streamRequest);
+        return streamRequest;
+    }
+
+    void OpenglTextureStreamer::update()
+    {
+        handOverDecodedImages();
+        uploadRows();
+    }
+
+    void OpenglTextureStreamer::handOverDecodedImages()
+    {
+        // In request order, so the first layer of a texture array is the first one handed over
+        while (!m_decodingRequests.empty())
+        {
+            auto streamRequest = m_decodingRequests.front();
+            if (!streamRequest->isCancelled())
+            {
+                if (streamRequest->m_decodedImage.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                {
+                    break;
+                }
+
+                streamRequest->m_image = streamRequest->m_decodedImage.get();
+                streamRequest->m_levelCount = static_cast<uint32_t>(streamRequest->m_image.levels.size());
+                if (!streamRequest->m_image.isValid())
+                {
+                    CM_CORE_LOG_ERROR("Failed loading texture file {}", streamRequest->m_filepath);
+                }
+
+                streamRequest->m_onDecoded(*streamRequest, streamRequest->m_image);
+                if (streamRequest->m_image.isValid() && streamRequest->m_textureId && !streamRequest->isCancelled())
+                {
+                    m_uploadRequests.push_back(streamRequest);
+                }
+                else
+                {
+                    streamRequest->m_image = {};
+                }
+            }
+
+            m_decodingRequests.pop_front();
+        }
+    }
+
+    void OpenglTextureStreamer::uploadRows()
+    {
+        while (!m_uploadRequests.empty() && m_uploadRequests.front()->isCancelled())
+        {
+            m_uploadRequests.pop_front();
+        }
+
+        if (m_uploadRequests.empty())
+        {
+            return;
+        }
+
+        if (!m_stagingBuffer)
+        {
+            m_stagingBuffer = VertexBuffer::create(GL_STREAM_DRAW);
+            m_stagingBuffer->setSize(STAGING_REGION_SIZE);
+            m_stagingBuffer->allocateStreaming(STAGING_REGION_COUNT);
+        }
+
+        // Waits only if the GPU is still reading the region, STAGING_REGION_COUNT frames later
+        auto pRegion = static_cast<uint8_t*>(m_stagingBuffer->acquireRegion());
+        auto regionOffset = static_cast<size_t>(m_stagingBuffer->getRegionIndex()) * STAGING_REGION_SIZE;
+        size_t usedSize = 0;
+
+        auto& stateCache = OpenglStateCache::getInstance();
+        stateCache.bindBuffer(GL_PIXEL_UNPACK_BUFFER, m_stagingBuffer->getId());
+
+        while (!m_uploadRequests.empty())
+        {
+            auto streamRequest = m_uploadRequests.front();
+            if (streamRequest->isCancelled())
+            {
+                m_uploadRequests.pop_front();
+                continue;
+            }
+
+            // Rows of blocks for the compressed formats
+            auto& image = streamRequest->m_image;
+            const auto& level = image.levels[streamRequest->m_uploadedLevels];
+            auto rowHeight = getTextureFormatRowHeight(image.format);
+            auto rowSize = getTextureFormatRowSize(image.format, level.width);
+            auto levelRowCount = (level.height + rowHeight - 1) / rowHeight;
+            auto rowCount = static_cast<uint32_t>(std::min<size_t>((STAGING_REGION_SIZE - usedSize) / rowSize,
+                                                                   levelRowCount - streamRequest->m_uploadedRows));
+            if (rowCount == 0 && usedSize == 0)
+            {
+                CM_CORE_LOG_ERROR("The rows of texture file {} are larger than a staging region", streamRequest->m_filepath);
+                image = {};
+                m_uploadRequests.pop_front();
+                continue;
+            }
+
+            if (rowCount == 0)
+            {
+                // The region is full, the next rows will go in the next one
+                break;
+            }
+
+            memcpy(pRegion + usedSize, level.data + streamRequest->m_uploadedRows * rowSize, rowCount * rowSize);
+
+            // With a pixel unpack buffer bound, the pixels pointer is an offset in the buffer
+            auto pixelsOffset = reinterpret_cast<const void*>(regionOffset + usedSize);
+            auto y = streamRequest->m_uploadedRows * rowHeight;
+            auto height = std::min(rowCount * rowHeight, level.height - y);
+            auto levelIndex = streamRequest->m_uploadedLevels;
+            auto layer = streamRequest->m_layer;
+            auto textureId = streamRequest->m_textureId;
+            if (image.format == TextureFormat::RGBA8)
+            {
+                if (streamRequest->m_isArrayLayer)
+                {
+                    glTextureSubImage3D(textureId, levelIndex, 0, y, layer, level.width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixelsOffset);
+                }
+                else
+                {
+                    glTextureSubImage2D(textureId, levelIndex, 0, y, level.width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixelsOffset);
+                }
+            }
+            else
+            {
+                auto internalFormat = getOpenglInternalFormat(image.format);
+                auto dataSize = static_cast<GLsizei>(rowCount * rowSize);
+                if (streamRequest->m_isArrayLayer)
+                {
+                    glCompressedTextureSubImage3D(textureId, levelIndex, 0, y, layer, level.width, height, 1, internalFormat, dataSize, pixelsOffset);
+                }
+                else
+                {
+                    glCompressedTextureSubImage2D(textureId, levelIndex, 0, y, level.width, height, internalFormat, dataSize, pixelsOffset);
+                }
+            }
+
+            usedSize += rowCount * rowSize;
+            streamRequest->m_uploadedRows += rowCount;
+            if (streamRequest->m_uploadedRows == levelRowCount)
+            {
+                streamRequest->m_uploadedRows = 0;
+                streamRequest->m_uploadedLevels++;
+            }
+
+            // The texture may have less levels than the image (mipmaps disabled)
+            if (streamRequest->m_uploadedLevels == std::min(streamRequest->m_levelCount, streamRequest->m_textureLevelCount))
+            {
+                image = {};
+                m_uploadRequests.pop_front();
+                streamRequest->m_onUploaded(*streamRequest);
+            }
+        }
+
+        stateCache.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        m_stagingBuffer->unmapMemory();
+        m_stagingBuffer->fenceRegion();
+    }
+
+} // namespace comet
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <comet/singleton.h>
+#include <rendering/vertexBuffer.h>
+#include <rendering/textureImage.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+
+namespace comet
+{
+
+    // Streaming of an image file to a texture (or a layer of a texture array).
+    // The request is shared by the texture and the streamer: the texture cancels it
+    // when the image is not needed anymore (texture deleted or reloaded).
+    class TextureStreamRequest
+    {
+        friend class OpenglTextureStreamer;
+
+    public:
+        using DecodedCallback = std::function<void(TextureStreamRequest& request, const DecodedImage& image)>;
+        using UploadedCallback = std::function<void(TextureStreamRequest& request)>;
+
+        void cancel() { m_cancelled = true; }
+        bool isCancelled() const { return m_cancelled; }
+
+        const std::string& getFilepath() const { return m_filepath; }
+        // Levels of the decoded image, the texture generates the missing ones
+        uint32_t getLevelCount() const { return m_levelCount; }
+
+        // Destination of the pixels, set by the decoded callback (a texture id of 0 drops the image).
+        // Only the levels allocated in the texture are uploaded, the texture has the format of the image.
+        void setDestination(uint32_t textureId, uint32_t layer, bool isArrayLayer, uint32_t textureLevelCount)
+        {
+            m_textureId = textureId;
+            m_layer = layer;
+            m_isArrayLayer = isArrayLayer;
+            m_textureLevelCount = textureLevelCount;
+        }
+
+    private:
+        std::string m_filepath;
+        DecodedCallback m_onDecoded;
+        UploadedCallback m_onUploaded;
+        std::future<DecodedImage> m_decodedImage;
+        DecodedImage m_image;
+        uint32_t m_levelCount{0};
+        uint32_t m_uploadedLevels{0};
+        uint32_t m_uploadedRows{0};
+        uint32_t m_textureId{0};
+        uint32_t m_layer{0};
+        uint32_t m_textureLevelCount{1};
+        bool m_isArrayLayer{false};
+        bool m_cancelled{false};
+    };
+
+    // Texture files are decoded on the thread pool, then uploaded on the render thread through a ring of
+    // pixel unpack buffer regions. Each update() uploads at most one region of rows, so large images are
+    // spread over several frames instead of stalling one.
+    class OpenglTextureStreamer : public Singleton<OpenglTextureStreamer>
+    {
+    public:
+        // The callbacks are called on the render thread, from update(), unless the request has been cancelled:
+        // 'onDecoded' when the file has been decoded (the image has no pixels if it failed), it sets the destination,
+        // 'onUploaded' when all the rows of all the levels are in the destination texture.
+        // Without workers, the mip levels are not generated on the CPU: the texture falls back to glGenerateTextureMipmap.
+        std::shared_ptr<TextureStreamRequest> request(const std::string& filepath, bool generateMipmaps,
+                                                      TextureStreamRequest::DecodedCallback onDecoded,
+                                                      TextureStreamRequest::UploadedCallback onUploaded);
+
+        // Once per frame, on the render thread: hands over the decoded images and uploads at most one staging region of rows
+        void update();
+
+        bool isIdle() const { return m_decodingRequests.empty() && m_uploadRequests.empty(); }
+
+    private:
+        static constexpr size_t STAGING_REGION_SIZE = 4 * 1024 * 1024;
+        static constexpr uint32_t STAGING_REGION_COUNT = 3;
+
+        void handOverDecodedImages();
+        void uploadRows();
+
+    private:
+        std::deque<std::shared_ptr<TextureStreamRequest>> m_decodingRequests;
+        std::deque<std::shared_ptr<TextureStreamRequest>> m_uploadRequests;
+        std::unique_ptr<VertexBuffer> m_stagingBuffer;
+    };
+
+} // namespace comet
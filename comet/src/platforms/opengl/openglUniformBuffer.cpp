@@ -0,0 +1,145 @@
+#include "openglUniformBuffer.h"
+#include "openglStateCache.h"
+#include "openglBufferStorage.h"
+#include <comet/log.h>
+
+#include <glad/glad.h>
+
+namespace comet
+{
+
+    // The buffer object is created with its storage (immutable)
+    OpenglUniformBuffer::OpenglUniformBuffer(uint32_t usage)
+        : m_usage(usage)
+    {
+    }
+
+    OpenglUniformBuffer::~OpenglUniformBuffer()
+    {
+        openglBufferStorage::destroy(m_bufferId);
+    };
+
+    OpenglUniformBuffer::OpenglUniformBuffer(OpenglUniformBuffer&& other)
+        : m_usage(std::move(other.m_usage)),
+        m_bufferId(std::move(other.m_bufferId)),
+        m_size(std::move(other.m_size)),
+        m_count(std::move(other.m_count)),
+        m_pMappedMemory(std::move(other.m_pMappedMemory)),
+        m_pMappedBase(std::move(other.m_pMappedBase)),
+        m_mapAccess(std::move(other.m_mapAccess))
+    {
+        other.m_bufferId = 0;
+    }
+
+    OpenglUniformBuffer& OpenglUniformBuffer::operator=(OpenglUniformBuffer&& other) noexcept
+    {
+        if (&other == this)
+        {
+            return *this;
+        }
+        openglBufferStorage::destroy(m_bufferId);
+
+        m_usage = std::move(other.m_usage);
+        m_bufferId = std::move(other.m_bufferId);
+        m_size = std::move(other.m_size);
+        m_count = std::move(other.m_count);
+        m_pMappedMemory = std::move(other.m_pMappedMemory);
+        m_pMappedBase = std::move(other.m_pMappedBase);
+        m_mapAccess = std::move(other.m_mapAccess);
+
+        other.m_bufferId = 0;
+
+        return *this;
+    }
+
+    uint32_t OpenglUniformBuffer::getCount() const
+    {
+        return m_count;
+    }
+
+    void OpenglUniformBuffer::bind() const
+    {
+        OpenglStateCache::getInstance().bindBuffer(GL_UNIFORM_BUFFER, m_bufferId);
+    }
+
+    void OpenglUniformBuffer::unbind() const
+    {
+        OpenglStateCache::getInstance().bindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    void OpenglUniformBuffer::bindStorage(uint32_t bindingIndex, size_t offset /*= 0*/, size_t size /*= 0*/) const
+    {
+        if (size == 0)
+        {
+            OpenglStateCache::getInstance().bindBufferRange(GL_SHADER_STORAGE_BUFFER, bindingIndex, m_bufferId);
+        }
+        else
+        {
+            OpenglStateCache::getInstance().bindBufferRange(GL_SHADER_STORAGE_BUFFER, bindingIndex, m_bufferId, offset, size);
+        }
+    }
+
+    void OpenglUniformBuffer::bindUniform(uint32_t bindingIndex, size_t offset /*= 0*/, size_t size /*= 0*/) const
+    {
+        if (size == 0)
+        {
+            OpenglStateCache::getInstance().bindBufferRange(GL_UNIFORM_BUFFER, bindingIndex, m_bufferId);
+        }
+        else
+        {
+            OpenglStateCache::getInstance().bindBufferRange(GL_UNIFORM_BUFFER, bindingIndex, m_bufferId, offset, size);
+        }
+    }
+
+    void OpenglUniformBuffer::allocate()
+    {
+        if (m_size)
+        {
+            allocate(m_size);
+        }
+    }
+
+    void OpenglUniformBuffer::allocate(size_t size)
+    {
+        // Immutable storage can't be reallocated: start over from a new buffer object
+        openglBufferStorage::destroy(m_bufferId);
+        m_size = size;
+        m_bufferId = openglBufferStorage::create(size, m_usage);
+    }
+
+    void OpenglUniformBuffer::grow(size_t size)
+    {
+        if (size <= m_size)
+        {
+            return;
+        }
+
+        m_bufferId = openglBufferStorage::grow(m_bufferId, m_size, size, m_usage);
+        m_size = size;
+    }
+
+    void* OpenglUniformBuffer::mapMemory(uint32_t access)
+    {
+        m_mapAccess = access;
+        m_pMappedMemory = openglBufferStorage::map(m_bufferId, m_size, access);
+        m_pMappedBase = m_pMappedMemory;
+        return m_pMappedMemory;
+    }
+
+    void OpenglUniformBuffer::unmapMemory()
+    {
+        auto writtenSize = m_size;
+        if (!openglBufferStorage::unmap(m_bufferId, m_mapAccess, writtenSize))
+        {
+            CM_CORE_LOG_ERROR("Error while unmapping OpenglUniformBuffer");
+        }
+        m_pMappedMemory = nullptr;
+        m_pMappedBase = nullptr;
+    }
+
+    void OpenglUniformBuffer::loadData(const void* data, size_t size, size_t offset)
+    {
+        glNamedBufferSubData(m_bufferId, offset, size, data);
+    }
+
+} // namespace comet
@@ -1,5 +1,8 @@
 #include "openglVertexArray.h"
+#include "openglStateCache.h"
+#include "openglVertexFormat.h"
 #include <rendering/indexBuffer.h>
+#include <comet/assert.h>
 
 #include <glad/glad.h>
 
@@ -8,7 +11,8 @@ namespace comet
 
     OpenglVertexArray::OpenglVertexArray()
     {
-        glGenVertexArrays(1, &m_vao);
+        glCreateVertexArrays(1, &m_vao);
+        m_bufferDeletionCount = OpenglStateCache::getInstance().getBufferDeletionCount();
     }
 
     OpenglVertexArray::~OpenglVertexArray()
@@ -16,12 +20,17 @@ namespace comet
         if (m_vao)
         {
             unbind();
+            OpenglStateCache::getInstance().onVertexArrayDeleted(m_vao);
             glDeleteVertexArrays(1, &m_vao);
         }
     }
 
     OpenglVertexArray::OpenglVertexArray(OpenglVertexArray&& other)
-        : m_vao(std::move(other.m_vao))
+        : m_vao(std::move(other.m_vao)),
+        m_bufferBindings(std::move(other.m_bufferBindings)),
+        m_elementBuffer(std::move(other.m_elementBuffer)),
+        m_elementBufferId(std::move(other.m_elementBufferId)),
+        m_bufferDeletionCount(std::move(other.m_bufferDeletionCount))
     {
         other.m_vao = 0;
     }
@@ -35,62 +44,70 @@ namespace comet
         if (m_vao)
         {
             unbind();
+            OpenglStateCache::getInstance().onVertexArrayDeleted(m_vao);
             glDeleteVertexArrays(1, &m_vao);
         }
 
         m_vao = std::move(other.m_vao);
+        m_bufferBindings = std::move(other.m_bufferBindings);
+        m_elementBuffer = std::move(other.m_elementBuffer);
+        m_elementBufferId = std::move(other.m_elementBufferId);
+        m_bufferDeletionCount = std::move(other.m_bufferDeletionCount);
 
         other.m_vao = 0;
 
         return *this;
     }
 
-    void OpenglVertexArray::bind() const { glBindVertexArray(m_vao); }
-    void OpenglVertexArray::unbind() const { glBindVertexArray(0); }
+    void OpenglVertexArray::bind() const
+    {
+        refreshBufferBindings();
+        OpenglStateCache::getInstance().bindVertexArray(m_vao);
+    }
 
-    void OpenglVertexArray::addLayout(const VertexBufferLayout& vbl, const VertexBuffer& vbo, const IndexBuffer* ibo /*= nullptr*/)
+    void OpenglVertexArray::unbind() const { OpenglStateCache::getInstance().bindVertexArray(0); }
+
+    void OpenglVertexArray::refreshBufferBindings() const
     {
-            const auto& bufferAttributes = vbl.getAttributes();
-            unsigned int offset = 0;
-            bind();
-            vbo.bind();
-            if (ibo)
+        // A deleted buffer name can be reused by a new buffer object: attach everything again
+        auto bufferDeletionCount = OpenglStateCache::getInstance().getBufferDeletionCount();
+        bool forceRefresh = (bufferDeletionCount != m_bufferDeletionCount);
+        m_bufferDeletionCount = bufferDeletionCount;
+
+        for (uint32_t bindingIndex = 0; bindingIndex < m_bufferBindings.size(); ++bindingIndex)
+        {
+            auto& binding = m_bufferBindings[bindingIndex];
+            if (forceRefresh || binding.buffer->getId() != binding.bufferId)
             {
-                ibo->bind();
+                binding.bufferId = binding.buffer->getId();
+                glVertexArrayVertexBuffer(m_vao, bindingIndex, binding.bufferId, 0, binding.stride);
             }
+        }
 
-            // Loop over the vertex attributes
-            for (unsigned int i = 0; i < bufferAttributes.size(); ++i) {
-                const auto& attr = bufferAttributes[i];
-                
-                glEnableVertexAttribArray(attr.loc);
-                CM_CORE_LOG_DEBUG("enabled vertex attrib pointer: loc = {}, count = {}, type = {}, normalized = {}, stride = {}", attr.loc, attr.count, attr.type, attr.normalized, vbl.getStride());
-                
-                switch(attr.type)
-                {
-                    case GL_BYTE:
-                    case GL_UNSIGNED_BYTE:
-                    case GL_SHORT:
-                    case GL_UNSIGNED_SHORT:
-                    case GL_INT:
-                    case GL_UNSIGNED_INT:
-                        glVertexAttribIPointer(attr.loc, attr.count, attr.type, vbl.getStride(),
-                                                reinterpret_cast<void*>(offset));
-                        break;
-
-                    default:
-                        glVertexAttribPointer(attr.loc, attr.count, attr.type, attr.normalized, vbl.getStride(),
-                                                reinterpret_cast<void*>(offset));
-                        break;
-                }
-
-                if (attr.divisor)
-                {
-                    glVertexAttribDivisor(attr.loc, attr.divisor);
-                }
-                offset += attr.count * attr.size;
-            }
-            unbind();
+        if (m_elementBuffer && (forceRefresh || m_elementBuffer->getId() != m_elementBufferId))
+        {
+            m_elementBufferId = m_elementBuffer->getId();
+            glVertexArrayElementBuffer(m_vao, m_elementBufferId);
+            OpenglStateCache::getInstance().onElementBufferChanged(m_vao);
+        }
+    }
+
+    void OpenglVertexArray::addLayout(const VertexBufferLayout& vbl, const VertexBuffer& vbo, const IndexBuffer* ibo /*= nullptr*/)
+    {
+        // Each layout gets its own buffer binding point, the attributes formats are relative to it
+        auto bindingIndex = static_cast<uint32_t>(m_bufferBindings.size());
+        m_bufferBindings.push_back({&vbo, vbo.getId(), vbl.getStride()});
+        glVertexArrayVertexBuffer(m_vao, bindingIndex, vbo.getId(), 0, vbl.getStride());
+
+        if (ibo)
+        {
+            m_elementBuffer = ibo;
+            m_elementBufferId = ibo->getId();
+            glVertexArrayElementBuffer(m_vao, m_elementBufferId);
+            OpenglStateCache::getInstance().onElementBufferChanged(m_vao);
+        }
+
+        OpenglVertexFormat::setupLayout(m_vao, bindingIndex, vbl);
     }
     
 } // namespace comet
@@ -2,6 +2,8 @@
 
 #include <rendering/vertexArray.h>
 
+#include <vector>
+
 namespace comet
 {
 
@@ -18,8 +20,24 @@ namespace comet
         virtual void unbind() const override;
         virtual void addLayout(const VertexBufferLayout& vbl, const VertexBuffer& vbo, const IndexBuffer* ibo = nullptr) override;
 
+    private:
+        // Vertex buffer bound to a binding point of the vertex array
+        struct BufferBinding
+        {
+            const Buffer* buffer;
+            uint32_t bufferId;
+            uint32_t stride;
+        };
+
+        // Attach again the buffers whose object has been re-created (re-allocated storage)
+        void refreshBufferBindings() const;
+
     private:
         unsigned int m_vao{0};
+        mutable std::vector<BufferBinding> m_bufferBindings;
+        const Buffer* m_elementBuffer{nullptr};
+        mutable uint32_t m_elementBufferId{0};
+        mutable uint32_t m_bufferDeletionCount{0};
     };
     
 } // namespace comet
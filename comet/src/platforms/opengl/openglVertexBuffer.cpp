@@ -1,24 +1,36 @@
 #include "openglVertexBuffer.h"
+#include "openglStateCache.h"
+#include "openglBufferStorage.h"
 #include <comet/log.h>
+#include <comet/assert.h>
 
 #include <glad/glad.h>
 
 namespace comet
 {
 
+    // The buffer object is created with its storage (immutable)
     OpenglVertexBuffer::OpenglVertexBuffer(uint32_t usage)
         : m_usage(usage)
     {
-        glGenBuffers(1, &m_bufferId);
     }
 
-    OpenglVertexBuffer::~OpenglVertexBuffer()
+    static void deleteFences(std::vector<void*>& fences)
     {
-        if (m_bufferId)
+        for (auto& fence : fences)
         {
-            unbind();
-            glDeleteBuffers(1, &m_bufferId);
+            if (fence)
+            {
+                glDeleteSync((GLsync)fence);
+                fence = nullptr;
+            }
         }
+    }
+
+    OpenglVertexBuffer::~OpenglVertexBuffer()
+    {
+        deleteFences(m_regionFences);
+        openglBufferStorage::destroy(m_bufferId);
     };
 
     OpenglVertexBuffer::OpenglVertexBuffer(OpenglVertexBuffer&& other)
@@ -26,9 +38,17 @@ namespace comet
         m_bufferId(std::move(other.m_bufferId)),
         m_size(std::move(other.m_size)),
         m_count(std::move(other.m_count)),
-        m_pMappedMemory(std::move(other.m_pMappedMemory))
+        m_pMappedMemory(std::move(other.m_pMappedMemory)),
+        m_pMappedBase(std::move(other.m_pMappedBase)),
+        m_mapAccess(std::move(other.m_mapAccess)),
+        m_regionCount(std::move(other.m_regionCount)),
+        m_regionIndex(std::move(other.m_regionIndex)),
+        m_pPersistentMemory(std::move(other.m_pPersistentMemory)),
+        m_regionFences(std::move(other.m_regionFences))
     {
         other.m_bufferId = 0;
+        other.m_regionCount = 0;
+        other.m_pPersistentMemory = nullptr;
     }
 
     OpenglVertexBuffer& OpenglVertexBuffer::operator=(OpenglVertexBuffer&& other) noexcept
@@ -37,19 +57,24 @@ namespace comet
         {
             return *this;
         }
-        if (m_bufferId)
-        {
-            unbind();
-            glDeleteBuffers(1, &m_bufferId);
-        }
+        deleteFences(m_regionFences);
+        openglBufferStorage::destroy(m_bufferId);
 
         m_usage = std::move(other.m_usage);
         m_bufferId = std::move(other.m_bufferId);
         m_size = std::move(other.m_size);
         m_count = std::move(other.m_count);
         m_pMappedMemory = std::move(other.m_pMappedMemory);
+        m_pMappedBase = std::move(other.m_pMappedBase);
+        m_mapAccess = std::move(other.m_mapAccess);
+        m_regionCount = std::move(other.m_regionCount);
+        m_regionIndex = std::move(other.m_regionIndex);
+        m_pPersistentMemory = std::move(other.m_pPersistentMemory);
+        m_regionFences = std::move(other.m_regionFences);
 
         other.m_bufferId = 0;
+        other.m_regionCount = 0;
+        other.m_pPersistentMemory = nullptr;
 
         return *this;
     }
@@ -61,28 +86,52 @@ namespace comet
 
     void OpenglVertexBuffer::bind() const
     {
-        glBindBuffer(GL_ARRAY_BUFFER, m_bufferId);
+        OpenglStateCache::getInstance().bindBuffer(GL_ARRAY_BUFFER, m_bufferId);
     }
 
     void OpenglVertexBuffer::unbind() const
     {
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        OpenglStateCache::getInstance().bindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void OpenglVertexBuffer::bindStorage(uint32_t bindingIndex, size_t offset /*= 0*/, size_t size /*= 0*/) const
+    {
+        if (size == 0)
+        {
+            OpenglStateCache::getInstance().bindBufferRange(GL_SHADER_STORAGE_BUFFER, bindingIndex, m_bufferId);
+        }
+        else
+        {
+            OpenglStateCache::getInstance().bindBufferRange(GL_SHADER_STORAGE_BUFFER, bindingIndex, m_bufferId, offset, size);
+        }
     }
 
     void OpenglVertexBuffer::allocate()
     {
         if (m_size)
         {
-            bind();
-            glBufferData(GL_ARRAY_BUFFER, m_size, nullptr, m_usage);
+            allocate(m_size);
         }
     }
 
     void OpenglVertexBuffer::allocate(size_t size)
     {
-        bind();
+        // Immutable storage can't be reallocated: start over from a new buffer object
+        openglBufferStorage::destroy(m_bufferId);
+        m_size = size;
+        m_bufferId = openglBufferStorage::create(size, m_usage);
+    }
+
+    void OpenglVertexBuffer::grow(size_t size)
+    {
+        ASSERT(!isStreaming(), "grow() can't be used on a streaming buffer");
+        if (size <= m_size)
+        {
+            return;
+        }
+
+        m_bufferId = openglBufferStorage::grow(m_bufferId, m_size, size, m_usage);
         m_size = size;
-        glBufferData(GL_ARRAY_BUFFER, size, nullptr, m_usage);
     }
 
     void OpenglVertexBuffer::loadDataInMappedMemory(const void* data, size_t size, uint32_t count, uint32_t offset /*= 0*/)
@@ -105,19 +154,122 @@ namespace comet
 
     void* OpenglVertexBuffer::mapMemory(uint32_t access)
     {
-        bind();
-        m_pMappedMemory = glMapBuffer(GL_ARRAY_BUFFER, (GLenum)access);
+        // Streaming buffers are always mapped: give access to the current frame region
+        if (isStreaming())
+        {
+            m_pMappedMemory = static_cast<char*>(m_pPersistentMemory) + m_regionIndex * m_size;
+            return m_pMappedMemory;
+        }
+
+        m_mapAccess = access;
+        m_pMappedMemory = openglBufferStorage::map(m_bufferId, m_size, access);
+        m_pMappedBase = m_pMappedMemory;
         return m_pMappedMemory;
     }
 
     void OpenglVertexBuffer::unmapMemory()
     {
-        bind();
-        if (!glUnmapBuffer(GL_ARRAY_BUFFER))
+        if (isStreaming())
+        {
+            m_pMappedMemory = nullptr;
+            return;
+        }
+
+        auto writtenSize = static_cast<size_t>(static_cast<char*>(m_pMappedMemory) - static_cast<char*>(m_pMappedBase));
+        if (!openglBufferStorage::unmap(m_bufferId, m_mapAccess, writtenSize))
         {
             CM_CORE_LOG_ERROR("Error while unmapping OpenglVertexBuffer");
         }
         m_pMappedMemory = nullptr;
+        m_pMappedBase = nullptr;
+    }
+
+    void OpenglVertexBuffer::loadData(const void* data, size_t size, size_t offset)
+    {
+        // The immutable storage of streaming buffers is only written through its mapping
+        ASSERT(!isStreaming(), "loadData() can't be used on a streaming buffer");
+
+        glNamedBufferSubData(m_bufferId, offset, size, data);
+    }
+
+    void OpenglVertexBuffer::allocateStreaming(uint32_t regionCount)
+    {
+        ASSERT(regionCount > 0, "A streaming buffer needs at least one frame region");
+        if (m_size == 0)
+        {
+            return;
+        }
+
+        // Immutable storage can't be reallocated: start over from a new buffer object
+        deleteFences(m_regionFences);
+        openglBufferStorage::destroy(m_bufferId);
+        glCreateBuffers(1, &m_bufferId);
+
+        m_regionCount = regionCount;
+        m_regionIndex = regionCount - 1;
+        m_regionFences.assign(regionCount, nullptr);
+
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glNamedBufferStorage(m_bufferId, m_size * m_regionCount, nullptr, flags);
+        m_pPersistentMemory = glMapNamedBufferRange(m_bufferId, 0, m_size * m_regionCount, flags);
+        if (m_pPersistentMemory == nullptr)
+        {
+            CM_CORE_LOG_ERROR("Unable to persistently map the OpenglVertexBuffer");
+            m_regionCount = 0;
+        }
+    }
+
+    void* OpenglVertexBuffer::acquireRegion()
+    {
+        ASSERT(isStreaming(), "acquireRegion() requires a buffer allocated with allocateStreaming()");
+
+        m_regionIndex = (m_regionIndex + 1) % m_regionCount;
+
+        // Wait for the GPU to be done with the draw calls that were reading this region
+        auto& fence = m_regionFences[m_regionIndex];
+        if (fence)
+        {
+            GLbitfield waitFlags = 0;
+            GLuint64 waitTimeout = 0;
+            while (true)
+            {
+                auto status = glClientWaitSync((GLsync)fence, waitFlags, waitTimeout);
+                if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+                {
+                    break;
+                }
+                if (status == GL_WAIT_FAILED)
+                {
+                    CM_CORE_LOG_ERROR("Failed waiting on the frame region fence of an OpenglVertexBuffer");
+                    break;
+                }
+
+                // Flush once to make sure the fence will eventually be signaled
+                waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+                waitTimeout = 1000000; // 1ms
+            }
+
+            glDeleteSync((GLsync)fence);
+            fence = nullptr;
+        }
+
+        m_count = 0;
+        return mapMemory(GL_WRITE_ONLY);
+    }
+
+    void OpenglVertexBuffer::fenceRegion()
+    {
+        if (!isStreaming())
+        {
+            return;
+        }
+
+        auto& fence = m_regionFences[m_regionIndex];
+        if (fence)
+        {
+            glDeleteSync((GLsync)fence);
+        }
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
     }
 
 } // namespace comet
@@ -2,6 +2,8 @@
 
 #include <rendering/vertexBuffer.h>
 
+#include <vector>
+
 namespace comet
 {
 
@@ -19,19 +21,30 @@ namespace comet
 
         virtual void bind() const override;
         virtual void unbind() const override;
+        virtual void bindStorage(uint32_t bindingIndex, size_t offset = 0, size_t size = 0) const override;
 
         // allocate with the size defined by setSize()
         virtual void allocate() override;
         virtual void allocate(size_t size) override;
+        virtual void grow(size_t size) override;
 
         virtual void loadDataInMappedMemory(const void* data, size_t size, uint32_t count, uint32_t offset = 0) override;
         virtual void* mapMemory(uint32_t access) override;
         virtual void unmapMemory() override;
+        virtual void loadData(const void* data, size_t size, size_t offset) override;
+
+        virtual void allocateStreaming(uint32_t regionCount) override;
+        virtual void* acquireRegion() override;
+        virtual void fenceRegion() override;
+        virtual bool isStreaming() const override { return m_regionCount != 0; }
+        virtual uint32_t getRegionIndex() const override { return m_regionIndex; }
+        virtual uint32_t getRegionCount() const override { return m_regionCount; }
 
         virtual void setSize(size_t size) override { m_size = size; }
         virtual void increaseSize(size_t size) override { m_size += size; }
         virtual uint32_t getCount() const override;
         virtual size_t getSize() const override { return m_size; }
+        virtual uint32_t getId() const override { return m_bufferId; }
 
     protected:
         uint32_t m_usage;
@@ -39,6 +52,14 @@ namespace comet
         size_t m_size{0};
         uint32_t m_count{0};
         void* m_pMappedMemory{nullptr};
+        void* m_pMappedBase{nullptr};
+        uint32_t m_mapAccess{0};
+
+        // Streaming mode
+        uint32_t m_regionCount{0};
+        uint32_t m_regionIndex{0};
+        void* m_pPersistentMemory{nullptr};
+        std::vector<void*> m_regionFences{};
     };
     
 } // namespace comet
@@ -33,4 +33,16 @@ namespace comet
         m_stride += count * sizeof(GLint);
     }
 
+    void OpenglVertexBufferLayout::addShort(uint32_t count, bool normalized, uint32_t loc, uint32_t divisor /*= 0*/)
+    {
+        m_attributes.emplace_back(loc, GL_SHORT, count, sizeof(GLshort), normalized, divisor);
+        m_stride += count * sizeof(GLshort);
+    }
+
+    void OpenglVertexBufferLayout::addHalf(uint32_t count, uint32_t loc, uint32_t divisor /*= 0*/)
+    {
+        m_attributes.emplace_back(loc, GL_HALF_FLOAT, count, sizeof(GLhalf), false, divisor);
+        m_stride += count * sizeof(GLhalf);
+    }
+
 } // namespace comet
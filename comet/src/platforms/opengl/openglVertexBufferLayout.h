@@ -17,6 +17,8 @@ namespace comet
         virtual void addFloat(uint32_t count, bool normalized, uint32_t loc, uint32_t divisor = 0) override;
         virtual void addUInt(uint32_t count, bool normalized, uint32_t loc, uint32_t divisor = 0) override;
         virtual void addInt(uint32_t count, bool normalized, uint32_t loc, uint32_t divisor = 0) override;
+        virtual void addShort(uint32_t count, bool normalized, uint32_t loc, uint32_t divisor = 0) override;
+        virtual void addHalf(uint32_t count, uint32_t loc, uint32_t divisor = 0) override;
 
     private:
         std::vector<VertexAttribute> m_attributes;
@@ -0,0 +1,119 @@
+#include "openglVertexFormat.h"
+#include "openglStateCache.h"
+#include <rendering/buffer.h>
+#include <comet/assert.h>
+
+#include <glad/glad.h>
+
+namespace comet
+{
+
+    OpenglVertexFormat::OpenglVertexFormat(const std::vector<const VertexBufferLayout*>& layouts)
+    {
+        glCreateVertexArrays(1, &m_vao);
+
+        for (uint32_t bindingIndex = 0; bindingIndex < layouts.size(); ++bindingIndex)
+        {
+            setupLayout(m_vao, bindingIndex, *layouts[bindingIndex]);
+            m_strides.push_back(layouts[bindingIndex]->getStride());
+        }
+        m_vertexBuffers.resize(layouts.size());
+        m_bufferDeletionCount = OpenglStateCache::getInstance().getBufferDeletionCount();
+    }
+
+    OpenglVertexFormat::~OpenglVertexFormat()
+    {
+        if (m_vao)
+        {
+            OpenglStateCache::getInstance().onVertexArrayDeleted(m_vao);
+            glDeleteVertexArrays(1, &m_vao);
+        }
+    }
+
+    void OpenglVertexFormat::bind() const { OpenglStateCache::getInstance().bindVertexArray(m_vao); }
+    void OpenglVertexFormat::unbind() const { OpenglStateCache::getInstance().bindVertexArray(0); }
+
+    void OpenglVertexFormat::checkBufferDeletions() const
+    {
+        auto bufferDeletionCount = OpenglStateCache::getInstance().getBufferDeletionCount();
+        if (bufferDeletionCount != m_bufferDeletionCount)
+        {
+            m_bufferDeletionCount = bufferDeletionCount;
+            for (auto& attachedBuffer : m_vertexBuffers)
+            {
+                attachedBuffer = {};
+            }
+            m_indexBuffer = {};
+        }
+    }
+
+    void OpenglVertexFormat::bindVertexBuffer(uint32_t bindingIndex, const Buffer& vbo) const
+    {
+        ASSERT(bindingIndex < m_vertexBuffers.size(), "The vertex format has no layout for this binding point");
+        checkBufferDeletions();
+
+        auto& attachedBuffer = m_vertexBuffers[bindingIndex];
+        if (attachedBuffer.buffer != &vbo || attachedBuffer.bufferId != vbo.getId())
+        {
+            attachedBuffer = {&vbo, vbo.getId()};
+            glVertexArrayVertexBuffer(m_vao, bindingIndex, attachedBuffer.bufferId, 0, m_strides[bindingIndex]);
+        }
+    }
+
+    void OpenglVertexFormat::bindIndexBuffer(const Buffer& ibo) const
+    {
+        checkBufferDeletions();
+
+        if (m_indexBuffer.buffer != &ibo || m_indexBuffer.bufferId != ibo.getId())
+        {
+            m_indexBuffer = {&ibo, ibo.getId()};
+            glVertexArrayElementBuffer(m_vao, m_indexBuffer.bufferId);
+            OpenglStateCache::getInstance().onElementBufferChanged(m_vao);
+        }
+    }
+
+    void OpenglVertexFormat::setupLayout(uint32_t vao, uint32_t bindingIndex, const VertexBufferLayout& vbl)
+    {
+        const auto& bufferAttributes = vbl.getAttributes();
+
+        // The divisor applies to the whole binding point
+        uint32_t divisor = bufferAttributes.empty() ? 0 : bufferAttributes.front().divisor;
+        glVertexArrayBindingDivisor(vao, bindingIndex, divisor);
+
+        uint32_t offset = 0;
+        for (const auto& attr : bufferAttributes)
+        {
+            ASSERT(attr.divisor == divisor, "The attributes of a layout must share the same divisor");
+
+            glEnableVertexArrayAttrib(vao, attr.loc);
+            CM_CORE_LOG_DEBUG("enabled vertex attrib: loc = {}, count = {}, type = {}, normalized = {}, stride = {}", attr.loc, attr.count, attr.type, attr.normalized, vbl.getStride());
+
+            // Normalized integers are converted to floats
+            bool isInteger{false};
+            switch(attr.type)
+            {
+                case GL_BYTE:
+                case GL_UNSIGNED_BYTE:
+                case GL_SHORT:
+                case GL_UNSIGNED_SHORT:
+                case GL_INT:
+                case GL_UNSIGNED_INT:
+                    isInteger = !attr.normalized;
+                    break;
+            }
+
+            if (isInteger)
+            {
+                glVertexArrayAttribIFormat(vao, attr.loc, attr.count, attr.type, offset);
+            }
+            else
+            {
+                glVertexArrayAttribFormat(vao, attr.loc, attr.count, attr.type, attr.normalized, offset);
+            }
+
+            glVertexArrayAttribBinding(vao, attr.loc, bindingIndex);
+            offset += attr.count * attr.size;
+        }
+    }
+
+} // namespace comet
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <rendering/vertexFormat.h>
+
+#include <vector>
+
+namespace comet
+{
+
+    class OpenglVertexFormat : public VertexFormat
+    {
+    public:
+        OpenglVertexFormat(const std::vector<const VertexBufferLayout*>& layouts);
+        virtual ~OpenglVertexFormat();
+
+        virtual void bind() const override;
+        virtual void unbind() const override;
+
+        virtual void bindVertexBuffer(uint32_t bindingIndex, const Buffer& vbo) const override;
+        virtual void bindIndexBuffer(const Buffer& ibo) const override;
+
+        // Attributes formats of the layout, read from the binding point 'bindingIndex' of the vertex array
+        static void setupLayout(uint32_t vao, uint32_t bindingIndex, const VertexBufferLayout& vbl);
+
+    private:
+        // Buffer attached to a binding point, the name alone can be reused by a new buffer object
+        struct AttachedBuffer
+        {
+            const Buffer* buffer{nullptr};
+            uint32_t bufferId{0};
+        };
+
+        // Forget the attachments when a buffer has been deleted since they were recorded
+        void checkBufferDeletions() const;
+
+    private:
+        unsigned int m_vao{0};
+        std::vector<uint32_t> m_strides;
+        mutable std::vector<AttachedBuffer> m_vertexBuffers;
+        mutable AttachedBuffer m_indexBuffer;
+        mutable uint32_t m_bufferDeletionCount{0};
+    };
+
+} // namespace comet
@@ -0,0 +1,232 @@
+#include "bcEncoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COMET_BC_ENCODER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace comet
+{
+
+    // Per channel minimum and maximum of the 16 pixels
+    static void computeBounds(const uint8_t block[64], uint8_t minColor[4], uint8_t maxColor[4])
+    {
+#ifdef COMET_BC_ENCODER_SSE2
+        auto row0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+        auto row1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16));
+        auto row2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 32));
+        auto row3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 48));
+
+        auto minimum = _mm_min_epu8(_mm_min_epu8(row0, row1), _mm_min_epu8(row2, row3));
+        auto maximum = _mm_max_epu8(_mm_max_epu8(row0, row1), _mm_max_epu8(row2, row3));
+
+        // 4 pixels left in each register
+        minimum = _mm_min_epu8(minimum, _mm_shuffle_epi32(minimum, _MM_SHUFFLE(1, 0, 3, 2)));
+        minimum = _mm_min_epu8(minimum, _mm_shuffle_epi32(minimum, _MM_SHUFFLE(2, 3, 0, 1)));
+        maximum = _mm_max_epu8(maximum, _mm_shuffle_epi32(maximum, _MM_SHUFFLE(1, 0, 3, 2)));
+        maximum = _mm_max_epu8(maximum, _mm_shuffle_epi32(maximum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        auto minPacked = _mm_cvtsi128_si32(minimum);
+        auto maxPacked = _mm_cvtsi128_si32(maximum);
+        memcpy(minColor, &minPacked, 4);
+        memcpy(maxColor, &maxPacked, 4);
+#else
+        for (uint32_t channel = 0; channel < 4; ++channel)
+        {
+            minColor[channel] = 255;
+            maxColor[channel] = 0;
+        }
+
+        for (uint32_t pixel = 0; pixel < 16; ++pixel)
+        {
+            for (uint32_t channel = 0; channel < 4; ++channel)
+            {
+                minColor[channel] = std::min(minColor[channel], block[pixel * 4 + channel]);
+                maxColor[channel] = std::max(maxColor[channel], block[pixel * 4 + channel]);
+            }
+        }
+#endif
+    }
+
+    // (pixel - origin) . axis on the RGB channels of the 16 pixels
+    static void computeProjections(const uint8_t block[64], const int16_t origin[3], const int16_t axis[3], int32_t projections[16])
+    {
+#ifdef COMET_BC_ENCODER_SSE2
+        auto zero = _mm_setzero_si128();
+        auto originVector = _mm_setr_epi16(origin[0], origin[1], origin[2], 0, origin[0], origin[1], origin[2], 0);
+        auto axisVector = _mm_setr_epi16(axis[0], axis[1], axis[2], 0, axis[0], axis[1], axis[2], 0);
+
+        for (uint32_t row = 0; row < 4; ++row)
+        {
+            auto pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + row * 16));
+
+            // Two pixels per register, as 16 bits channels: [r g b a r g b a]
+            auto low = _mm_madd_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(pixels, zero), originVector), axisVector);
+            auto high = _mm_madd_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(pixels, zero), originVector), axisVector);
+
+            // [rg, b, rg, b] to [p, p, p', p']
+            low = _mm_add_epi32(low, _mm_shuffle_epi32(low, _MM_SHUFFLE(2, 3, 0, 1)));
+            high = _mm_add_epi32(high, _mm_shuffle_epi32(high, _MM_SHUFFLE(2, 3, 0, 1)));
+
+            low = _mm_shuffle_epi32(low, _MM_SHUFFLE(3, 1, 2, 0));
+            high = _mm_shuffle_epi32(high, _MM_SHUFFLE(3, 1, 2, 0));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(projections + row * 4), _mm_unpacklo_epi64(low, high));
+        }
+#else
+        for (uint32_t pixel = 0; pixel < 16; ++pixel)
+        {
+            int32_t projection = 0;
+            for (uint32_t channel = 0; channel < 3; ++channel)
+            {
+                projection += (block[pixel * 4 + channel] - origin[channel]) * axis[channel];
+            }
+            projections[pixel] = projection;
+        }
+#endif
+    }
+
+    static uint16_t toRGB565(const uint8_t color[4])
+    {
+        uint32_t r = (color[0] * 31 + 127) / 255;
+        uint32_t g = (color[1] * 63 + 127) / 255;
+        uint32_t b = (color[2] * 31 + 127) / 255;
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    static void fromRGB565(uint16_t packed, int16_t color[3])
+    {
+        uint32_t r = (packed >> 11) & 31;
+        uint32_t g = (packed >> 5) & 63;
+        uint32_t b = packed & 31;
+        color[0] = static_cast<int16_t>((r << 3) | (r >> 2));
+        color[1] = static_cast<int16_t>((g << 2) | (g >> 4));
+        color[2] = static_cast<int16_t>((b << 3) | (b >> 2));
+    }
+
+    // Always in 4 colors mode (color0 > color1) unless all the colors are the same
+    static void encodeColorBlock(const uint8_t block[64], const uint8_t minColor[4], const uint8_t maxColor[4], uint8_t output[8])
+    {
+        // The endpoints are moved inside the bounding box by 1/16 of its size, the extreme colors are rarely all present
+        uint8_t insetMin[4], insetMax[4];
+        for (uint32_t channel = 0; channel < 3; ++channel)
+        {
+            auto inset = (maxColor[channel] - minColor[channel]) >> 4;
+            insetMin[channel] = static_cast<uint8_t>(minColor[channel] + inset);
+            insetMax[channel] = static_cast<uint8_t>(maxColor[channel] - inset);
+        }
+
+        auto color0 = toRGB565(insetMax);
+        auto color1 = toRGB565(insetMin);
+        if (color0 < color1)
+        {
+            std::swap(color0, color1);
+        }
+
+        uint32_t indices = 0;
+        if (color0 != color1)
+        {
+            int16_t endpoint0[3], endpoint1[3], axis[3];
+            fromRGB565(color0, endpoint0);
+            fromRGB565(color1, endpoint1);
+            for (uint32_t channel = 0; channel < 3; ++channel)
+            {
+                axis[channel] = endpoint0[channel] - endpoint1[channel];
+            }
+
+            int32_t projections[16];
+            computeProjections(block, endpoint1, axis, projections);
+
+            // Position on the axis in thirds from color1 (0) to color0 (3), to the palette index
+            static constexpr uint32_t PALETTE_INDEX[4] = {1, 3, 2, 0};
+            int32_t axisLength2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+            for (uint32_t pixel = 0; pixel < 16; ++pixel)
+            {
+                auto position = (projections[pixel] * 3 + axisLength2 / 2) / axisLength2;
+                position = std::clamp(position, 0, 3);
+                indices |= PALETTE_INDEX[position] << (pixel * 2);
+            }
+        }
+
+        memcpy(output, &color0, 2);
+        memcpy(output + 2, &color1, 2);
+        memcpy(output + 4, &indices, 4);
+    }
+
+    void encodeBC1Block(const uint8_t block[64], uint8_t output[8])
+    {
+        uint8_t minColor[4], maxColor[4];
+        computeBounds(block, minColor, maxColor);
+        encodeColorBlock(block, minColor, maxColor, output);
+    }
+
+    void encodeBC3Block(const uint8_t block[64], uint8_t output[16])
+    {
+        uint8_t minColor[4], maxColor[4];
+        computeBounds(block, minColor, maxColor);
+
+        // 8 alphas mode (alpha0 > alpha1): 0 is alpha0, 1 is alpha1, 2 to 7 are interpolated from alpha0 to alpha1
+        auto alpha0 = maxColor[3];
+        auto alpha1 = minColor[3];
+        uint64_t alphaIndices = 0;
+        if (alpha0 != alpha1)
+        {
+            int32_t range = alpha0 - alpha1;
+            for (uint32_t pixel = 0; pixel < 16; ++pixel)
+            {
+                uint64_t position = ((alpha0 - block[pixel * 4 + 3]) * 7 + range / 2) / range;
+                uint64_t alphaIndex = position == 0 ? 0 : (position == 7 ? 1 : position + 1);
+                alphaIndices |= alphaIndex << (pixel * 3);
+            }
+        }
+
+        output[0] = alpha0;
+        output[1] = alpha1;
+        for (uint32_t i = 0; i < 6; ++i)
+        {
+            output[2 + i] = static_cast<uint8_t>(alphaIndices >> (i * 8));
+        }
+
+        encodeColorBlock(block, minColor, maxColor, output + 8);
+    }
+
+    bool encodeBCImage(TextureFormat format, const uint8_t* pixels, uint32_t width, uint32_t height, uint8_t* output)
+    {
+        if (format != TextureFormat::BC1 && format != TextureFormat::BC3)
+        {
+            return false;
+        }
+
+        auto blockSize = format == TextureFormat::BC1 ? 8 : 16;
+        uint8_t block[64];
+        for (uint32_t blockY = 0; blockY < height; blockY += 4)
+        {
+            for (uint32_t blockX = 0; blockX < width; blockX += 4)
+            {
+                for (uint32_t y = 0; y < 4; ++y)
+                {
+                    auto row = pixels + static_cast<size_t>(std::min(blockY + y, height - 1)) * width * 4;
+                    for (uint32_t x = 0; x < 4; ++x)
+                    {
+                        memcpy(block + (y * 4 + x) * 4, row + std::min(blockX + x, width - 1) * 4, 4);
+                    }
+                }
+
+                if (format == TextureFormat::BC1)
+                {
+                    encodeBC1Block(block, output);
+                }
+                else
+                {
+                    encodeBC3Block(block, output);
+                }
+                output += blockSize;
+            }
+        }
+
+        return true;
+    }
+
+} // namespace comet
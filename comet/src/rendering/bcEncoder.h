@@ -0,0 +1,21 @@
+#pragma once
+
+#include <comet/texture.h>
+
+#include <cstdint>
+
+namespace comet
+{
+
+    // CPU block compression of RGBA8 pixels (SSE2 when available), used when cooking the textures.
+    // The endpoints are the inset bounding box of the block colors, the pixels are projected on the box diagonal:
+    // fast and good enough for albedo textures, not a high quality encoder.
+    // 'block' holds the 16 pixels of the block, row by row.
+    void encodeBC1Block(const uint8_t block[64], uint8_t output[8]);
+    void encodeBC3Block(const uint8_t block[64], uint8_t output[16]);
+
+    // Compress a 'width' x 'height' RGBA8 level: the last column and row are repeated to fill the edge blocks.
+    // 'output' must hold getTextureFormatLevelSize(format, width, height) bytes. Only BC1 and BC3 are supported.
+    bool encodeBCImage(TextureFormat format, const uint8_t* pixels, uint32_t width, uint32_t height, uint8_t* output);
+
+} // namespace comet
@@ -18,17 +18,30 @@ namespace comet
         virtual void bind() const = 0;
         virtual void unbind() const = 0;
 
+        // Bind [offset, offset + size[ of the buffer to a shader storage binding point (whole buffer when size is 0)
+        virtual void bindStorage(uint32_t bindingIndex, size_t offset = 0, size_t size = 0) const = 0;
+
         // allocate with the size defined by setSize()
         virtual void allocate() = 0;
         virtual void allocate(size_t size) = 0;
+        // The storage is immutable: allocate() creates a new buffer object.
+        // grow() also replaces the buffer object, copying the content on the GPU side.
+        // The vertex arrays referencing the buffer attach the new object when they are bound.
+        virtual void grow(size_t size) = 0;
 
         virtual void* mapMemory(uint32_t access) = 0;
         virtual void unmapMemory() = 0;
 
+        // Write 'size' bytes at 'offset' of the allocated storage, without mapping it
+        virtual void loadData(const void* data, size_t size, size_t offset) = 0;
+
         virtual void setSize(size_t size) = 0;
         virtual size_t getSize() const = 0;
         virtual uint32_t getCount() const = 0;
         virtual void increaseSize(size_t size) = 0;
+
+        // Graphic API name of the buffer object (changes when the storage is re-allocated)
+        virtual uint32_t getId() const = 0;
     };
     
 }
\ No newline at end of file
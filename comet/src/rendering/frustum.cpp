@@ -0,0 +1,83 @@
+#include <rendering/frustum.h>
+
+#include <glm/geometric.hpp>
+#include <glm/gtc/matrix_access.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define COMET_FRUSTUM_SSE 1
+    #include <emmintrin.h>
+#endif
+
+namespace comet
+{
+
+    Frustum Frustum::fromViewProjection(const glm::mat4& viewProjection)
+    {
+        // Gribb & Hartmann plane extraction
+        auto row0 = glm::row(viewProjection, 0);
+        auto row1 = glm::row(viewProjection, 1);
+        auto row2 = glm::row(viewProjection, 2);
+        auto row3 = glm::row(viewProjection, 3);
+
+        Frustum frustum{{row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3 + row2, row3 - row2}};
+        for (auto& plane : frustum.planes)
+        {
+            plane /= glm::length(glm::vec3(plane));
+        }
+
+        return frustum;
+    }
+
+    void Frustum::cullSpheres(const float* centersX, const float* centersY, const float* centersZ, const float* radii,
+                              uint8_t* visibility, size_t count) const
+    {
+        size_t i = 0;
+
+#ifdef COMET_FRUSTUM_SSE
+        __m128 planesX[6], planesY[6], planesZ[6], planesW[6];
+        for (int p = 0; p < 6; ++p)
+        {
+            planesX[p] = _mm_set1_ps(planes[p].x);
+            planesY[p] = _mm_set1_ps(planes[p].y);
+            planesZ[p] = _mm_set1_ps(planes[p].z);
+            planesW[p] = _mm_set1_ps(planes[p].w);
+        }
+
+        const __m128 zero = _mm_setzero_ps();
+        for (; i + 4 <= count; i += 4)
+        {
+            auto x = _mm_loadu_ps(centersX + i);
+            auto y = _mm_loadu_ps(centersY + i);
+            auto z = _mm_loadu_ps(centersZ + i);
+            auto negRadius = _mm_sub_ps(zero, _mm_loadu_ps(radii + i));
+
+            // Visible while the signed distance to every plane is >= -radius
+            auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int p = 0; p < 6; ++p)
+            {
+                auto distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planesX[p], x), _mm_mul_ps(planesY[p], y)),
+                                           _mm_add_ps(_mm_mul_ps(planesZ[p], z), planesW[p]));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+            }
+
+            auto mask = _mm_movemask_ps(inside);
+            visibility[i + 0] = (mask >> 0) & 1;
+            visibility[i + 1] = (mask >> 1) & 1;
+            visibility[i + 2] = (mask >> 2) & 1;
+            visibility[i + 3] = (mask >> 3) & 1;
+        }
+#endif
+
+        for (; i < count; ++i)
+        {
+            uint8_t inside = 1;
+            for (auto& plane : planes)
+            {
+                auto distance = plane.x * centersX[i] + plane.y * centersY[i] + plane.z * centersZ[i] + plane.w;
+                inside &= (distance >= -radii[i]);
+            }
+            visibility[i] = inside;
+        }
+    }
+
+} // namespace comet
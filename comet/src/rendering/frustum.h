@@ -0,0 +1,25 @@
+#pragma once
+
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace comet
+{
+
+    struct Frustum
+    {
+        // Planes (left, right, bottom, top, near, far) with normals pointing inside the frustum
+        glm::vec4 planes[6];
+
+        static Frustum fromViewProjection(const glm::mat4& viewProjection);
+
+        // Test 'count' bounding spheres stored as SoA against the frustum (SSE when available).
+        // visibility[i] is set to 1 when the sphere i intersects the frustum, 0 otherwise.
+        void cullSpheres(const float* centersX, const float* centersY, const float* centersZ, const float* radii,
+                         uint8_t* visibility, size_t count) const;
+    };
+
+} // namespace comet
@@ -0,0 +1,244 @@
+#include <rendering/geometryPool.h>
+#include <comet/staticMesh.h>
+#include <comet/log.h>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace comet
+{
+    // Initial capacity of the pool buffers (~1MB of vertices, ~1MB of indices)
+    static constexpr uint32_t INITIAL_VERTEX_CAPACITY = 64 * 1024;
+    static constexpr uint32_t INITIAL_INDEX_CAPACITY = 256 * 1024;
+
+    uint32_t FreeListAllocator::allocate(uint32_t count)
+    {
+        if (count == 0)
+        {
+            return 0;
+        }
+
+        for (auto it = m_freeRanges.begin(); it != m_freeRanges.end(); ++it)
+        {
+            auto [offset, freeCount] = *it;
+            if (freeCount < count)
+            {
+                continue;
+            }
+
+            m_freeRanges.erase(it);
+            if (freeCount > count)
+            {
+                m_freeRanges.emplace(offset + count, freeCount - count);
+            }
+            m_usedCount += count;
+
+            return offset;
+        }
+
+        return INVALID_OFFSET;
+    }
+
+    void FreeListAllocator::free(uint32_t offset, uint32_t count)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        m_usedCount -= count;
+        auto it = m_freeRanges.emplace(offset, count).first;
+
+        // Merge with the next range
+        auto nextIt = std::next(it);
+        if (nextIt != m_freeRanges.end() && it->first + it->second == nextIt->first)
+        {
+            it->second += nextIt->second;
+            m_freeRanges.erase(nextIt);
+        }
+
+        // Merge with the previous range
+        if (it != m_freeRanges.begin())
+        {
+            auto prevIt = std::prev(it);
+            if (prevIt->first + prevIt->second == it->first)
+            {
+                prevIt->second += it->second;
+                m_freeRanges.erase(it);
+            }
+        }
+    }
+
+    void FreeListAllocator::grow(uint32_t newCapacity)
+    {
+        if (newCapacity <= m_capacity)
+        {
+            return;
+        }
+
+        auto addedCount = newCapacity - m_capacity;
+        auto offset = m_capacity;
+        m_capacity = newCapacity;
+
+        // free() expects the range to be accounted as used
+        m_usedCount += addedCount;
+        free(offset, addedCount);
+    }
+
+    // Octahedral encoding of a unit vector, in [-1, 1]^2
+    static glm::vec2 encodeOctahedral(const glm::vec3& normal)
+    {
+        auto l1Norm = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        if (l1Norm == 0.0f)
+        {
+            return glm::vec2(0.0f);
+        }
+
+        auto n = normal / l1Norm;
+        glm::vec2 encoded(n.x, n.y);
+        if (n.z < 0.0f)
+        {
+            // Fold the lower hemisphere over the diagonals
+            glm::vec2 signs(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+            encoded = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * signs;
+        }
+
+        return encoded;
+    }
+
+    static void packVertices(const std::vector<Vertex>& vertices, const glm::vec3& positionOffset, const glm::vec3& positionScale,
+                             std::vector<PackedVertex>& packedVertices)
+    {
+        auto invScale = 1.0f / positionScale;
+
+        packedVertices.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); ++i)
+        {
+            auto& vertex = vertices[i];
+            auto position = glm::clamp((vertex.position - positionOffset) * invScale, -1.0f, 1.0f);
+            packedVertices[i].position = glm::packSnorm4x16(glm::vec4(position, 0.0f));
+            // Normal of the quantized surface: the shaders divide it by the instance scale, which includes positionScale
+            packedVertices[i].normal = glm::packSnorm2x16(encodeOctahedral(glm::normalize(vertex.normal * positionScale)));
+            packedVertices[i].texCoord = glm::packHalf2x16(vertex.tc);
+        }
+    }
+
+    void GeometryPool::createBuffers()
+    {
+        if (m_vbo)
+        {
+            return;
+        }
+
+        m_vbo = VertexBuffer::create(GL_STATIC_DRAW);
+        m_vbo->allocate(INITIAL_VERTEX_CAPACITY * sizeof(PackedVertex));
+        m_vertexAllocator.grow(INITIAL_VERTEX_CAPACITY);
+
+        for (auto indexType : {IndexType::UINT16, IndexType::UINT32})
+        {
+            auto& indexPool = getIndexPool(indexType);
+            indexPool.ibo = IndexBuffer::create(GL_STATIC_DRAW, indexType);
+            indexPool.ibo->allocate(INITIAL_INDEX_CAPACITY * getIndexSize(indexType));
+            indexPool.allocator.grow(INITIAL_INDEX_CAPACITY);
+        }
+    }
+
+    VertexBuffer& GeometryPool::getVertexBuffer()
+    {
+        createBuffers();
+        return *m_vbo.get();
+    }
+
+    IndexBuffer& GeometryPool::getIndexBuffer(IndexType indexType)
+    {
+        createBuffers();
+        return *getIndexPool(indexType).ibo.get();
+    }
+
+    uint32_t GeometryPool::allocateVertices(uint32_t vertexCount)
+    {
+        auto firstVertex = m_vertexAllocator.allocate(vertexCount);
+        if (firstVertex == FreeListAllocator::INVALID_OFFSET)
+        {
+            // The existing geometry is copied on the GPU side, it is never uploaded again
+            auto capacity = std::max(m_vertexAllocator.getCapacity() + vertexCount, 2 * m_vertexAllocator.getCapacity());
+            m_vbo->grow(capacity * sizeof(PackedVertex));
+            m_vertexAllocator.grow(capacity);
+            firstVertex = m_vertexAllocator.allocate(vertexCount);
+        }
+
+        return firstVertex;
+    }
+
+    uint32_t GeometryPool::allocateIndices(IndexType indexType, uint32_t indexCount)
+    {
+        auto& indexPool = getIndexPool(indexType);
+        auto firstIndex = indexPool.allocator.allocate(indexCount);
+        if (firstIndex == FreeListAllocator::INVALID_OFFSET)
+        {
+            auto capacity = std::max(indexPool.allocator.getCapacity() + indexCount, 2 * indexPool.allocator.getCapacity());
+            indexPool.ibo->grow(capacity * getIndexSize(indexType));
+            indexPool.allocator.grow(capacity);
+            firstIndex = indexPool.allocator.allocate(indexCount);
+        }
+
+        return firstIndex;
+    }
+
+    const GeometryAllocation& GeometryPool::upload(uint32_t staticMeshId, const StaticMesh& staticMesh)
+    {
+        if (auto it = m_allocations.find(staticMeshId); it != m_allocations.end())
+        {
+            return it->second;
+        }
+
+        createBuffers();
+
+        GeometryAllocation allocation;
+        allocation.vertexCount = staticMesh.getVertexCount();
+        allocation.firstVertex = allocateVertices(allocation.vertexCount);
+
+        // Positions are quantized in the mesh AABB, each axis uses the whole snorm range (a flat axis keeps a unit scale)
+        auto halfExtent = (staticMesh.getAabbMax() - staticMesh.getAabbMin()) * 0.5f;
+        allocation.positionOffset = (staticMesh.getAabbMin() + staticMesh.getAabbMax()) * 0.5f;
+        allocation.positionScale = glm::mix(glm::vec3(1.0f), halfExtent, glm::greaterThan(halfExtent, glm::vec3(0.0f)));
+
+        std::vector<PackedVertex> packedVertices;
+        packVertices(staticMesh.getVertices(), allocation.positionOffset, allocation.positionScale, packedVertices);
+        m_vbo->loadData(packedVertices.data(), packedVertices.size() * sizeof(PackedVertex), allocation.firstVertex * sizeof(PackedVertex));
+
+        if (staticMesh.hasIndices())
+        {
+            // Indices are relative to the mesh vertices (the draw commands provide the base vertex)
+            allocation.indexType = staticMesh.getIndexType();
+            allocation.indexCount = staticMesh.getIndexCount();
+            allocation.firstIndex = allocateIndices(allocation.indexType, allocation.indexCount);
+            getIndexPool(allocation.indexType).ibo->loadData(staticMesh.getIndexData(), staticMesh.getIndicesSize(),
+                                                             allocation.firstIndex * getIndexSize(allocation.indexType));
+        }
+
+        CM_CORE_LOG_DEBUG("Geometry of mesh {} uploaded to the pool (first vertex: {}, first index: {}, index size: {})",
+                          staticMesh.getName(), allocation.firstVertex, allocation.firstIndex, getIndexSize(allocation.indexType));
+
+        return m_allocations.emplace(staticMeshId, allocation).first->second;
+    }
+
+    void GeometryPool::release(uint32_t staticMeshId)
+    {
+        auto it = m_allocations.find(staticMeshId);
+        if (it == m_allocations.end())
+        {
+            return;
+        }
+
+        auto& allocation = it->second;
+        m_vertexAllocator.free(allocation.firstVertex, allocation.vertexCount);
+        getIndexPool(allocation.indexType).allocator.free(allocation.firstIndex, allocation.indexCount);
+        m_allocations.erase(it);
+    }
+
+} // namespace comet
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <comet/singleton.h>
+#include <rendering/vertexBuffer.h>
+#include <rendering/indexBuffer.h>
+
+#include <glm/vec3.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+namespace comet
+{
+    class StaticMesh;
+
+    // First-fit free list of [offset, offset + count[ ranges, adjacent free ranges are merged
+    class FreeListAllocator
+    {
+    public:
+        static constexpr uint32_t INVALID_OFFSET = std::numeric_limits<uint32_t>::max();
+
+        uint32_t allocate(uint32_t count);
+        void free(uint32_t offset, uint32_t count);
+
+        // Append [capacity, newCapacity[ to the free ranges
+        void grow(uint32_t newCapacity);
+
+        uint32_t getCapacity() const { return m_capacity; }
+        uint32_t getUsedCount() const { return m_usedCount; }
+
+    private:
+        // offset -> count
+        std::map<uint32_t, uint32_t> m_freeRanges{};
+        uint32_t m_capacity{0};
+        uint32_t m_usedCount{0};
+    };
+
+    // Vertex as stored in the GeometryPool (16 bytes instead of 32 for a Vertex)
+    struct PackedVertex
+    {
+        uint64_t position;   // snorm16 x 4: (position - positionOffset) / positionScale (per axis), w unused
+        uint32_t normal;     // snorm16 x 2: octahedral encoding
+        uint32_t texCoord;   // half x 2
+    };
+    static_assert(sizeof(PackedVertex) == 16, "Must match the vertex layout of the SceneRenderer");
+
+    // Location of a mesh geometry in the vertex / index buffers of the GeometryPool
+    struct GeometryAllocation
+    {
+        uint32_t firstVertex{0};
+        uint32_t vertexCount{0};
+        // In the index buffer of indexType, firstIndex is counted in indices of that type
+        IndexType indexType{IndexType::UINT32};
+        uint32_t firstIndex{0};
+        uint32_t indexCount{0};
+        // Dequantization of the positions: position = positionOffset + positionScale * quantized position.
+        // The scale is folded in the model transform: the normals are stored for the quantized positions.
+        glm::vec3 positionOffset{0.0f};
+        glm::vec3 positionScale{1.0f};
+    };
+
+    // Single vertex buffer and one index buffer per index type holding the geometry of all the static meshes.
+    // The geometry of a mesh is uploaded once (as PackedVertex), the draw contexts only reference its offsets.
+    class GeometryPool : public Singleton<GeometryPool>
+    {
+    public:
+        // Upload the mesh geometry if it is not in the pool yet
+        const GeometryAllocation& upload(uint32_t staticMeshId, const StaticMesh& staticMesh);
+        void release(uint32_t staticMeshId);
+
+        VertexBuffer& getVertexBuffer();
+        IndexBuffer& getIndexBuffer(IndexType indexType);
+
+        uint32_t getVertexCount() const { return m_vertexAllocator.getUsedCount(); }
+        uint32_t getIndexCount(IndexType indexType) const { return getIndexPool(indexType).allocator.getUsedCount(); }
+
+    private:
+        struct IndexPool
+        {
+            std::unique_ptr<IndexBuffer> ibo;
+            FreeListAllocator allocator{};
+        };
+
+        void createBuffers();
+        uint32_t allocateVertices(uint32_t vertexCount);
+        uint32_t allocateIndices(IndexType indexType, uint32_t indexCount);
+
+        IndexPool& getIndexPool(IndexType indexType) { return m_indexPools[static_cast<uint32_t>(indexType)]; }
+        const IndexPool& getIndexPool(IndexType indexType) const { return m_indexPools[static_cast<uint32_t>(indexType)]; }
+
+    private:
+        static constexpr uint32_t INDEX_TYPE_COUNT = 2;
+
+        std::unique_ptr<VertexBuffer> m_vbo;
+        FreeListAllocator m_vertexAllocator{};
+        IndexPool m_indexPools[INDEX_TYPE_COUNT];
+        std::unordered_map<uint32_t, GeometryAllocation> m_allocations{};
+    };
+
+} // namespace comet
@@ -6,12 +6,12 @@
 namespace comet
 {
 
-    std::unique_ptr<IndexBuffer> IndexBuffer::create(uint32_t usage)
+    std::unique_ptr<IndexBuffer> IndexBuffer::create(uint32_t usage, IndexType indexType /*= IndexType::UINT32*/)
     {
         switch (GraphicApiConfig::getApiImpl())
         {
             case GraphicApiConfig::API::OPENGL:
-                return std::make_unique<OpenglIndexBuffer>(usage);
+                return std::make_unique<OpenglIndexBuffer>(usage, indexType);
         }
         
         ASSERT(false, "Graphic API not supported for now!");
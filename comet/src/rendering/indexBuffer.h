@@ -5,13 +5,26 @@
 
 namespace comet
 {
+    enum class IndexType : uint8_t
+    {
+        UINT16,
+        UINT32
+    };
+
+    inline uint32_t getIndexSize(IndexType indexType)
+    {
+        return (indexType == IndexType::UINT16) ? sizeof(uint16_t) : sizeof(uint32_t);
+    }
+
     class IndexBuffer : public Buffer
     {
     public:
         virtual ~IndexBuffer() {};
 
-        virtual void loadDataInMappedMemory(const uint32_t* data, uint32_t count, uint32_t offset = 0) = 0;
+        // 'count' indices of the buffer index type
+        virtual void loadDataInMappedMemory(const void* data, uint32_t count, uint32_t offset = 0) = 0;
+        virtual IndexType getIndexType() const = 0;
 
-        static std::unique_ptr<IndexBuffer> create(uint32_t usage);
+        static std::unique_ptr<IndexBuffer> create(uint32_t usage, IndexType indexType = IndexType::UINT32);
     };
 }
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include <rendering/lightBuffer.h>
+#include <comet/light.h>
+#include <comet/directionalLight.h>
+#include <comet/pointLight.h>
+#include <comet/spotLight.h>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+
+namespace comet
+{
+
+    bool LightBuffer::hasChanged(const std::vector<std::unique_ptr<Light>>& lights, uint32_t lightsVersion) const
+    {
+        if (!m_buffer || lightsVersion != m_lightsVersion || lights.size() != m_lightVersions.size())
+        {
+            return true;
+        }
+
+        for (size_t i = 0; i < lights.size(); ++i)
+        {
+            if (lights[i]->getVersion() != m_lightVersions[i])
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void LightBuffer::pack(const std::vector<std::unique_ptr<Light>>& lights)
+    {
+        m_header = {};
+        m_lightsData.clear();
+        m_lightSpheres.clear();
+        m_lightVersions.clear();
+
+        for (auto& light : lights)
+        {
+            m_lightVersions.push_back(light->getVersion());
+
+            LightData lightData{};
+            glm::vec3 position;
+            float range;
+
+            if (light->getType() == LightType::DIRECTIONAL)
+            {
+                // The shaders handle a single directional light
+                if (m_header.directionalLightCount == 0)
+                {
+                    auto directionalLight = static_cast<DirectionalLight*>(light.get());
+                    m_header.directionalLight.direction = glm::vec4(directionalLight->getDirection(), 0.0f);
+                    m_header.directionalLight.ambient = glm::vec4(light->getAmbient(), 0.0f);
+                    m_header.directionalLight.diffuse = glm::vec4(light->getDiffuse(), 0.0f);
+                    m_header.directionalLight.specular = glm::vec4(light->getSpecular(), 0.0f);
+                    m_header.directionalLightCount = 1;
+                }
+                continue;
+            }
+            else if (light->getType() == LightType::POINT)
+            {
+                auto pointLight = static_cast<PointLight*>(light.get());
+                position = pointLight->getPosition();
+                range = pointLight->getRange();
+                lightData.directionType = glm::vec4(0.0f);
+                lightData.ambientLinear = glm::vec4(light->getAmbient(), pointLight->getLinearAttenuation());
+                lightData.diffuseQuadratic = glm::vec4(light->getDiffuse(), pointLight->getQuadraticAttenuation());
+                lightData.specularCutoff = glm::vec4(light->getSpecular(), 0.0f);
+            }
+            else
+            {
+                auto spotLight = static_cast<SpotLight*>(light.get());
+                position = spotLight->getPosition();
+                range = spotLight->getRange();
+                lightData.directionType = glm::vec4(spotLight->getDirection(), 1.0f);
+                lightData.ambientLinear = glm::vec4(light->getAmbient(), 0.0f);
+                lightData.diffuseQuadratic = glm::vec4(light->getDiffuse(), 0.0f);
+                lightData.specularCutoff = glm::vec4(light->getSpecular(), glm::cos(spotLight->getCutoffAngle()));
+                lightData.outerCutoff.x = glm::cos(spotLight->getOuterCutoffAngle());
+            }
+
+            lightData.positionRange = glm::vec4(position, range);
+            m_lightsData.push_back(lightData);
+            m_lightSpheres.emplace_back(position, range);
+        }
+
+        m_header.lightCount = static_cast<uint32_t>(m_lightsData.size());
+    }
+
+    bool LightBuffer::update(const std::vector<std::unique_ptr<Light>>& lights, uint32_t lightsVersion)
+    {
+        if (!hasChanged(lights, lightsVersion))
+        {
+            return false;
+        }
+
+        if (!m_buffer)
+        {
+            m_buffer = VertexBuffer::create(GL_DYNAMIC_DRAW);
+        }
+
+        pack(lights);
+        m_lightsVersion = lightsVersion;
+
+        auto lightsSize = m_lightsData.size() * sizeof(LightData);
+        auto requiredSize = sizeof(LightBufferHeader) + lightsSize;
+        if (requiredSize > m_buffer->getSize())
+        {
+            m_buffer->allocate(std::max(requiredSize, 2 * m_buffer->getSize()));
+        }
+
+        m_buffer->loadData(&m_header, sizeof(LightBufferHeader), 0);
+        if (lightsSize)
+        {
+            m_buffer->loadData(m_lightsData.data(), lightsSize, sizeof(LightBufferHeader));
+        }
+
+        m_version++;
+        return true;
+    }
+
+    void LightBuffer::bind() const
+    {
+        if (m_buffer)
+        {
+            m_buffer->bindStorage(LIGHTS_BINDING);
+        }
+    }
+
+} // namespace comet
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <rendering/vertexBuffer.h>
+
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace comet
+{
+    class Light;
+
+    struct DirectionalLightData
+    {
+        glm::vec4 direction;
+        glm::vec4 ambient;
+        glm::vec4 diffuse;
+        glm::vec4 specular;
+    };
+
+    // Point / Spot light as read by the shaders (std430)
+    struct LightData
+    {
+        glm::vec4 positionRange;         // xyz: world position, w: range
+        glm::vec4 directionType;         // xyz: spot direction, w: 0 point, 1 spot
+        glm::vec4 ambientLinear;         // xyz: ambient, w: linear attenuation
+        glm::vec4 diffuseQuadratic;      // xyz: diffuse, w: quadratic attenuation
+        glm::vec4 specularCutoff;        // xyz: specular, w: cos(cutoff)
+        glm::vec4 outerCutoff;           // x: cos(outer cutoff)
+    };
+
+    // Header of the lights buffer, followed by the LightData array
+    struct LightBufferHeader
+    {
+        DirectionalLightData directionalLight;
+        uint32_t directionalLightCount;
+        uint32_t lightCount;
+        uint32_t padding[2];
+    };
+    static_assert(sizeof(LightBufferHeader) == 80, "Must match the Lights buffer of cometPhong.fs.glsl");
+
+    // Lights of a scene packed in a single shader storage buffer.
+    // The lights are packed and uploaded again only when one of them (or the list of lights) changed.
+    class LightBuffer
+    {
+    public:
+        // Shader storage binding point of the lights
+        static constexpr uint32_t LIGHTS_BINDING = 4;
+
+        // Returns true when the buffer has been uploaded again
+        bool update(const std::vector<std::unique_ptr<Light>>& lights, uint32_t lightsVersion);
+        void bind() const;
+
+        // Incremented on each upload
+        uint32_t getVersion() const { return m_version; }
+
+        // Point / Spot lights spheres of influence in world space (xyz: center, w: range), same order as in the buffer
+        const std::vector<glm::vec4>& getLightSpheres() const { return m_lightSpheres; }
+
+    private:
+        bool hasChanged(const std::vector<std::unique_ptr<Light>>& lights, uint32_t lightsVersion) const;
+        void pack(const std::vector<std::unique_ptr<Light>>& lights);
+
+    private:
+        LightBufferHeader m_header{};
+        std::vector<LightData> m_lightsData;
+        std::vector<glm::vec4> m_lightSpheres;
+
+        // Versions of the lights at the last upload
+        std::vector<uint32_t> m_lightVersions;
+        uint32_t m_lightsVersion{0};
+        uint32_t m_version{0};
+
+        std::unique_ptr<VertexBuffer> m_buffer;
+    };
+
+} // namespace comet
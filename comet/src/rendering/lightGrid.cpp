@@ -0,0 +1,164 @@
+#include <rendering/lightGrid.h>
+#include <core/threadPool.h>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace comet
+{
+
+    LightGrid::LightGrid()
+    {
+        m_clustersBuffer = VertexBuffer::create(GL_DYNAMIC_DRAW);
+        m_lightIndicesBuffer = VertexBuffer::create(GL_DYNAMIC_DRAW);
+
+        m_sliceClusterLights.resize(SLICES);
+        for (auto& clusterLights : m_sliceClusterLights)
+        {
+            clusterLights.resize(TILES_X * TILES_Y);
+        }
+        m_clusterRanges.resize(CLUSTER_RANGES_OFFSET + CLUSTER_COUNT * 2);
+    }
+
+    void LightGrid::update(const LightBuffer& lightBuffer, const glm::mat4& view, const glm::mat4& projection)
+    {
+        if (m_clustersBuffer->getSize() && lightBuffer.getVersion() == m_lightBufferVersion &&
+            view == m_view && projection == m_projection)
+        {
+            return;
+        }
+        m_lightBufferVersion = lightBuffer.getVersion();
+        m_view = view;
+        m_projection = projection;
+
+        m_lightSpheres.clear();
+        for (auto& sphere : lightBuffer.getLightSpheres())
+        {
+            m_lightSpheres.emplace_back(glm::vec3(view * glm::vec4(glm::vec3(sphere), 1.0f)), sphere.w);
+        }
+
+        // Near / far planes of the perspective projection
+        m_near = projection[3][2] / (projection[2][2] - 1.0f);
+        m_far = projection[3][2] / (projection[2][2] + 1.0f);
+        if (!(m_near > 0.0f) || !std::isfinite(m_far) || m_far <= m_near)
+        {
+            // Infinite far plane (or not a perspective projection): keep a usable depth distribution
+            m_near = std::max(m_near, 0.01f);
+            m_far = m_near * 10000.0f;
+        }
+
+        assignLights(projection);
+        uploadBuffers();
+    }
+
+    void LightGrid::assignLights(const glm::mat4& projection)
+    {
+        auto logDepthRatio = std::log(m_far / m_near);
+        auto sliceDepth = [&](uint32_t slice)
+        {
+            return m_near * std::exp(logDepthRatio * slice / SLICES);
+        };
+
+        // Screen tile covering a view space point (the projection is applied to x and y only)
+        auto tileX = [&](float x, float depth)
+        {
+            auto ndc = (projection[0][0] * x - projection[2][0] * depth) / depth;
+            return std::clamp(static_cast<int>((ndc * 0.5f + 0.5f) * TILES_X), 0, static_cast<int>(TILES_X) - 1);
+        };
+        auto tileY = [&](float y, float depth)
+        {
+            auto ndc = (projection[1][1] * y - projection[2][1] * depth) / depth;
+            return std::clamp(static_cast<int>((ndc * 0.5f + 0.5f) * TILES_Y), 0, static_cast<int>(TILES_Y) - 1);
+        };
+
+        ThreadPool::getInstance().parallelFor(SLICES, 1, [&](size_t begin, size_t end)
+        {
+            for (auto slice = static_cast<uint32_t>(begin); slice < end; ++slice)
+            {
+                auto& clusterLights = m_sliceClusterLights[slice];
+                for (auto& lightIndices : clusterLights)
+                {
+                    lightIndices.clear();
+                }
+
+                auto sliceNear = sliceDepth(slice);
+                auto sliceFar = sliceDepth(slice + 1);
+                for (uint32_t lightIndex = 0; lightIndex < m_lightSpheres.size(); ++lightIndex)
+                {
+                    auto& sphere = m_lightSpheres[lightIndex];
+                    auto depth = -sphere.z;
+                    auto radius = sphere.w;
+                    auto minDepth = std::max(depth - radius, sliceNear);
+                    auto maxDepth = std::min(depth + radius, sliceFar);
+                    if (minDepth > maxDepth)
+                    {
+                        continue;
+                    }
+
+                    // The projected bounds of the sphere AABB are reached at its min or max depth in the slice
+                    int minTileX = std::min(tileX(sphere.x - radius, minDepth), tileX(sphere.x - radius, maxDepth));
+                    int maxTileX = std::max(tileX(sphere.x + radius, minDepth), tileX(sphere.x + radius, maxDepth));
+                    int minTileY = std::min(tileY(sphere.y - radius, minDepth), tileY(sphere.y - radius, maxDepth));
+                    int maxTileY = std::max(tileY(sphere.y + radius, minDepth), tileY(sphere.y + radius, maxDepth));
+
+                    for (auto y = minTileY; y <= maxTileY; ++y)
+                    {
+                        for (auto x = minTileX; x <= maxTileX; ++x)
+                        {
+                            clusterLights[y * TILES_X + x].push_back(lightIndex);
+                        }
+                    }
+                }
+            }
+        });
+
+        // Concatenate the lists, clusters are ordered by slice, then tile row, then tile column
+        m_lightIndices.clear();
+        for (uint32_t slice = 0; slice < SLICES; ++slice)
+        {
+            auto& clusterLights = m_sliceClusterLights[slice];
+            for (uint32_t tile = 0; tile < TILES_X * TILES_Y; ++tile)
+            {
+                auto cluster = slice * TILES_X * TILES_Y + tile;
+                m_clusterRanges[CLUSTER_RANGES_OFFSET + cluster * 2] = static_cast<uint32_t>(m_lightIndices.size());
+                m_clusterRanges[CLUSTER_RANGES_OFFSET + cluster * 2 + 1] = static_cast<uint32_t>(clusterLights[tile].size());
+                m_lightIndices.insert(m_lightIndices.end(), clusterLights[tile].begin(), clusterLights[tile].end());
+            }
+        }
+    }
+
+    void LightGrid::uploadBuffers()
+    {
+        // Shader storage ranges can't be empty
+        auto upload = [](VertexBuffer& buffer, const void* data, size_t size)
+        {
+            auto requiredSize = std::max<size_t>(size, 16);
+            if (requiredSize > buffer.getSize())
+            {
+                buffer.allocate(std::max(requiredSize, 2 * buffer.getSize()));
+            }
+            if (size)
+            {
+                buffer.loadData(data, size, 0);
+            }
+        };
+
+        // The clusters are preceded by the depth slices parameters: slice = log(depth) * scale + bias
+        auto logDepthRatio = std::log(m_far / m_near);
+        m_clusterRanges[0] = glm::floatBitsToUint(SLICES / logDepthRatio);
+        m_clusterRanges[1] = glm::floatBitsToUint(-SLICES * std::log(m_near) / logDepthRatio);
+
+        upload(*m_clustersBuffer.get(), m_clusterRanges.data(), m_clusterRanges.size() * sizeof(uint32_t));
+        upload(*m_lightIndicesBuffer.get(), m_lightIndices.data(), m_lightIndices.size() * sizeof(uint32_t));
+    }
+
+    void LightGrid::bind() const
+    {
+        m_clustersBuffer->bindStorage(CLUSTERS_BINDING);
+        m_lightIndicesBuffer->bindStorage(LIGHT_INDICES_BINDING);
+    }
+
+} // namespace comet
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <rendering/vertexBuffer.h>
+#include <rendering/lightBuffer.h>
+
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace comet
+{
+    // Clustered forward lighting: the view frustum is split in froxels (screen tiles x exponential depth slices)
+    // and each froxel gets the list of the lights whose sphere of influence intersects it.
+    // The lists are built on the CPU (one depth slice per task), the shaders only iterate the lights of their froxel.
+    // They are only rebuilt when the lights or the camera changed.
+    class LightGrid
+    {
+    public:
+        static constexpr uint32_t TILES_X = 16;
+        static constexpr uint32_t TILES_Y = 9;
+        static constexpr uint32_t SLICES = 24;
+        static constexpr uint32_t CLUSTER_COUNT = TILES_X * TILES_Y * SLICES;
+        // The cluster ranges follow the depth slices parameters (vec4)
+        static constexpr uint32_t CLUSTER_RANGES_OFFSET = 4;
+
+        // Shader storage binding points of the light grid buffers (the lights are at LightBuffer::LIGHTS_BINDING)
+        static constexpr uint32_t CLUSTERS_BINDING = 5;
+        static constexpr uint32_t LIGHT_INDICES_BINDING = 6;
+
+        LightGrid();
+
+        void update(const LightBuffer& lightBuffer, const glm::mat4& view, const glm::mat4& projection);
+
+        // Bind the light grid buffers, once per frame for all the shaders
+        void bind() const;
+
+        uint32_t getLightCount() const { return static_cast<uint32_t>(m_lightSpheres.size()); }
+        uint32_t getLightIndexCount() const { return static_cast<uint32_t>(m_lightIndices.size()); }
+
+    private:
+        void assignLights(const glm::mat4& projection);
+        void uploadBuffers();
+
+    private:
+        // Spheres of influence in view space (xyz: center, w: radius)
+        std::vector<glm::vec4> m_lightSpheres;
+
+        // Light lists of the clusters of each depth slice, then merged in m_lightIndices
+        std::vector<std::vector<std::vector<uint32_t>>> m_sliceClusterLights;
+        // Depth slices parameters, then (offset, count) in m_lightIndices, per cluster
+        std::vector<uint32_t> m_clusterRanges;
+        std::vector<uint32_t> m_lightIndices;
+
+        float m_near{0.1f};
+        float m_far{100.0f};
+
+        // State of the last update
+        uint32_t m_lightBufferVersion{0};
+        glm::mat4 m_view{0.0f};
+        glm::mat4 m_projection{0.0f};
+
+        std::unique_ptr<VertexBuffer> m_clustersBuffer;
+        std::unique_ptr<VertexBuffer> m_lightIndicesBuffer;
+    };
+
+} // namespace comet
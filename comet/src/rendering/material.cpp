@@ -1,17 +1,22 @@
 #include <comet/material.h>
 #include <comet/shaderRegistry.h>
+#include <comet/shader.h>
 
 #include <comet/textureRegistry.h>
 #include <comet/resourceManager.h>
 #include <comet/materialRegistry.h>
 #include <comet/utils.h>
 
-#include <sstream>
+#include <array>
 
 namespace comet
 {
     const char* Material::MATERIAL_ALBEDO_TEXTURE_NAME = "cometMaterial-AlbedoTextureArray";
 
+    static constexpr UniformId ALBEDO_TEXTURES_UNIFORM{"albedo_textures"};
+    static constexpr UniformId WHITE_TEXTURE_UNIFORM{"white_1x1_texture"};
+    static constexpr float ALBEDO_MAX_ANISOTROPY = 8.0f;
+
     Shader* Material::getShader()
     {
         if (m_shader == nullptr)
@@ -21,74 +26,118 @@ namespace comet
         return m_shader;
     }
 
-    Texture2DArray* Material::getAlbedoTextureArray()
+    // The albedo textures of different sizes and formats go to different arrays of the pool
+    Texture2DArrayPool* Material::getAlbedoTexturePool()
     {
-        static Texture2DArray* albedoTexture = TextureRegistry::getInstance().getTexture2DArray(Material::MATERIAL_ALBEDO_TEXTURE_NAME);
-        return albedoTexture;
+        static Texture2DArrayPool* albedoTexturePool = []()
+        {
+            // Albedo textures are mostly seen at grazing angles (ground, walls): trilinear and anisotropic filtering
+            auto texturePool = TextureRegistry::getInstance().getTexture2DArrayPool(Material::MATERIAL_ALBEDO_TEXTURE_NAME);
+            SamplerDescription samplerDescription;
+            samplerDescription.maxAnisotropy = ALBEDO_MAX_ANISOTROPY;
+            texturePool->setSamplerDescription(samplerDescription);
+            return texturePool;
+        }();
+        return albedoTexturePool;
     }
 
+    void Material::markDirty()
+    {
+        if (!m_dirty)
+        {
+            m_dirty = true;
+            MaterialRegistry::getInstance().markDirty(m_instanceID);
+        }
+    }
+
+    // The texture is decoded and uploaded in the background, the material is uploaded again once it is resident
     void Material::setAlbedoTexture(const std::string& filename)
     {
         if (!filename.empty())
         {
             m_albedoTextureFilename = filename;
-            auto textureArray = getAlbedoTextureArray();
-            m_albedoTextureIndex = textureArray->addTexture2D(filename.c_str());
+            // Added before the previous one is released: the same file keeps its layer
+            auto texturePool = getAlbedoTexturePool();
+            auto previousTextureIndex = m_albedoTextureIndex;
+            m_albedoTextureIndex = texturePool->addTexture2D(filename.c_str());
+            if (previousTextureIndex >= 0)
+            {
+                texturePool->releaseTexture2D(previousTextureIndex);
+            }
+            markDirty();
         }
     }
 
-    void Material::loadUniforms()
+    int32_t Material::getAlbedoTextureLocation()
     {
-        getShader();
-
-        std::vector<glm::vec3> diffuseColors{};
-        std::vector<glm::vec3> specularColors{};
-        std::vector<float> shininessFactors{};
-
-        auto& materialInstances = MaterialRegistry::getInstance().getMaterialInstances();
-        if (!materialInstances.empty())
+        uint32_t arrayIndex, layer;
+        if (m_albedoTextureIndex < 0 || !getAlbedoTexturePool()->getTextureLocation(m_albedoTextureIndex, arrayIndex, layer))
         {
-            auto materialInstanceCount = materialInstances.size();
-            diffuseColors.reserve(materialInstanceCount);
-            specularColors.reserve(materialInstanceCount);
-            shininessFactors.reserve(materialInstanceCount);
-
-            std::stringstream ss;
-            for (int i = 0; i <  materialInstanceCount; ++i)
-            {
-                auto material = materialInstances[i].get();
+            return -1;
+        }
 
-                ss << "material_instances[" << i << "].diffuse";
-                m_shader->setUniform(ss.str(), material->getDiffuse()); ss.str(""); ss.clear();
+        return static_cast<int32_t>((arrayIndex << 16) | layer);
+    }
 
-                ss << "material_instances[" << i << "].specular";
-                m_shader->setUniform(ss.str(), material->getSpecular()); ss.str(""); ss.clear();
+    void Material::setDiffuse(const glm::vec3& diffuse)
+    {
+        if (diffuse != m_diffuse)
+        {
+            m_diffuse = diffuse;
+            markDirty();
+        }
+    }
 
-                ss << "material_instances[" << i << "].shininess";
-                m_shader->setUniform(ss.str(), material->getShininess()); ss.str(""); ss.clear();
+    void Material::setSpecular(const glm::vec3& specular)
+    {
+        if (specular != m_specular)
+        {
+            m_specular = specular;
+            markDirty();
+        }
+    }
 
-                ss << "material_instances[" << i << "].albedo_texture_idx";
-                m_shader->setUniform(ss.str(), material->getAlbedoTextureIndex()); ss.str(""); ss.clear();
-            }
+    void Material::setShininess(float shininess)
+    {
+        if (shininess != m_shininess)
+        {
+            m_shininess = shininess;
+            markDirty();
         }
+    }
+
+    void Material::loadUniforms()
+    {
+        getShader();
 
-        auto textureArray = getAlbedoTextureArray();
-        if (textureArray->getTextureCount())
+        // Array i of the pool on texture unit 1 + i
+        auto texturePool = getAlbedoTexturePool();
+        if (texturePool->getArrayCount())
         {
-            if (textureArray->needToLoadTextureArray())
+            static constexpr auto ALBEDO_TEXTURE_SLOTS = []()
             {
-                textureArray->load();
-            }
-            else
-            {
-                textureArray->bind(1);
-            }
-            
-            m_shader->setUniform("albedo_textures", 1);
+                std::array<int32_t, Texture2DArrayPool::MAX_ARRAY_COUNT> slots{};
+                for (uint32_t i = 0; i < slots.size(); ++i)
+                {
+                    slots[i] = 1 + i;
+                }
+                return slots;
+            }();
+
+            texturePool->bind(1);
+            m_shader->setUniform(ALBEDO_TEXTURES_UNIFORM, ALBEDO_TEXTURE_SLOTS.size(), ALBEDO_TEXTURE_SLOTS.data());
         }
 
         TextureRegistry::getInstance().getWhiteTexture2D()->bind();
-        m_shader->setUniform("white_1x1_texture", 0);
+        m_shader->setUniform(WHITE_TEXTURE_UNIFORM, 0);
+    }
+
+    void Material::markTexturesUsed()
+    {
+        if (m_albedoTextureIndex >= 0)
+        {
+            getAlbedoTexturePool()->markUsed(m_albedoTextureIndex);
+        }
     }
 
 } // namespace comet
@@ -0,0 +1,88 @@
+#include <comet/materialRegistry.h>
+#include <comet/texture.h>
+
+#include <glad/glad.h>
+
+#include <algorithm>
+
+namespace comet
+{
+    // Material instance as read by the shaders (std430)
+    struct MaterialData
+    {
+        glm::vec3 diffuse;
+        float shininess;
+        glm::vec3 specular;
+        int32_t albedoTextureLocation;
+    };
+    static_assert(sizeof(MaterialData) == 32, "MaterialData must match the std430 layout of MaterialInstance");
+
+    void MaterialRegistry::updateMaterialTable()
+    {
+        if (m_materialTable == nullptr)
+        {
+            m_materialTable = VertexBuffer::create(GL_DYNAMIC_DRAW);
+        }
+
+        auto requiredSize = std::max<size_t>(m_materials.size(), 1) * sizeof(MaterialData);
+        if (requiredSize > m_materialTable->getSize())
+        {
+            m_materialTable->grow(std::max(requiredSize, 2 * m_materialTable->getSize()));
+        }
+
+        // The materials are uploaded again when their albedo texture became resident (or was streamed again)
+        if (!m_materials.empty())
+        {
+            auto residencyVersion = m_materials.front()->getAlbedoTexturePool()->getResidencyVersion();
+            if (residencyVersion != m_albedoResidencyVersion)
+            {
+                m_albedoResidencyVersion = residencyVersion;
+                for (auto& material : m_materials)
+                {
+                    if (material->getAlbedoTextureIndex() >= 0)
+                    {
+                        material->markDirty();
+                    }
+                }
+            }
+        }
+
+        if (m_dirtyMaterials.empty())
+        {
+            return;
+        }
+
+        std::sort(m_dirtyMaterials.begin(), m_dirtyMaterials.end());
+        m_dirtyMaterials.erase(std::unique(m_dirtyMaterials.begin(), m_dirtyMaterials.end()), m_dirtyMaterials.end());
+
+        // Consecutive dirty materials are uploaded with a single call
+        std::vector<MaterialData> materialsData;
+        size_t rangeStart = 0;
+        for (size_t i = 0; i < m_dirtyMaterials.size(); ++i)
+        {
+            auto material = m_materials[m_dirtyMaterials[i]].get();
+            materialsData.push_back({material->getDiffuse(), material->getShininess(),
+                                     material->getSpecular(), material->getAlbedoTextureLocation()});
+            material->m_dirty = false;
+
+            bool rangeEnd = (i + 1 == m_dirtyMaterials.size()) || (m_dirtyMaterials[i + 1] != m_dirtyMaterials[i] + 1);
+            if (rangeEnd)
+            {
+                m_materialTable->loadData(materialsData.data(), materialsData.size() * sizeof(MaterialData),
+                                          m_dirtyMaterials[rangeStart] * sizeof(MaterialData));
+                materialsData.clear();
+                rangeStart = i + 1;
+            }
+        }
+        m_dirtyMaterials.clear();
+    }
+
+    void MaterialRegistry::bindMaterialTable() const
+    {
+        if (m_materialTable)
+        {
+            m_materialTable->bindStorage(MATERIALS_BINDING);
+        }
+    }
+
+} // namespace comet
@@ -1,46 +1,29 @@
 #include <comet/pointLight.h>
-#include <comet/shader.h>
-#include <sstream>
-#include <comet/log.h>
 
-// Must be the same value as in the glsl file
-#define MAX_POINT_LIGHTS 4
+#include <cmath>
+#include <limits>
 
 namespace comet
 {
-    uint16_t PointLight::s_pointLightsCount = 0;
+    // Attenuation under which the light contribution is ignored
+    static constexpr float MIN_ATTENUATION = 1.0f / 256.0f;
 
-    void PointLight::loadUniforms(Shader* shader)
+    float PointLight::getRange() const
     {
-        if (m_index == 0)
+        // Solve 1 / (1 + linear * d + quadratic * d^2) = MIN_ATTENUATION
+        auto c = 1.0f - 1.0f / MIN_ATTENUATION;
+        if (m_quadraticAttenuation > 0.0f)
         {
-            shader->setUniform("active_point_lights_count", (uint32_t)s_pointLightsCount);
+            return (-m_linearAttenuation + std::sqrt(m_linearAttenuation * m_linearAttenuation - 4.0f * m_quadraticAttenuation * c)) /
+                   (2.0f * m_quadraticAttenuation);
         }
 
-        if (m_index >= MAX_POINT_LIGHTS)
+        if (m_linearAttenuation > 0.0f)
         {
-            CM_CORE_LOG_WARN("Exceeded the max number of Point Lights allowed: {}", MAX_POINT_LIGHTS);
-            return;
+            return -c / m_linearAttenuation;
         }
 
-        std::stringstream ss;
-        ss << "point_lights[" << m_index << "].position";
-        shader->setUniform(ss.str(), m_position); ss.str(""); ss.clear();
-        
-        ss << "point_lights[" << m_index << "].ambient";
-        shader->setUniform(ss.str(), m_ambient); ss.str(""); ss.clear();
-
-        ss << "point_lights[" << m_index << "].diffuse";
-        shader->setUniform(ss.str(), m_diffuse); ss.str(""); ss.clear();
-
-        ss << "point_lights[" << m_index << "].specular";
-        shader->setUniform(ss.str(), m_specular); ss.str(""); ss.clear();
-
-        ss << "point_lights[" << m_index << "].linear_attenuation";
-        shader->setUniform(ss.str(), m_linearAttenuation); ss.str(""); ss.clear();
-
-        ss << "point_lights[" << m_index << "].quadratic_attenuation";
-        shader->setUniform(ss.str(), m_quadraticAttenuation); ss.str(""); ss.clear();
+        return std::numeric_limits<float>::max();
     }
 
 } // namespace comet
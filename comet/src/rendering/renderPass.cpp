@@ -45,6 +45,7 @@ namespace comet
             m_spec.target->bind();
             m_spec.target->clear();
 
+            m_renderer->setDepthPrePass(m_spec.depthPrePass);
             m_renderer->reloadData();
             m_renderer->render();
             
@@ -0,0 +1,79 @@
+#include <rendering/renderQueue.h>
+
+#include <cstring>
+#include <utility>
+
+namespace comet
+{
+
+    uint64_t RenderQueue::makeSortKey(bool frontToBack, Pass pass, uint16_t shaderId, uint16_t materialId, uint8_t vertexArrayId, float depth)
+    {
+        // The bit pattern of a positive float increases with its value: keep its 24 most significant bits
+        uint32_t depthBits{0};
+        if (depth > 0.0f)
+        {
+            memcpy(&depthBits, &depth, sizeof(float));
+            depthBits >>= 7;
+        }
+
+        uint64_t key = static_cast<uint64_t>(static_cast<uint8_t>(pass) & 0xF) << 60;
+        uint64_t state = (static_cast<uint64_t>(shaderId & 0xFFF) << 24) |
+                         (static_cast<uint64_t>(materialId) << 8) |
+                         static_cast<uint64_t>(vertexArrayId);
+
+        if (frontToBack)
+        {
+            return key | (static_cast<uint64_t>(depthBits) << 36) | state;
+        }
+
+        return key | (state << 24) | depthBits;
+    }
+
+    void RenderQueue::sort()
+    {
+        auto count = m_packets.size();
+        if (count < 2)
+        {
+            return;
+        }
+
+        m_sortBuffer.resize(count);
+        auto* pSource = m_packets.data();
+        auto* pDestination = m_sortBuffer.data();
+
+        for (uint32_t shift = 0; shift < 64; shift += 8)
+        {
+            size_t histogram[256]{};
+            for (size_t i = 0; i < count; ++i)
+            {
+                histogram[(pSource[i].sortKey >> shift) & 0xFF]++;
+            }
+
+            // All the keys have the same byte: nothing to reorder
+            if (histogram[(pSource[0].sortKey >> shift) & 0xFF] == count)
+            {
+                continue;
+            }
+
+            size_t offset{0};
+            for (auto& bucket : histogram)
+            {
+                auto bucketCount = bucket;
+                bucket = offset;
+                offset += bucketCount;
+            }
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                pDestination[histogram[(pSource[i].sortKey >> shift) & 0xFF]++] = pSource[i];
+            }
+            std::swap(pSource, pDestination);
+        }
+
+        if (pSource != m_packets.data())
+        {
+            memcpy(m_packets.data(), pSource, count * sizeof(DrawPacket));
+        }
+    }
+
+} // namespace comet
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace comet
+{
+    struct MultiDrawIndirectContext;
+
+    struct DrawPacket
+    {
+        uint64_t sortKey;
+        MultiDrawIndirectContext* drawContext;
+    };
+
+    // Draw packets of a frame, submitted in the order of their 64-bit sort key.
+    //
+    // Key layout (most significant bits first):
+    //     | pass (4) | shader (12) | material (16) | vertex array (8) | depth (24) |
+    // Front to back ordering moves the depth right after the pass, at the cost of more state changes.
+    class RenderQueue
+    {
+    public:
+        enum class Pass : uint8_t
+        {
+            OPAQUE = 0
+        };
+
+        static uint64_t makeSortKey(bool frontToBack, Pass pass, uint16_t shaderId, uint16_t materialId, uint8_t vertexArrayId, float depth);
+
+        void clear() { m_packets.clear(); }
+        void push(uint64_t sortKey, MultiDrawIndirectContext* drawContext) { m_packets.push_back({sortKey, drawContext}); }
+
+        // LSD radix sort (8 bits per pass), the passes on bytes shared by all the keys are skipped
+        void sort();
+
+        const std::vector<DrawPacket>& getPackets() const { return m_packets; }
+        size_t size() const { return m_packets.size(); }
+
+    private:
+        std::vector<DrawPacket> m_packets;
+        std::vector<DrawPacket> m_sortBuffer;
+    };
+
+} // namespace comet
@@ -2,31 +2,79 @@
 
 #include <comet/renderer.h>
 #include <comet/shader.h>
-#include <rendering/vertexArray.h>
+#include <rendering/vertexFormat.h>
 #include <rendering/indexBuffer.h>
 #include <rendering/vertexBuffer.h>
 #include <rendering/commandBuffer.h>
+#include <rendering/uniformBuffer.h>
+#include <rendering/frustum.h>
+#include <rendering/geometryPool.h>
+#include <platforms/opengl/openglStateCache.h>
+#include <platforms/opengl/openglTextureStreamer.h>
+#include <core/threadPool.h>
 #include <comet/light.h>
 #include <comet/utils.h>
 #include <comet/scene.h>
 #include <comet/components.h>
 #include <comet/materialRegistry.h>
+#include <comet/textureResidencyManager.h>
+#include <comet/shaderRegistry.h>
 #include <comet/resourceManager.h>
 #include <comet/logFormatters.h>
+#include <comet/graphicApiConfig.h>
+#include <comet/assert.h>
 
 #include <glm/mat4x4.hpp>
+#include <glm/gtc/quaternion.hpp>
 
-#include <unordered_set>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <mutex>
 
 namespace comet
 {
+    // Number of frame regions of the persistently mapped instance buffers.
+    // The CPU writes region N while the GPU may still read regions N-1 and N-2.
+    static constexpr uint32_t INSTANCE_BUFFER_FRAME_REGIONS = 3;
+
+    // Shaders computing gl_Position exactly like cometDepthOnly (same expression, invariant gl_Position).
+    // Only their draws are in the depth pre-pass, as they are tested with GL_EQUAL afterwards.
+    static constexpr const char* DEPTH_ONLY_VARIANT_SHADERS[] = {"cometPhong", "cometFlatColor", "cometTest"};
+
+    // Smallest block of instance slots reserved for a mesh when it gets new instances
+    static constexpr uint32_t MIN_INSTANCE_BLOCK_CAPACITY = 4;
+    // Under this number of slots, the holes left by relocated instance blocks are not worth reclaiming
+    static constexpr size_t INSTANCE_COMPACTION_MIN_SLOTS = 1024;
+    // Frame regions are bound as shader storage ranges: keep their offset aligned
+    // (256 bytes is the largest GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT in the wild)
+    static constexpr size_t INSTANCE_REGION_ALIGNMENT = 256;
+    // Must match WORKGROUP_SIZE of cometFrustumCulling.cs.glsl
+    static constexpr uint32_t CULLING_WORKGROUP_SIZE = 64;
+    // Smallest number of instances culled by a worker thread
+    static constexpr size_t CPU_CULLING_MIN_CHUNK_SIZE = 4096;
+    static constexpr uint32_t NO_MESH = std::numeric_limits<uint32_t>::max();
+    // Smallest number of entities processed by a worker thread when gathering the instances data
+    static constexpr size_t GATHER_MIN_CHUNK_SIZE = 2048;
+
+    // Uniforms of cometFrustumCulling.cs.glsl
+    static constexpr UniformId FRUSTUM_PLANES_UNIFORM{"frustum_planes"};
+    static constexpr UniformId CULLING_ENABLED_UNIFORM{"culling_enabled"};
+    static constexpr UniformId COMMAND_COUNT_UNIFORM{"command_count"};
+    static constexpr UniformId SLOT_COUNT_UNIFORM{"slot_count"};
+    static constexpr UniformId COMMAND_STRIDE_UNIFORM{"command_stride"};
+    static constexpr UniformId RESET_COMMANDS_UNIFORM{"reset_commands"};
+
+    // The meshes with 16 and 32 bits indices read different index buffers: they are drawn in separate batches
     struct MultiDrawKey
     {
         bool hasIndices;
+        IndexType indexType;
     
         bool operator==(const MultiDrawKey& other) const
         {
-            return hasIndices == other.hasIndices;
+            return hasIndices == other.hasIndices && indexType == other.indexType;
         }
     };
 
@@ -34,48 +82,194 @@ namespace comet
     {
         std::size_t operator()(const MultiDrawKey& key) const
         {
-            return std::hash<bool>()(key.hasIndices);
+            return (static_cast<std::size_t>(key.indexType) << 1) | (key.hasIndices ? 1 : 0);
         }
     };
 
+    // Model transform as translation * rotation * scale (44 bytes instead of 68 with a mat4),
+    // the vertex shaders build the matrix
     struct MeshInstanceData
     {
         MeshInstanceData() = default;
-        MeshInstanceData(const glm::mat4& transform, uint32_t materialInstanceId)
-            : modelTransform(transform), materialInstanceId(materialInstanceId) {}
+        MeshInstanceData(const TransformComponent& transform, uint32_t materialInstanceId)
+            : materialInstanceId(materialInstanceId)
+        {
+            setTransform(transform);
+        }
 
-        glm::mat4 modelTransform{1.0f};
+        void setTransform(const TransformComponent& transform)
+        {
+            auto q = transform.getRotation();
+            rotation = glm::vec4(q.x, q.y, q.z, q.w);
+            translation = transform.translation;
+            scale = transform.scale;
+        }
+
+        glm::quat getRotation() const { return glm::quat(rotation.w, rotation.x, rotation.y, rotation.z); }
+        glm::vec3 transformPoint(const glm::vec3& point) const { return translation + getRotation() * (scale * point); }
+        float getMaxScale() const { return std::max({std::abs(scale.x), std::abs(scale.y), std::abs(scale.z)}); }
+
+        glm::vec4 rotation{0.0f, 0.0f, 0.0f, 1.0f}; // quaternion (x, y, z, w)
+        glm::vec3 translation{0.0f};
         uint32_t materialInstanceId{0};
+        glm::vec3 scale{1.0f};
+    };
+    static_assert(sizeof(MeshInstanceData) == 11 * sizeof(float), "Must match INSTANCE_STRIDE of cometFrustumCulling.cs.glsl");
+
+    // Region sizes are also a whole number of instances: the draw commands address the regions with their base instance
+    static constexpr size_t INSTANCE_REGION_SIZE_ALIGNMENT = std::lcm(INSTANCE_REGION_ALIGNMENT, sizeof(MeshInstanceData));
+
+    // Per draw command data read by the culling compute shader (std430 layout)
+    struct MeshCullingData
+    {
+        glm::vec4 boundingSphere;
+        // Dequantization of the positions, applied to the model transform of the drawn instances
+        glm::vec3 positionOffset;
+        uint32_t baseInstance;
+        glm::vec3 positionScale;
+        uint32_t padding;
+    };
+
+    // Contiguous range of instance slots
+    struct InstanceRange
+    {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    // Per-frame data shared by all the shaders (std140 uniform block 'FrameData')
+    static constexpr uint32_t FRAME_DATA_BINDING = 0;
+
+    struct FrameData
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::mat4 viewProjection;
+        glm::mat4 inverseView;
+        glm::vec4 cameraPosition;
+        glm::vec2 viewportSize;
+        float time;
+        float padding;
     };
+    static_assert(sizeof(FrameData) == 288, "FrameData must match the std140 layout of the FrameData uniform block");
 
     struct MeshAndInstances
     {
+        MeshAndInstances(uint32_t _staticMeshId, StaticMesh* _staticMesh)
+            : staticMeshId(_staticMeshId), staticMesh(_staticMesh) {}
+
+        uint32_t staticMeshId;
         StaticMesh* staticMesh;
-        std::vector<MeshInstanceData> instancesData;
+        // Location of the mesh geometry in the GeometryPool buffers
+        uint32_t firstVertex{0};
+        uint32_t firstIndex{0};
+        // Dequantization of the GeometryPool positions (translation and per axis scale)
+        glm::vec3 positionOffset{0.0f};
+        glm::vec3 positionScale{1.0f};
+        // Instances of the mesh use the slots [baseInstance, baseInstance + entities.size()[
+        // of a block of instanceCapacity slots
+        uint32_t baseInstance{0};
+        uint32_t instanceCapacity{0};
+        std::vector<entt::entity> entities;
+        // Only used to gather the instances before their slot is assigned
+        std::vector<uint32_t> materialInstanceIds;
     };
 
     struct MultiDrawIndirectContext
     {
-        MultiDrawIndirectContext(Material* _material) : material(_material) {}
+        MultiDrawIndirectContext(Material* _material, const MultiDrawKey& key)
+            : material(_material), hasIndices(key.hasIndices), indexType(key.indexType) {}
 
         Material* material{nullptr};
-        std::unique_ptr<VertexArray> vao;
-        std::unique_ptr<IndexBuffer> ibo;
-        std::unique_ptr<VertexBuffer> vbo;
+        bool hasIndices{false};
+        IndexType indexType{IndexType::UINT32};
+        // The shader positions match cometDepthOnly: the draw context takes part in the depth pre-pass
+        bool hasDepthOnlyVariant{false};
+        // World space bounds of the instances, used to sort the draw contexts by depth
+        glm::vec3 boundsMin{0.0f};
+        glm::vec3 boundsMax{0.0f};
+        bool boundsDirty{true};
+        // Shared by the draw contexts with the same layouts, the buffers are attached when drawing.
+        // Instance attributes are read from culledInstanceBuffer or from the current region
+        // of instanceBuffer when the instances are culled on the CPU
+        VertexFormat* vertexFormat{nullptr};
+        // Instances written by the CPU (ring buffer), then compacted by the culling pass in
+        // culledInstanceBuffer, which is the one read by the draw calls
         std::unique_ptr<VertexBuffer> instanceBuffer;
+        std::unique_ptr<VertexBuffer> culledInstanceBuffer;
+        std::unique_ptr<VertexBuffer> meshCullingBuffer;
+        // Command index of each instance slot (NO_MESH for the holes): the culling pass runs one invocation per slot
+        std::unique_ptr<VertexBuffer> slotCommandBuffer;
+        // instanceCount / baseInstance of the commands are written by the culling pass
         std::unique_ptr<CommandBuffer> commandBuffer;
+        uint32_t commandCount{0};
+        uint32_t cullingSlotCount{0};
+        bool commandsDirty{true};
+
+        // One draw command per mesh, in this order. Meshes are only appended (until the next prepare)
+        std::vector<MeshAndInstances> meshes;
+        std::unordered_map<uint32_t, uint32_t> meshIndices;
 
-        std::unordered_map<uint32_t, MeshAndInstances> staticMeshes;
+        // CPU copy of the instance data, indexed by instance slot.
+        // It contains the holes left by the relocated instance blocks.
+        std::vector<MeshInstanceData> instancesData;
+        uint32_t instanceCount{0};
+        // Instances per material instance id: the textures of all these materials are sampled by the draws
+        std::unordered_map<uint32_t, uint32_t> materialInstanceCounts;
+        // Slots modified since the last frame
+        std::vector<uint32_t> dirtySlots;
+        // Ranges not yet written in each region of the instance buffer
+        std::vector<InstanceRange> pendingRanges[INSTANCE_BUFFER_FRAME_REGIONS];
+
+        // CPU culling: world space bounding spheres (SoA) and visibility, indexed by instance slot
+        std::vector<uint32_t> slotMeshes;
+        std::vector<float> boundsX;
+        std::vector<float> boundsY;
+        std::vector<float> boundsZ;
+        std::vector<float> boundsRadius;
+        std::vector<uint8_t> visibility;
     };
 
+    static void addMaterialInstance(MultiDrawIndirectContext* drawContext, uint32_t materialInstanceId)
+    {
+        drawContext->materialInstanceCounts[materialInstanceId]++;
+    }
+
+    static void removeMaterialInstance(MultiDrawIndirectContext* drawContext, uint32_t materialInstanceId)
+    {
+        auto it = drawContext->materialInstanceCounts.find(materialInstanceId);
+        if (it != drawContext->materialInstanceCounts.end() && --it->second == 0)
+        {
+            drawContext->materialInstanceCounts.erase(it);
+        }
+    }
+
     struct ShaderDrawContext
     {
         ShaderDrawContext() {}
 
         Shader* shader{nullptr};
+        uint16_t sortId{0};
         std::unordered_map<MultiDrawKey, MultiDrawIndirectContext*, hash_fn> multiDrawIndirectContexts;
     };
 
+    void Renderer::beginFrame()
+    {
+        // Texture memory brought back under budget (the evicted textures used by the last frame are requested again),
+        // then the texture rows streamed this frame, before the material tables are updated so the layers that became
+        // resident are sampled
+        TextureResidencyManager::getInstance().update();
+
+        switch (GraphicApiConfig::getApiImpl())
+        {
+            case GraphicApiConfig::API::OPENGL:
+                OpenglTextureStreamer::getInstance().update();
+                return;
+        }
+
+        ASSERT(false, "Graphic API not supported for now!");
+    }
+
     SceneRenderer::SceneRenderer(Scene* scene)
         : m_scene(scene)
     {
@@ -83,10 +277,53 @@ namespace comet
         m_defaultMaterial->setDiffuse({0.7f, 0.7f, 0.7f});
         m_defaultMaterial->setSpecular({0.8f, 0.8f, 0.8f});
         m_defaultMaterial->setShininess(1.1f);
+
+        m_cullingShader = ShaderRegistry::getInstance().getShader("cometFrustumCulling");
+        m_depthOnlyShader = ShaderRegistry::getInstance().getShader("cometDepthOnly");
+        m_lightGrid = std::make_unique<LightGrid>();
+        m_frameDataBuffer = UniformBuffer::create(GL_DYNAMIC_DRAW);
+        m_frameDataBuffer->allocate(sizeof(FrameData));
+
+        // Compute shaders are way slower than the SIMD CPU path on software rasterizers
+        auto glRenderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+        if (glRenderer && strstr(glRenderer, "llvmpipe"))
+        {
+            CM_CORE_LOG_INFO("Software renderer detected ({}): instances are culled on the CPU", glRenderer);
+            m_cullingMode = CullingMode::CPU;
+        }
+
+        if (m_scene)
+        {
+            auto& registry = m_scene->m_registry;
+            m_transformObserver.connect(registry, entt::collector.update<TransformComponent>());
+
+            // Topology changes are applied to the affected draw contexts only, on the next reloadData()
+            registry.on_construct<TransformComponent>().connect<&SceneRenderer::onRenderableConstructed>(*this);
+            registry.on_construct<MeshComponent>().connect<&SceneRenderer::onRenderableConstructed>(*this);
+            registry.on_update<MeshComponent>().connect<&SceneRenderer::onRenderableUpdated>(*this);
+            registry.on_destroy<TransformComponent>().connect<&SceneRenderer::onRenderableDestroyed>(*this);
+            registry.on_destroy<MeshComponent>().connect<&SceneRenderer::onRenderableDestroyed>(*this);
+            registry.on_construct<MaterialComponent>().connect<&SceneRenderer::onMaterialChanged>(*this);
+            registry.on_update<MaterialComponent>().connect<&SceneRenderer::onMaterialChanged>(*this);
+            registry.on_destroy<MaterialComponent>().connect<&SceneRenderer::onMaterialChanged>(*this);
+        }
     }
 
     SceneRenderer::~SceneRenderer()
     {
+        if (m_scene)
+        {
+            auto& registry = m_scene->m_registry;
+            registry.on_construct<TransformComponent>().disconnect(this);
+            registry.on_construct<MeshComponent>().disconnect(this);
+            registry.on_update<MeshComponent>().disconnect(this);
+            registry.on_destroy<TransformComponent>().disconnect(this);
+            registry.on_destroy<MeshComponent>().disconnect(this);
+            registry.on_construct<MaterialComponent>().disconnect(this);
+            registry.on_update<MaterialComponent>().disconnect(this);
+            registry.on_destroy<MaterialComponent>().disconnect(this);
+        }
+
         cleanUp();
     }
 
@@ -123,13 +360,142 @@ namespace comet
             delete pShaderDrawContext;
         }
         m_shaderDrawContexts.clear();
+        m_instanceSlots.clear();
+        m_renderQueue.clear();
+        m_shaderSortIdCounter = 0;
+    }
+
+    SceneRenderer::InstanceSlot* SceneRenderer::findInstanceSlot(entt::entity entity)
+    {
+        auto index = static_cast<size_t>(entt::to_integral(entity) & entt::entt_traits<entt::entity>::entity_mask);
+        if (index < m_instanceSlots.size() && m_instanceSlots[index].entity == entity)
+        {
+            return &m_instanceSlots[index];
+        }
+
+        return nullptr;
+    }
+
+    void SceneRenderer::setInstanceSlot(entt::entity entity, MultiDrawIndirectContext* drawContext, uint32_t meshIndex, uint32_t slot)
+    {
+        auto index = static_cast<size_t>(entt::to_integral(entity) & entt::entt_traits<entt::entity>::entity_mask);
+        if (index >= m_instanceSlots.size())
+        {
+            m_instanceSlots.resize(std::max(index + 1, m_instanceSlots.size() * 2));
+        }
+
+        m_instanceSlots[index] = {entity, drawContext, meshIndex, slot};
+    }
+
+    void SceneRenderer::addEntity(entt::entity entity)
+    {
+        m_addedEntities.push_back(entity);
+    }
+
+    void SceneRenderer::removeEntity(entt::entity entity)
+    {
+        m_removedEntities.push_back(entity);
+    }
+
+    void SceneRenderer::updateEntityMaterial(entt::entity entity)
+    {
+        m_materialChangedEntities.push_back(entity);
     }
 
     void SceneRenderer::prepare()
     {
         initFromScene();
-        allocateBuffersAndSetupLayouts();
-        loadDataToBuffers();
+        assignInstanceSlots();
+
+        for (auto [shaderType, pShaderDrawContext] : m_shaderDrawContexts)
+        {
+            for (auto [key, pMaterialDrawContext] : pShaderDrawContext->multiDrawIndirectContexts)
+            {
+                updateDrawContextBuffers(pMaterialDrawContext);
+            }
+        }
+        updateStatistics();
+
+        // All instances have just been gathered from the scene
+        m_transformObserver.clear();
+        m_addedEntities.clear();
+        m_removedEntities.clear();
+        m_materialChangedEntities.clear();
+    }
+
+    Material* SceneRenderer::getEntityMaterial(entt::entity entity, uint32_t& materialInstanceId)
+    {
+        auto& registry = m_scene->m_registry;
+        Material* material{nullptr};
+
+        if (auto materialComponent = registry.try_get<MaterialComponent>(entity))
+        {
+            materialInstanceId = materialComponent->materialInstanceId;
+            material = MaterialRegistry::getInstance().getMaterialInstance(materialInstanceId);
+        }
+
+        if (material == nullptr)
+        {
+            material = m_defaultMaterial;
+            materialInstanceId = material->getInstanceId();
+        }
+
+        return material;
+    }
+
+    MultiDrawIndirectContext* SceneRenderer::getDrawContext(Material* material, const StaticMesh& staticMesh)
+    {
+        // Check if a new Shader Draw context is needed
+        auto shader = material->getShader();
+        auto shaderTypeHash = shader->getTypeHash();
+        auto& pShaderDrawContext = m_shaderDrawContexts[shaderTypeHash];
+        if (pShaderDrawContext == nullptr)
+        {
+            pShaderDrawContext = new ShaderDrawContext();
+            pShaderDrawContext->shader = shader;
+            pShaderDrawContext->sortId = m_shaderSortIdCounter++;
+        }
+
+        // Check if a new Material Indirect Draw context is needed
+        auto hasIndices = staticMesh.hasIndices();
+        auto key = MultiDrawKey{hasIndices, hasIndices ? staticMesh.getIndexType() : IndexType::UINT32};
+        auto& pMaterialDrawContext = pShaderDrawContext->multiDrawIndirectContexts[key];
+        if (pMaterialDrawContext == nullptr)
+        {
+            pMaterialDrawContext = new MultiDrawIndirectContext(material, key);
+            pMaterialDrawContext->hasDepthOnlyVariant = std::any_of(std::begin(DEPTH_ONLY_VARIANT_SHADERS), std::end(DEPTH_ONLY_VARIANT_SHADERS),
+                [shader](const char* shaderName) { return shader->getName() == shaderName; });
+            pMaterialDrawContext->instanceBuffer = VertexBuffer::create(GL_DYNAMIC_DRAW);
+            pMaterialDrawContext->culledInstanceBuffer = VertexBuffer::create(GL_DYNAMIC_COPY);
+            pMaterialDrawContext->meshCullingBuffer = VertexBuffer::create(GL_DYNAMIC_DRAW);
+            pMaterialDrawContext->slotCommandBuffer = VertexBuffer::create(GL_DYNAMIC_DRAW);
+            pMaterialDrawContext->commandBuffer = CommandBuffer::create(GL_DYNAMIC_DRAW);
+        }
+
+        return pMaterialDrawContext;
+    }
+
+    uint32_t SceneRenderer::getDrawContextMesh(MultiDrawIndirectContext* drawContext, uint32_t staticMeshId, StaticMesh* staticMesh)
+    {
+        auto meshIt = drawContext->meshIndices.find(staticMeshId);
+        if (meshIt != drawContext->meshIndices.end())
+        {
+            return meshIt->second;
+        }
+
+        // New mesh: its geometry is already in the pool (uploaded when the mesh was loaded), it gets its own draw command
+        auto& geometry = GeometryPool::getInstance().upload(staticMeshId, *staticMesh);
+        auto meshIndex = static_cast<uint32_t>(drawContext->meshes.size());
+        auto& meshAndInstances = drawContext->meshes.emplace_back(staticMeshId, staticMesh);
+        meshAndInstances.firstVertex = geometry.firstVertex;
+        meshAndInstances.firstIndex = geometry.firstIndex;
+        meshAndInstances.positionOffset = geometry.positionOffset;
+        meshAndInstances.positionScale = geometry.positionScale;
+        meshAndInstances.baseInstance = static_cast<uint32_t>(drawContext->instancesData.size());
+        drawContext->meshIndices[staticMeshId] = meshIndex;
+        drawContext->commandsDirty = true;
+
+        return meshIndex;
     }
 
     void SceneRenderer::initFromScene()
@@ -139,125 +505,418 @@ namespace comet
         {
             auto& registry = m_scene->m_registry;
 
+            // Most entities share a few (mesh, material) pairs: resolve each pair to its draw context mesh only once
+            struct ResolvedMesh
+            {
+                MultiDrawIndirectContext* drawContext;
+                uint32_t meshIndex;
+                uint32_t materialInstanceId;
+            };
+            std::unordered_map<uint64_t, ResolvedMesh> resolvedMeshes;
+
             // TODO(jcp): From the doc: consider creating the group when no components have been assigned yet.
             // If the registry is empty, preparation is extremely fast.
-            registry.group<TransformComponent, MeshComponent>().each([&](auto entity, auto& transform, auto& mesh)
+            // The transforms are computed later in parallel (see assignInstanceSlots)
+            registry.group<TransformComponent, MeshComponent>().each([&](auto entity, auto& /*transform*/, auto& mesh)
             {
-                uint32_t materialInstanceId;
-                Material* material = nullptr;
+                auto materialComponent = registry.try_get<MaterialComponent>(entity);
+                uint64_t materialKey = materialComponent ? materialComponent->materialInstanceId + 1 : 0;
+                uint64_t resolveKey = (static_cast<uint64_t>(mesh.meshTypeId) << 32) | materialKey;
 
-                bool hasMaterial = registry.has<MaterialComponent>(entity);
-                if (hasMaterial)
+                auto resolvedIt = resolvedMeshes.find(resolveKey);
+                if (resolvedIt == resolvedMeshes.end())
                 {
-                    auto materialComponent = registry.get<MaterialComponent>(entity);
-                    materialInstanceId = materialComponent.materialInstanceId;
-                    material = MaterialRegistry::getInstance().getMaterialInstance(materialInstanceId);
+                    uint32_t materialInstanceId;
+                    Material* material = getEntityMaterial(entity, materialInstanceId);
+
+                    auto staticMeshHandler = ResourceManager::getInstance().getStaticMesh(mesh.meshTypeId);
+                    auto staticMesh = staticMeshHandler.resource;
+                    auto drawContext = getDrawContext(material, *staticMesh);
+                    auto meshIndex = getDrawContextMesh(drawContext, staticMeshHandler.resourceId, staticMesh);
+                    resolvedIt = resolvedMeshes.emplace(resolveKey, ResolvedMesh{drawContext, meshIndex, materialInstanceId}).first;
                 }
 
-                if (material == nullptr)
-                {
-                    material = m_defaultMaterial;
-                    materialInstanceId = material->getInstanceId();
-                }
+                auto& resolved = resolvedIt->second;
+                auto& meshAndInstances = resolved.drawContext->meshes[resolved.meshIndex];
+                meshAndInstances.entities.push_back(entity);
+                meshAndInstances.materialInstanceIds.push_back(resolved.materialInstanceId);
+            });
+        }
+    }
 
-                // Check if a new Shader Draw context is needed
-                auto shader = material->getShader();
-                auto shaderTypeHash = shader->getTypeHash();
-                if (m_shaderDrawContexts.find(shaderTypeHash) == m_shaderDrawContexts.end())
-                {
-                    m_shaderDrawContexts[shaderTypeHash] = new ShaderDrawContext();
-                    m_shaderDrawContexts[shaderTypeHash]->shader = shader;
-                }
+    void SceneRenderer::assignInstanceSlots()
+    {
+        auto& registry = m_scene->m_registry;
 
-                // Check if a new Material Indirect Draw context is needed
-                auto staticMeshHandler = ResourceManager::getInstance().getStaticMesh(mesh.meshTypeId);
-                auto staticMesh = staticMeshHandler.resource;
-                auto hasIndices = staticMesh->hasIndices();
-                auto key = MultiDrawKey{hasIndices};
-                auto& drawContextMap = m_shaderDrawContexts[shaderTypeHash]->multiDrawIndirectContexts;
-                if (drawContextMap.find(key) == drawContextMap.end())
+        for (auto [shaderType, pShaderDrawContext] : m_shaderDrawContexts)
+        {
+            for (auto [key, pMaterialDrawContext] : pShaderDrawContext->multiDrawIndirectContexts)
+            {
+                size_t slotCount{0};
+                for (auto& meshAndInstances : pMaterialDrawContext->meshes)
                 {
-                    auto context = new MultiDrawIndirectContext(material);
-                    context->ibo = IndexBuffer::create(GL_STATIC_DRAW);
-                    context->vbo = VertexBuffer::create(GL_STATIC_DRAW);
-                    context->instanceBuffer = VertexBuffer::create(GL_DYNAMIC_DRAW);
-                    context->commandBuffer = CommandBuffer::create(GL_DYNAMIC_DRAW);
-                    context->vao = VertexArray::create();
-
-                    drawContextMap[key] = context;
+                    slotCount += meshAndInstances.entities.size();
                 }
 
-                auto currentDrawContext = drawContextMap[key];
-                // Check if we are dealing with a new StaticMesh (to update buffers' size)
-                if (currentDrawContext->staticMeshes.find(staticMeshHandler.resourceId) == currentDrawContext->staticMeshes.end())
+                auto& instancesData = pMaterialDrawContext->instancesData;
+                instancesData.clear();
+                instancesData.resize(slotCount);
+                pMaterialDrawContext->materialInstanceCounts.clear();
+                std::vector<entt::entity> slotEntities(slotCount);
+
+                // Instances of a same mesh are contiguous so that they can be drawn with a single command
+                uint32_t slot{0};
+                for (uint32_t meshIndex = 0; meshIndex < pMaterialDrawContext->meshes.size(); ++meshIndex)
                 {
-                    if (hasIndices)
+                    auto& meshAndInstances = pMaterialDrawContext->meshes[meshIndex];
+                    meshAndInstances.baseInstance = slot;
+                    meshAndInstances.instanceCapacity = static_cast<uint32_t>(meshAndInstances.entities.size());
+                    for (size_t i = 0; i < meshAndInstances.entities.size(); ++i, ++slot)
                     {
-                        currentDrawContext->ibo->increaseSize(staticMesh->getIndicesSize());
-                        currentDrawContext->commandBuffer->increaseSize(sizeof(DrawElementsIndirectCommand));
+                        setInstanceSlot(meshAndInstances.entities[i], pMaterialDrawContext, meshIndex, slot);
+                        slotEntities[slot] = meshAndInstances.entities[i];
+                        instancesData[slot].materialInstanceId = meshAndInstances.materialInstanceIds[i];
+                        addMaterialInstance(pMaterialDrawContext, meshAndInstances.materialInstanceIds[i]);
                     }
-                    else
+                    meshAndInstances.materialInstanceIds.clear();
+                    meshAndInstances.materialInstanceIds.shrink_to_fit();
+                }
+                pMaterialDrawContext->instanceCount = static_cast<uint32_t>(slotCount);
+
+                // Transforms are written straight in their slot, from the worker threads
+                ThreadPool::getInstance().parallelFor(slotCount, GATHER_MIN_CHUNK_SIZE, [&](size_t begin, size_t end)
+                {
+                    for (auto i = begin; i < end; ++i)
                     {
-                        currentDrawContext->commandBuffer->increaseSize(sizeof(DrawArraysIndirectCommand));
+                        instancesData[i].setTransform(registry.get<TransformComponent>(slotEntities[i]));
                     }
+                });
 
-                    currentDrawContext->vbo->increaseSize(staticMesh->getVerticesSize());
+                // Every region of the instance buffer has to be fully written once
+                pMaterialDrawContext->dirtySlots.clear();
+                for (auto& ranges : pMaterialDrawContext->pendingRanges)
+                {
+                    ranges.clear();
+                    ranges.push_back({0, static_cast<uint32_t>(instancesData.size())});
                 }
+                pMaterialDrawContext->commandsDirty = true;
+            }
+        }
+    }
 
-                currentDrawContext->instanceBuffer->increaseSize(sizeof(MeshInstanceData));
-                auto& meshAndInstances = currentDrawContext->staticMeshes[staticMeshHandler.resourceId];
-                meshAndInstances.staticMesh = staticMesh;
-                meshAndInstances.instancesData.emplace_back(transform.getTransform(), materialInstanceId);
-            });
+    void SceneRenderer::addInstance(entt::entity entity)
+    {
+        auto& registry = m_scene->m_registry;
+        if (!registry.valid(entity) || !registry.has<TransformComponent, MeshComponent>(entity) ||
+            findInstanceSlot(entity) != nullptr)
+        {
+            return;
+        }
+
+        uint32_t materialInstanceId;
+        Material* material = getEntityMaterial(entity, materialInstanceId);
+
+        auto staticMeshHandler = ResourceManager::getInstance().getStaticMesh(registry.get<MeshComponent>(entity).meshTypeId);
+        auto staticMesh = staticMeshHandler.resource;
+        auto drawContext = getDrawContext(material, *staticMesh);
+        auto meshIndex = getDrawContextMesh(drawContext, staticMeshHandler.resourceId, staticMesh);
+
+        auto& meshAndInstances = drawContext->meshes[meshIndex];
+        if (meshAndInstances.entities.size() == meshAndInstances.instanceCapacity)
+        {
+            growInstanceBlock(drawContext, meshAndInstances);
         }
+
+        auto slot = meshAndInstances.baseInstance + static_cast<uint32_t>(meshAndInstances.entities.size());
+        meshAndInstances.entities.push_back(entity);
+        drawContext->instancesData[slot] = {registry.get<TransformComponent>(entity), materialInstanceId};
+        drawContext->dirtySlots.push_back(slot);
+        drawContext->instanceCount++;
+        addMaterialInstance(drawContext, materialInstanceId);
+        drawContext->commandsDirty = true;
+
+        setInstanceSlot(entity, drawContext, meshIndex, slot);
     }
 
-    void SceneRenderer::allocateBuffersAndSetupLayouts()
+    void SceneRenderer::removeInstance(entt::entity entity)
     {
-        for (auto [shaderType, pShaderDrawContext] : m_shaderDrawContexts)
+        auto instanceSlot = findInstanceSlot(entity);
+        if (instanceSlot == nullptr)
         {
-            for (auto [key, pMaterialDrawContext] : pShaderDrawContext->multiDrawIndirectContexts)
+            return;
+        }
+
+        auto drawContext = instanceSlot->drawContext;
+        auto meshIndex = instanceSlot->meshIndex;
+        auto slot = instanceSlot->slot;
+        *instanceSlot = InstanceSlot{};
+        removeMaterialInstance(drawContext, drawContext->instancesData[slot].materialInstanceId);
+
+        // Keep the instances of the mesh contiguous: the last one takes the freed slot
+        auto& meshAndInstances = drawContext->meshes[meshIndex];
+        auto lastSlot = meshAndInstances.baseInstance + static_cast<uint32_t>(meshAndInstances.entities.size()) - 1;
+        if (slot != lastSlot)
+        {
+            auto lastEntity = meshAndInstances.entities.back();
+            meshAndInstances.entities[slot - meshAndInstances.baseInstance] = lastEntity;
+            drawContext->instancesData[slot] = drawContext->instancesData[lastSlot];
+            drawContext->dirtySlots.push_back(slot);
+            findInstanceSlot(lastEntity)->slot = slot;
+        }
+        meshAndInstances.entities.pop_back();
+        drawContext->instanceCount--;
+        drawContext->commandsDirty = true;
+    }
+
+    void SceneRenderer::growInstanceBlock(MultiDrawIndirectContext* drawContext, MeshAndInstances& meshAndInstances)
+    {
+        auto& instancesData = drawContext->instancesData;
+        auto instanceCount = static_cast<uint32_t>(meshAndInstances.entities.size());
+        auto newCapacity = std::max(MIN_INSTANCE_BLOCK_CAPACITY, meshAndInstances.instanceCapacity * 2);
+
+        // The last block of the context can grow in place
+        if (meshAndInstances.baseInstance + meshAndInstances.instanceCapacity == instancesData.size())
+        {
+            instancesData.resize(meshAndInstances.baseInstance + newCapacity);
+            meshAndInstances.instanceCapacity = newCapacity;
+            return;
+        }
+
+        // Otherwise the block is moved at the end, leaving a hole (reclaimed by compactInstances())
+        auto newBaseInstance = static_cast<uint32_t>(instancesData.size());
+        instancesData.resize(newBaseInstance + newCapacity);
+        std::copy_n(instancesData.begin() + meshAndInstances.baseInstance, instanceCount, instancesData.begin() + newBaseInstance);
+
+        for (uint32_t i = 0; i < instanceCount; ++i)
+        {
+            findInstanceSlot(meshAndInstances.entities[i])->slot = newBaseInstance + i;
+            drawContext->dirtySlots.push_back(newBaseInstance + i);
+        }
+
+        meshAndInstances.baseInstance = newBaseInstance;
+        meshAndInstances.instanceCapacity = newCapacity;
+        drawContext->commandsDirty = true;
+    }
+
+    void SceneRenderer::compactInstances(MultiDrawIndirectContext* drawContext)
+    {
+        std::vector<MeshInstanceData> instancesData;
+        instancesData.reserve(drawContext->instanceCount);
+
+        for (auto& meshAndInstances : drawContext->meshes)
+        {
+            auto newBaseInstance = static_cast<uint32_t>(instancesData.size());
+            auto instanceCount = static_cast<uint32_t>(meshAndInstances.entities.size());
+            auto first = drawContext->instancesData.begin() + meshAndInstances.baseInstance;
+            instancesData.insert(instancesData.end(), first, first + instanceCount);
+
+            for (uint32_t i = 0; i < instanceCount; ++i)
             {
-                // Buffers Allocation
-                pMaterialDrawContext->vbo->allocate();
-                pMaterialDrawContext->instanceBuffer->allocate();
-                pMaterialDrawContext->commandBuffer->allocate();
+                findInstanceSlot(meshAndInstances.entities[i])->slot = newBaseInstance + i;
+            }
 
-                // Buffers Layouts definition
-                auto vboLayoutPtr = VertexBufferLayout::create();
-                auto& vboLayout = *vboLayoutPtr.get();
+            meshAndInstances.baseInstance = newBaseInstance;
+            meshAndInstances.instanceCapacity = instanceCount;
+        }
 
-                // Update VBO Attributes Layout
-                vboLayout.addFloat(3, false, 0); // position
-                vboLayout.addFloat(3, false, 1); // normal
-                vboLayout.addFloat(2, false, 2); // texture coordinate
+        drawContext->instancesData = std::move(instancesData);
+        drawContext->dirtySlots.clear();
+        for (auto& ranges : drawContext->pendingRanges)
+        {
+            ranges.clear();
+            ranges.push_back({0, static_cast<uint32_t>(drawContext->instancesData.size())});
+        }
+        drawContext->commandsDirty = true;
+    }
 
-                if (pMaterialDrawContext->ibo->getSize())
-                {
-                    pMaterialDrawContext->ibo->allocate();
-                    pMaterialDrawContext->vao->addLayout(vboLayout, *pMaterialDrawContext->vbo.get(), pMaterialDrawContext->ibo.get());
-                }
-                else
+    void SceneRenderer::applyTopologyChanges()
+    {
+        if (m_addedEntities.empty() && m_removedEntities.empty() && m_materialChangedEntities.empty())
+        {
+            return;
+        }
+
+        // Removals first, so that an entity removed then added back ends up in the right context
+        for (auto entity : m_removedEntities)
+        {
+            removeInstance(entity);
+        }
+
+        for (auto entity : m_materialChangedEntities)
+        {
+            auto instanceSlot = findInstanceSlot(entity);
+            if (instanceSlot == nullptr)
+            {
+                continue;
+            }
+
+            auto drawContext = instanceSlot->drawContext;
+            auto slot = instanceSlot->slot;
+            uint32_t materialInstanceId;
+            auto material = getEntityMaterial(entity, materialInstanceId);
+            if (material->getShader() != drawContext->material->getShader())
+            {
+                // The instance moves to the draw context of the new shader
+                removeInstance(entity);
+                m_addedEntities.push_back(entity);
+                continue;
+            }
+
+            removeMaterialInstance(drawContext, drawContext->instancesData[slot].materialInstanceId);
+            addMaterialInstance(drawContext, materialInstanceId);
+            drawContext->instancesData[slot].materialInstanceId = materialInstanceId;
+            drawContext->dirtySlots.push_back(slot);
+        }
+
+        for (auto entity : m_addedEntities)
+        {
+            addInstance(entity);
+        }
+
+        m_removedEntities.clear();
+        m_materialChangedEntities.clear();
+        m_addedEntities.clear();
+
+        for (auto [shaderType, pShaderDrawContext] : m_shaderDrawContexts)
+        {
+            for (auto [key, pMaterialDrawContext] : pShaderDrawContext->multiDrawIndirectContexts)
+            {
+                auto slotCount = pMaterialDrawContext->instancesData.size();
+                if (slotCount > INSTANCE_COMPACTION_MIN_SLOTS && slotCount > 2 * pMaterialDrawContext->instanceCount)
                 {
-                    pMaterialDrawContext->vao->addLayout(vboLayout, *pMaterialDrawContext->vbo.get(), nullptr);
+                    compactInstances(pMaterialDrawContext);
                 }
+            }
+        }
+    }
+
+    void SceneRenderer::setupLayouts(MultiDrawIndirectContext* drawContext)
+    {
+        // Buffers Layouts definition
+        auto vboLayoutPtr = VertexBufferLayout::create();
+        auto& vboLayout = *vboLayoutPtr.get();
+
+        // Update VBO Attributes Layout (GeometryPool PackedVertex)
+        vboLayout.addShort(4, true, 0); // quantized position (w unused)
+        vboLayout.addShort(2, true, 1); // octahedral encoded normal
+        vboLayout.addHalf(2, 2);        // texture coordinate
+
+        auto instanceDataLayoutPtr = VertexBufferLayout::create();
+        auto& instanceDataLayout = *instanceDataLayoutPtr.get();
+
+        // Update Instance Buffer Attributes Layout (MeshInstanceData)
+        instanceDataLayout.addFloat(4, false, 10, 1); // Instance rotation (quaternion)
+        instanceDataLayout.addFloat(3, false, 11, 1); // Instance translation
+        instanceDataLayout.addUInt(1, false, 14, 1);  // Material ID (or index)
+        instanceDataLayout.addFloat(3, false, 12, 1); // Instance scale
+
+        drawContext->vertexFormat = VertexFormatRegistry::getInstance().getVertexFormat({&vboLayout, &instanceDataLayout});
+    }
+
+    void SceneRenderer::updateDrawContextBuffers(MultiDrawIndirectContext* drawContext)
+    {
+        // Instances: each region of the streaming buffer must hold all the instance slots
+        auto& instanceBuffer = drawContext->instanceBuffer;
+        auto slotCount = std::max<size_t>(drawContext->instancesData.size(), 1);
+        auto regionInstanceCapacity = instanceBuffer->getSize() / sizeof(MeshInstanceData);
+        if (!instanceBuffer->isStreaming() || slotCount > regionInstanceCapacity)
+        {
+            auto requiredSize = slotCount * sizeof(MeshInstanceData);
+            auto regionSize = instanceBuffer->isStreaming() ? std::max(requiredSize, 2 * instanceBuffer->getSize()) : requiredSize;
+            regionSize = (regionSize + INSTANCE_REGION_SIZE_ALIGNMENT - 1) / INSTANCE_REGION_SIZE_ALIGNMENT * INSTANCE_REGION_SIZE_ALIGNMENT;
+            instanceBuffer->setSize(regionSize);
+            instanceBuffer->allocateStreaming(INSTANCE_BUFFER_FRAME_REGIONS);
+            drawContext->culledInstanceBuffer->allocate(regionSize);
+
+            // The new buffer content is undefined
+            for (auto& ranges : drawContext->pendingRanges)
+            {
+                ranges.clear();
+                ranges.push_back({0, static_cast<uint32_t>(drawContext->instancesData.size())});
+            }
+            drawContext->commandsDirty = true;
+        }
+
+        if (drawContext->vertexFormat == nullptr)
+        {
+            setupLayouts(drawContext);
+        }
+
+        if (drawContext->commandsDirty)
+        {
+            loadDrawCommands(drawContext);
+        }
+    }
+
+    void SceneRenderer::loadDrawCommands(MultiDrawIndirectContext* drawContext)
+    {
+        std::vector<DrawElementsIndirectCommand> elementsCommands;
+        std::vector<DrawArraysIndirectCommand> arraysCommands;
+        std::vector<MeshCullingData> meshesCullingData;
+        std::vector<uint32_t> slotCommands(drawContext->instancesData.size(), NO_MESH);
+
+        for (auto& meshAndInstances : drawContext->meshes)
+        {
+            auto staticMesh = meshAndInstances.staticMesh;
+            auto instanceCount = static_cast<uint32_t>(meshAndInstances.entities.size());
+            auto baseInstance = meshAndInstances.baseInstance;
+
+            // instanceCount / baseInstance are overwritten every frame by the culling pass
+            if (drawContext->hasIndices)
+            {
+                elementsCommands.emplace_back(staticMesh->getIndexCount(), instanceCount, meshAndInstances.firstIndex,
+                                              meshAndInstances.firstVertex, baseInstance);
+            }
+            else
+            {
+                arraysCommands.emplace_back(staticMesh->getVertexCount(), instanceCount, meshAndInstances.firstVertex, baseInstance);
+            }
 
-                auto instanceDataLayoutPtr = VertexBufferLayout::create();
-                auto& instanceDataLayout = *instanceDataLayoutPtr.get();
+            auto commandIndex = static_cast<uint32_t>(meshesCullingData.size());
+            std::fill_n(slotCommands.begin() + baseInstance, instanceCount, commandIndex);
 
-                // Update Instance Buffer Attributes Layout
-                instanceDataLayout.addFloat(4, false, 10, 1); //
-                instanceDataLayout.addFloat(4, false, 11, 1); //
-                instanceDataLayout.addFloat(4, false, 12, 1); // Instance Model to Word Matrix transform
-                instanceDataLayout.addFloat(4, false, 13, 1); //
-                instanceDataLayout.addUInt(1, false, 14, 1);  // Material ID (or index)
+            auto& meshCullingData = meshesCullingData.emplace_back();
+            meshCullingData.boundingSphere = glm::vec4(staticMesh->getBoundingSphereCenter(), staticMesh->getBoundingSphereRadius());
+            meshCullingData.positionOffset = meshAndInstances.positionOffset;
+            meshCullingData.positionScale = meshAndInstances.positionScale;
+            meshCullingData.baseInstance = baseInstance;
+        }
 
-                pMaterialDrawContext->vao->addLayout(instanceDataLayout, *pMaterialDrawContext->instanceBuffer.get());
+        auto commandCount = static_cast<uint32_t>(drawContext->meshes.size());
+        auto growIfNeeded = [](auto& buffer, size_t requiredSize)
+        {
+            if (requiredSize > buffer->getSize())
+            {
+                buffer->allocate(std::max(requiredSize, 2 * buffer->getSize()));
             }
+        };
+
+        auto& commandBuffer = drawContext->commandBuffer;
+        if (drawContext->hasIndices)
+        {
+            growIfNeeded(commandBuffer, elementsCommands.size() * sizeof(DrawElementsIndirectCommand));
+            commandBuffer->loadData(elementsCommands.data(), elementsCommands.size() * sizeof(DrawElementsIndirectCommand), 0);
+        }
+        else
+        {
+            growIfNeeded(commandBuffer, arraysCommands.size() * sizeof(DrawArraysIndirectCommand));
+            commandBuffer->loadData(arraysCommands.data(), arraysCommands.size() * sizeof(DrawArraysIndirectCommand), 0);
         }
+
+        auto& meshCullingBuffer = drawContext->meshCullingBuffer;
+        growIfNeeded(meshCullingBuffer, meshesCullingData.size() * sizeof(MeshCullingData));
+        meshCullingBuffer->loadData(meshesCullingData.data(), meshesCullingData.size() * sizeof(MeshCullingData), 0);
+
+        auto& slotCommandBuffer = drawContext->slotCommandBuffer;
+        growIfNeeded(slotCommandBuffer, slotCommands.size() * sizeof(uint32_t));
+        slotCommandBuffer->loadData(slotCommands.data(), slotCommands.size() * sizeof(uint32_t), 0);
+
+        drawContext->commandCount = commandCount;
+        drawContext->cullingSlotCount = static_cast<uint32_t>(slotCommands.size());
+        drawContext->commandsDirty = false;
     }
 
-    void SceneRenderer::loadDataToBuffers()
+    void SceneRenderer::updateStatistics()
     {
         auto& sceneStats = m_scene->getStatistics();
         sceneStats.indicesCount = 0;
@@ -268,200 +927,612 @@ namespace comet
         {
             for (auto [key, pMaterialDrawContext] : pShaderDrawContext->multiDrawIndirectContexts)
             {
-                uint32_t firstIndex{0};
-                uint32_t firstVertex{0};
-                uint32_t baseVertex{0};
+                for (auto& meshAndInstances : pMaterialDrawContext->meshes)
+                {
+                    sceneStats.indicesCount += meshAndInstances.staticMesh->getIndexCount();
+                    sceneStats.verticesCount += meshAndInstances.staticMesh->getVertexCount();
+                }
+                sceneStats.drawCommandsCount += pMaterialDrawContext->commandCount;
+            }
+        }
+    }
 
-                // Map Buffers memory
-                pMaterialDrawContext->vbo->mapMemory(GL_WRITE_ONLY);
-                pMaterialDrawContext->instanceBuffer->mapMemory(GL_WRITE_ONLY);
-                pMaterialDrawContext->commandBuffer->mapMemory(GL_WRITE_ONLY);
-                bool indexBufferExists = (pMaterialDrawContext->ibo->getSize() > 0);
+    void SceneRenderer::setCullingMode(CullingMode cullingMode)
+    {
+        if (cullingMode == m_cullingMode)
+        {
+            return;
+        }
 
-                if (indexBufferExists)
+        // The CPU culling only writes the visible instances: the instance buffer regions must be fully written again
+        if (m_cullingMode == CullingMode::CPU)
+        {
+            for (auto [shaderType, pShaderDrawContext] : m_shaderDrawContexts)
+            {
+                for (auto [key, pMaterialDrawContext] : pShaderDrawContext->multiDrawIndirectContexts)
                 {
-                    pMaterialDrawContext->ibo->mapMemory(GL_WRITE_ONLY);
+                    for (auto& ranges : pMaterialDrawContext->pendingRanges)
+                    {
+                        ranges.clear();
+                        ranges.push_back({0, static_cast<uint32_t>(pMaterialDrawContext->instancesData.size())});
+                    }
+                    pMaterialDrawContext->commandsDirty = true;
                 }
+            }
+        }
+
+        m_cullingMode = cullingMode;
+    }
+
+    void SceneRenderer::reloadData()
+    {
+        reloadInstanceData_T3.resume();
+
+        // The camera matrices are needed by the CPU culling
+        if (m_preRenderFunction)
+        {
+            m_preRenderFunction(*this, m_userData);
+        }
+
+        // Updated once per frame by Renderer::beginFrame, before the scene renders
+        auto& textureStats = TextureResidencyManager::getInstance().getStatistics();
+        auto& sceneStats = m_scene->getStatistics();
+        sceneStats.residentTexturesCount = textureStats.residentTexturesCount;
+        sceneStats.reducedTexturesCount = textureStats.reducedTexturesCount;
+        sceneStats.evictedTexturesCount = textureStats.evictedTexturesCount;
+        sceneStats.textureResidentBytes = textureStats.residentBytes;
+        sceneStats.textureBudgetBytes = textureStats.budget;
+
+        // Only the materials modified since the last frame are uploaded
+        MaterialRegistry::getInstance().updateMaterialTable();
+
+        // The lights are uploaded only when they changed, the light lists of the clusters only when the camera moved
+        m_scene->updateLightBuffer();
+        if (m_lightGrid)
+        {
+            m_lightGrid->update(m_scene->getLightBuffer(), m_view, m_projection);
+        }
+
+        reloadInstanceData_T1.resume();
+        applyTopologyChanges();
+        updateDirtyInstances();
+        reloadInstanceData_T1.pause();
 
-                // Load Data from Meshes and Mesh Instances
-                for (auto [staticMeshId, meshAndInstancesData] : pMaterialDrawContext->staticMeshes)
+        if (m_drawOrder == DrawOrder::FRONT_TO_BACK)
+        {
+            for (auto [shaderType, pShaderDrawContext] : m_shaderDrawContexts)
+            {
+                for (auto [key, pMaterialDrawContext] : pShaderDrawContext->multiDrawIndirectContexts)
                 {
-                    auto staticMesh = meshAndInstancesData.staticMesh;
-                    uint32_t indexCount = staticMesh->getIndexCount();
-                    if (indexCount > 0)
+                    if (pMaterialDrawContext->boundsDirty || !pMaterialDrawContext->dirtySlots.empty())
                     {
-                        firstIndex = pMaterialDrawContext->ibo->getCount();
-                        auto indices = staticMesh->getIndices();
-                        pMaterialDrawContext->ibo->loadDataInMappedMemory(indices.data(), indexCount);
+                        updateDrawContextBounds(pMaterialDrawContext);
                     }
+                }
+            }
+        }
 
-                    auto vertices = staticMesh->getVertices();
-                    auto verticesSize = staticMesh->getVerticesSize();
-                    auto vertexCount = staticMesh->getVertexCount();
-                    firstVertex = pMaterialDrawContext->vbo->getCount();
-                    pMaterialDrawContext->vbo->loadDataInMappedMemory((const void*)vertices.data(), verticesSize, vertexCount);
+        if (m_cullingMode == CullingMode::CPU)
+        {
+            cullInstancesOnCpu();
+        }
+
+        reloadInstanceData_T2.resume();
+        uploadDirtyInstances();
+        reloadInstanceData_T2.pause();
+
+        // After the upload: the draw commands of the new draw contexts are loaded
+        buildRenderQueue();
+
+        reloadInstanceData_T3.pause();
+    }
+
+    void SceneRenderer::updateDirtyInstances()
+    {
+        auto& registry = m_scene->m_registry;
+        auto pEntities = m_transformObserver.data();
+        std::mutex dirtySlotsMutex;
+
+        // Each patched entity owns its slot: the transforms are written without synchronization,
+        // only the dirty slots lists are merged under a lock (once per chunk)
+        ThreadPool::getInstance().parallelFor(m_transformObserver.size(), GATHER_MIN_CHUNK_SIZE, [&](size_t begin, size_t end)
+        {
+            std::vector<std::pair<MultiDrawIndirectContext*, uint32_t>> dirtySlots;
+            dirtySlots.reserve(end - begin);
+
+            for (auto i = begin; i < end; ++i)
+            {
+                auto instanceSlot = findInstanceSlot(pEntities[i]);
+                if (instanceSlot == nullptr)
+                {
+                    continue;
+                }
+
+                auto drawContext = instanceSlot->drawContext;
+                drawContext->instancesData[instanceSlot->slot].setTransform(registry.get<TransformComponent>(pEntities[i]));
+                dirtySlots.emplace_back(drawContext, instanceSlot->slot);
+            }
+
+            std::lock_guard<std::mutex> lock(dirtySlotsMutex);
+            for (auto [drawContext, slot] : dirtySlots)
+            {
+                drawContext->dirtySlots.push_back(slot);
+            }
+        });
+        m_transformObserver.clear();
+    }
 
-                    auto instanceCount =  static_cast<uint32_t>(meshAndInstancesData.instancesData.size());
-                    auto baseInstance =  pMaterialDrawContext->instanceBuffer->getCount();
+    void SceneRenderer::uploadDirtyInstances()
+    {
+        auto& sceneStats = m_scene->getStatistics();
+        sceneStats.updatedInstancesCount = 0;
+        sceneStats.visibleInstancesCount = 0;
+        sceneStats.culledInstancesCount = 0;
+        if (m_cullingMode != CullingMode::CPU)
+        {
+            sceneStats.cullingNsPerInstance = 0.0f;
+        }
 
-                    for (auto& instanceData : meshAndInstancesData.instancesData)
+        for (auto [shaderType, pShaderDrawContext] : m_shaderDrawContexts)
+        {
+            for (auto [key, pMaterialDrawContext] : pShaderDrawContext->multiDrawIndirectContexts)
+            {
+                // Apply the topology changes (buffers growth, new geometry, draw commands)
+                updateDrawContextBuffers(pMaterialDrawContext);
+
+                if (m_cullingMode == CullingMode::CPU)
+                {
+                    uploadVisibleInstances(pMaterialDrawContext);
+                    continue;
+                }
+
+                // Coalesce the dirty slots into ranges, to be written in every region of the ring buffer
+                auto& dirtySlots = pMaterialDrawContext->dirtySlots;
+                if (!dirtySlots.empty())
+                {
+                    std::sort(dirtySlots.begin(), dirtySlots.end());
+                    dirtySlots.erase(std::unique(dirtySlots.begin(), dirtySlots.end()), dirtySlots.end());
+
+                    std::vector<InstanceRange> dirtyRanges;
+                    for (auto slot : dirtySlots)
                     {
-                        pMaterialDrawContext->instanceBuffer->loadDataInMappedMemory((const void*)&instanceData, sizeof(instanceData), 1);
+                        if (!dirtyRanges.empty() && dirtyRanges.back().first + dirtyRanges.back().count == slot)
+                        {
+                            dirtyRanges.back().count++;
+                        }
+                        else
+                        {
+                            dirtyRanges.push_back({slot, 1});
+                        }
                     }
+                    dirtySlots.clear();
 
-                    if (indexCount > 1)
+                    for (auto& pendingRanges : pMaterialDrawContext->pendingRanges)
                     {
-                        DrawElementsIndirectCommand cmd{indexCount, instanceCount, firstIndex, baseVertex, baseInstance};
-                        pMaterialDrawContext->commandBuffer->loadDataInMappedMemory((const void*)&cmd, sizeof(cmd), 1);
-                        baseVertex += vertexCount;
+                        pendingRanges.insert(pendingRanges.end(), dirtyRanges.begin(), dirtyRanges.end());
                     }
-                    else
+                }
+
+                // No map/unmap here: the region of the current frame is persistently mapped,
+                // we only wait (if ever) for the GPU to release it
+                auto& instanceBuffer = pMaterialDrawContext->instanceBuffer;
+                auto pRegion = static_cast<char*>(instanceBuffer->acquireRegion());
+                auto& instancesData = pMaterialDrawContext->instancesData;
+                auto& pendingRanges = pMaterialDrawContext->pendingRanges[instanceBuffer->getRegionIndex()];
+                for (auto& range : pendingRanges)
+                {
+                    if (range.count == 0)
                     {
-                        DrawArraysIndirectCommand cmd{vertexCount, instanceCount, firstVertex, baseInstance};
-                        pMaterialDrawContext->commandBuffer->loadDataInMappedMemory((const void*)&cmd, sizeof(cmd), 1);
+                        continue;
                     }
+
+                    memcpy(pRegion + range.first * sizeof(MeshInstanceData), &instancesData[range.first],
+                           range.count * sizeof(MeshInstanceData));
+                    sceneStats.updatedInstancesCount += range.count;
+                }
+                pendingRanges.clear();
+                instanceBuffer->unmapMemory();
+            }
+        }
+
+        updateStatistics();
+    }
+
+    void SceneRenderer::cullInstancesOnCpu()
+    {
+        auto startTime = TimerClock::now();
+        auto frustum = Frustum::fromViewProjection(m_projection * m_view);
+        size_t slotsCount{0};
+
+        for (auto [shaderType, pShaderDrawContext] : m_shaderDrawContexts)
+        {
+            for (auto [key, pMaterialDrawContext] : pShaderDrawContext->multiDrawIndirectContexts)
+            {
+                auto drawContext = pMaterialDrawContext;
+                auto slotCount = drawContext->instancesData.size();
+                slotsCount += slotCount;
+
+                // Slots not used by any mesh (holes) are never visible
+                drawContext->slotMeshes.assign(slotCount, NO_MESH);
+                for (uint32_t meshIndex = 0; meshIndex < drawContext->meshes.size(); ++meshIndex)
+                {
+                    auto& meshAndInstances = drawContext->meshes[meshIndex];
+                    auto first = drawContext->slotMeshes.begin() + meshAndInstances.baseInstance;
+                    std::fill(first, first + meshAndInstances.entities.size(), meshIndex);
                 }
 
-                // Stats
-                sceneStats.indicesCount = pMaterialDrawContext->ibo->getCount();
-                sceneStats.verticesCount = pMaterialDrawContext->vbo->getCount();
-                sceneStats.drawCommandsCount = pMaterialDrawContext->commandBuffer->getCount();
+                drawContext->boundsX.resize(slotCount);
+                drawContext->boundsY.resize(slotCount);
+                drawContext->boundsZ.resize(slotCount);
+                drawContext->boundsRadius.resize(slotCount);
+                drawContext->visibility.resize(slotCount);
 
-                pMaterialDrawContext->ibo->unmapMemory();
-                pMaterialDrawContext->vbo->unmapMemory();
-                pMaterialDrawContext->instanceBuffer->unmapMemory();
-                pMaterialDrawContext->commandBuffer->unmapMemory();
+                ThreadPool::getInstance().parallelFor(slotCount, CPU_CULLING_MIN_CHUNK_SIZE, [drawContext, &frustum](size_t begin, size_t end)
+                {
+                    // World space bounding spheres of the chunk, then SIMD test against the frustum
+                    for (auto slot = begin; slot < end; ++slot)
+                    {
+                        auto meshIndex = drawContext->slotMeshes[slot];
+                        if (meshIndex == NO_MESH)
+                        {
+                            drawContext->boundsX[slot] = drawContext->boundsY[slot] = drawContext->boundsZ[slot] = 0.0f;
+                            drawContext->boundsRadius[slot] = -std::numeric_limits<float>::max();
+                            continue;
+                        }
+
+                        auto staticMesh = drawContext->meshes[meshIndex].staticMesh;
+                        auto& instanceData = drawContext->instancesData[slot];
+                        auto center = instanceData.transformPoint(staticMesh->getBoundingSphereCenter());
+
+                        drawContext->boundsX[slot] = center.x;
+                        drawContext->boundsY[slot] = center.y;
+                        drawContext->boundsZ[slot] = center.z;
+                        drawContext->boundsRadius[slot] = staticMesh->getBoundingSphereRadius() * instanceData.getMaxScale();
+                    }
+
+                    frustum.cullSpheres(&drawContext->boundsX[begin], &drawContext->boundsY[begin], &drawContext->boundsZ[begin],
+                                        &drawContext->boundsRadius[begin], &drawContext->visibility[begin], end - begin);
+                });
             }
         }
+
+        auto duration = std::chrono::duration_cast<TimerDuration>(TimerClock::now() - startTime);
+        auto& sceneStats = m_scene->getStatistics();
+        sceneStats.cullingNsPerInstance = slotsCount ? static_cast<float>(duration.count()) / slotsCount : 0.0f;
     }
 
-    void SceneRenderer::reloadData()
+    void SceneRenderer::uploadVisibleInstances(MultiDrawIndirectContext* drawContext)
     {
-        reloadInstanceData_T3.resume();
+        // The whole region is written with the visible instances only, compacted per mesh
+        drawContext->dirtySlots.clear();
+        for (auto& ranges : drawContext->pendingRanges)
+        {
+            ranges.clear();
+        }
 
+        auto& instanceBuffer = drawContext->instanceBuffer;
+        auto pRegion = static_cast<MeshInstanceData*>(instanceBuffer->acquireRegion());
+        ASSERT(instanceBuffer->getSize() % sizeof(MeshInstanceData) == 0, "The instance regions must hold a whole number of instances");
+        auto regionBaseInstance = instanceBuffer->getRegionIndex() * static_cast<uint32_t>(instanceBuffer->getSize() / sizeof(MeshInstanceData));
+
+        std::vector<DrawElementsIndirectCommand> elementsCommands;
+        std::vector<DrawArraysIndirectCommand> arraysCommands;
         auto& sceneStats = m_scene->getStatistics();
-        sceneStats.entitiesCount = 0;
 
-        auto& registry = m_scene->m_registry;
-        auto currentMaterialId{-1};
-        uint32_t currentMeshTypeId{0};
-        uint32_t currentMaterialTypeId{0};
-        std::unordered_set<uint32_t> tmpMeshTypes;
-        
-        reloadInstanceData_T1.resume();
-        registry.group<TransformComponent, MeshComponent>().each([&](auto entity, auto& transform, auto& mesh)
+        for (auto& meshAndInstances : drawContext->meshes)
         {
-            ResourceHandler<StaticMesh> staticMeshHandler;
-            StaticMesh* staticMesh;
-            Material* material{nullptr};
-            uint32_t materialInstanceId{0};
-            bool hasIndices;
+            auto staticMesh = meshAndInstances.staticMesh;
+            auto baseInstance = meshAndInstances.baseInstance;
+            auto instanceCount = static_cast<uint32_t>(meshAndInstances.entities.size());
 
-            sceneStats.entitiesCount++;
-
-            staticMeshHandler = ResourceManager::getInstance().getStaticMesh(mesh.meshTypeId);
-            staticMesh = staticMeshHandler.resource;
-            hasIndices = staticMesh->hasIndices();
+            // The vertex shaders read quantized positions: the dequantization is applied to the drawn transforms
+            uint32_t visibleCount{0};
+            for (auto slot = baseInstance; slot < baseInstance + instanceCount; ++slot)
+            {
+                if (drawContext->visibility[slot])
+                {
+                    // Built before being copied: the mapped memory must not be read
+                    auto instanceData = drawContext->instancesData[slot];
+                    instanceData.translation = instanceData.transformPoint(meshAndInstances.positionOffset);
+                    instanceData.scale *= meshAndInstances.positionScale;
+                    pRegion[baseInstance + visibleCount++] = instanceData;
+                }
+            }
 
-            bool hasMaterial = registry.has<MaterialComponent>(entity);
-            if (hasMaterial)
+            if (drawContext->hasIndices)
+            {
+                elementsCommands.emplace_back(staticMesh->getIndexCount(), visibleCount, meshAndInstances.firstIndex,
+                                              meshAndInstances.firstVertex, regionBaseInstance + baseInstance);
+            }
+            else
             {
-                auto materialComponent = registry.get<MaterialComponent>(entity);
-                materialInstanceId = materialComponent.materialInstanceId;
-                material = MaterialRegistry::getInstance().getMaterialInstance(materialInstanceId);
+                arraysCommands.emplace_back(staticMesh->getVertexCount(), visibleCount, meshAndInstances.firstVertex,
+                                            regionBaseInstance + baseInstance);
             }
 
-            if (material == nullptr)
+            sceneStats.visibleInstancesCount += visibleCount;
+            sceneStats.culledInstancesCount += instanceCount - visibleCount;
+            sceneStats.updatedInstancesCount += visibleCount;
+        }
+        instanceBuffer->unmapMemory();
+
+        if (drawContext->hasIndices)
+        {
+            drawContext->commandBuffer->loadData(elementsCommands.data(), elementsCommands.size() * sizeof(DrawElementsIndirectCommand), 0);
+        }
+        else
+        {
+            drawContext->commandBuffer->loadData(arraysCommands.data(), arraysCommands.size() * sizeof(DrawArraysIndirectCommand), 0);
+        }
+    }
+
+    void SceneRenderer::cullInstances()
+    {
+        // Same planes as the CPU culling
+        auto frustum = Frustum::fromViewProjection(m_projection * m_view);
+
+        m_cullingShader->bind();
+        m_cullingShader->setUniform(FRUSTUM_PLANES_UNIFORM, 6, frustum.planes);
+        m_cullingShader->setUniform(CULLING_ENABLED_UNIFORM, (m_cullingMode == CullingMode::GPU) ? 1 : 0);
+
+        for (auto [shaderType, pShaderDrawContext] : m_shaderDrawContexts)
+        {
+            for (auto [key, pMaterialDrawContext] : pShaderDrawContext->multiDrawIndirectContexts)
             {
-                material = m_defaultMaterial;
-                materialInstanceId = material->getInstanceId();
+                auto commandCount = pMaterialDrawContext->commandCount;
+                if (commandCount == 0)
+                {
+                    continue;
+                }
+
+                auto& instanceBuffer = pMaterialDrawContext->instanceBuffer;
+                auto regionSize = instanceBuffer->getSize();
+                instanceBuffer->bindStorage(0, instanceBuffer->getRegionIndex() * regionSize, regionSize);
+                pMaterialDrawContext->culledInstanceBuffer->bindStorage(1);
+                pMaterialDrawContext->meshCullingBuffer->bindStorage(2);
+                pMaterialDrawContext->commandBuffer->bindStorage(3);
+                pMaterialDrawContext->slotCommandBuffer->bindStorage(4);
+
+                auto commandSize = key.hasIndices ? sizeof(DrawElementsIndirectCommand) : sizeof(DrawArraysIndirectCommand);
+                m_cullingShader->setUniform(COMMAND_COUNT_UNIFORM, commandCount);
+                m_cullingShader->setUniform(COMMAND_STRIDE_UNIFORM, static_cast<uint32_t>(commandSize / sizeof(uint32_t)));
+
+                // Reset the commands instance counters, then append the visible instances
+                m_cullingShader->setUniform(RESET_COMMANDS_UNIFORM, 1);
+                glDispatchCompute((commandCount + CULLING_WORKGROUP_SIZE - 1) / CULLING_WORKGROUP_SIZE, 1, 1);
+                glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+                // One invocation per instance slot, whatever the number of instances of each mesh
+                auto slotCount = pMaterialDrawContext->cullingSlotCount;
+                if (slotCount > 0)
+                {
+                    m_cullingShader->setUniform(RESET_COMMANDS_UNIFORM, 0);
+                    m_cullingShader->setUniform(SLOT_COUNT_UNIFORM, slotCount);
+                    glDispatchCompute((slotCount + CULLING_WORKGROUP_SIZE - 1) / CULLING_WORKGROUP_SIZE, 1, 1);
+                }
             }
+        }
 
-            MultiDrawKey key;
-            key = MultiDrawKey{hasIndices};
+        // The draw calls source their commands and instance attributes from the culling pass output
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    }
 
-            auto shaderTypeHash = material->getShader()->getTypeHash();
-            auto& drawContextMap = m_shaderDrawContexts[shaderTypeHash]->multiDrawIndirectContexts;
-            auto currentDrawContext = drawContextMap[key];           
-            auto& meshAndInstances = currentDrawContext->staticMeshes[staticMeshHandler.resourceId];
-            meshAndInstances.staticMesh = staticMesh;
+    void SceneRenderer::updateDrawContextBounds(MultiDrawIndirectContext* drawContext)
+    {
+        glm::vec3 boundsMin{std::numeric_limits<float>::max()};
+        glm::vec3 boundsMax{std::numeric_limits<float>::lowest()};
 
-            // Reset the instancesData vector first time it is accessed for a specific Mesh Type
-            if (tmpMeshTypes.find(staticMeshHandler.resourceId) == tmpMeshTypes.end())
+        for (auto& meshAndInstances : drawContext->meshes)
+        {
+            auto radius = meshAndInstances.staticMesh->getBoundingSphereRadius();
+            auto& center = meshAndInstances.staticMesh->getBoundingSphereCenter();
+            auto instanceCount = static_cast<uint32_t>(meshAndInstances.entities.size());
+            for (auto slot = meshAndInstances.baseInstance; slot < meshAndInstances.baseInstance + instanceCount; ++slot)
             {
-                tmpMeshTypes.insert(staticMeshHandler.resourceId);
-                meshAndInstances.instancesData.clear();
+                auto& instanceData = drawContext->instancesData[slot];
+                auto scale = instanceData.getMaxScale();
+                auto worldCenter = instanceData.transformPoint(center);
+                boundsMin = glm::min(boundsMin, worldCenter - radius * scale);
+                boundsMax = glm::max(boundsMax, worldCenter + radius * scale);
             }
-            meshAndInstances.instancesData.emplace_back(transform.getTransform(), materialInstanceId);
-        });
-        reloadInstanceData_T1.pause();
+        }
 
-        reloadInstanceData_T2.resume();
+        drawContext->boundsMin = boundsMin;
+        drawContext->boundsMax = boundsMax;
+        drawContext->boundsDirty = false;
+    }
+
+    void SceneRenderer::buildRenderQueue()
+    {
+        bool frontToBack = (m_drawOrder == DrawOrder::FRONT_TO_BACK);
+        auto cameraPosition = glm::vec3(glm::inverse(m_view)[3]);
+
+        m_renderQueue.clear();
         for (auto [shaderType, pShaderDrawContext] : m_shaderDrawContexts)
         {
             for (auto [key, pMaterialDrawContext] : pShaderDrawContext->multiDrawIndirectContexts)
             {
-                // TODO(jcp): This mapMemory can be quite slow for big buffers. Check if splitting in multiple buffers would be faster!
-                pMaterialDrawContext->instanceBuffer->mapMemory(GL_WRITE_ONLY);
-                for (auto& [staticMeshId, meshAndInstancesData] : pMaterialDrawContext->staticMeshes)
+                if (pMaterialDrawContext->commandCount == 0)
                 {
-                    for (auto& instanceData : meshAndInstancesData.instancesData)
-                    {
-                        pMaterialDrawContext->instanceBuffer->loadDataInMappedMemory((const void*)&instanceData, sizeof(instanceData), 1);
-                    }
+                    continue;
                 }
-                pMaterialDrawContext->instanceBuffer->unmapMemory();
+
+                // Distance from the camera to the instances bounds (0 when the camera is inside)
+                float depth{0.0f};
+                if (frontToBack && pMaterialDrawContext->boundsMin.x <= pMaterialDrawContext->boundsMax.x)
+                {
+                    auto closestPoint = glm::clamp(cameraPosition, pMaterialDrawContext->boundsMin, pMaterialDrawContext->boundsMax);
+                    depth = glm::length(closestPoint - cameraPosition);
+                }
+
+                // The textures are bound from the material of the draw context, the vertex arrays are shared per vertex format
+                auto materialId = static_cast<uint16_t>(pMaterialDrawContext->material->getInstanceId());
+                auto vertexArrayId = static_cast<uint8_t>(pMaterialDrawContext->vertexFormat->getSortId());
+                auto sortKey = RenderQueue::makeSortKey(frontToBack, RenderQueue::Pass::OPAQUE, pShaderDrawContext->sortId,
+                                                        materialId, vertexArrayId, depth);
+                m_renderQueue.push(sortKey, pMaterialDrawContext);
             }
         }
-        reloadInstanceData_T2.pause();
-        reloadInstanceData_T3.pause();
+
+        m_renderQueue.sort();
     }
 
-    void SceneRenderer::render()
+    void SceneRenderer::drawIndirect(MultiDrawIndirectContext* drawContext, const VertexFormat*& currentFormat)
     {
-        auto& sceneStats = m_scene->getStatistics();
-        sceneStats.drawCalls = 0;
-        
-        if (m_preRenderFunction)
+        auto vertexFormat = drawContext->vertexFormat;
+        if (vertexFormat != currentFormat)
         {
-            m_preRenderFunction(*this, m_userData);
+            currentFormat = vertexFormat;
+            currentFormat->bind();
         }
 
-        for (auto [shaderType, pShaderDrawContext] : m_shaderDrawContexts)
+        // Only the buffers that differ from the previous draw context are attached
+        auto& geometryPool = GeometryPool::getInstance();
+        auto& instanceBuffer = (m_cullingMode == CullingMode::CPU) ? drawContext->instanceBuffer : drawContext->culledInstanceBuffer;
+        vertexFormat->bindVertexBuffer(0, geometryPool.getVertexBuffer());
+        vertexFormat->bindVertexBuffer(1, *instanceBuffer.get());
+        if (drawContext->hasIndices)
+        {
+            vertexFormat->bindIndexBuffer(geometryPool.getIndexBuffer(drawContext->indexType));
+        }
+        drawContext->commandBuffer->bind();
+
+        m_scene->getStatistics().drawCalls++;
+
+        auto commandCount = drawContext->commandCount;
+        if (drawContext->hasIndices)
+        {
+            auto indexType = (drawContext->indexType == IndexType::UINT16) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+            glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, nullptr, commandCount, 0);
+        }
+        else
         {
-            auto currentShader = pShaderDrawContext->shader;
-            currentShader->bind();
-            currentShader->setUniform("view_matrix", m_view);
-            currentShader->setUniform("projection_matrix", m_projection);
+            glMultiDrawArraysIndirect(GL_TRIANGLES, nullptr, commandCount, 0);
+        }
+    }
+
+    void SceneRenderer::renderDepthPrePass()
+    {
+        m_depthOnlyShader->bind();
 
-            // TODO(jcp): Revise Light management in the SceneRenderer: should be an entity or part of the environment
-            for (auto& light : m_scene->getLights())
+        auto& stateCache = OpenglStateCache::getInstance();
+        stateCache.setColorMask(false);
+        stateCache.setDepthFunc(GL_LESS);
+
+        const VertexFormat* currentFormat{nullptr};
+        for (auto& packet : m_renderQueue.getPackets())
+        {
+            if (packet.drawContext->hasDepthOnlyVariant)
             {
-                light->loadUniforms(currentShader);
+                drawIndirect(packet.drawContext, currentFormat);
             }
+        }
 
-            for (auto [key, pMaterialDrawContext] : pShaderDrawContext->multiDrawIndirectContexts)
-            {
-                auto currentMaterial = pMaterialDrawContext->material;
-                currentMaterial->loadUniforms();
+        // The shading pass only keeps the fragments that won the depth test, and doesn't need to write the depth again
+        stateCache.setColorMask(true);
+        stateCache.setDepthFunc(GL_EQUAL);
+        stateCache.setDepthMask(false);
+    }
 
-                pMaterialDrawContext->vao->bind();
-                pMaterialDrawContext->commandBuffer->bind();
+    void SceneRenderer::uploadFrameData()
+    {
+        // The tiles of the light grid cover the current viewport
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+
+        FrameData frameData;
+        frameData.view = m_view;
+        frameData.projection = m_projection;
+        frameData.viewProjection = m_projection * m_view;
+        frameData.inverseView = glm::inverse(m_view);
+        frameData.cameraPosition = frameData.inverseView[3];
+        frameData.viewportSize = glm::vec2(static_cast<float>(viewport[2]), static_cast<float>(viewport[3]));
+        frameData.time = std::chrono::duration<float>(std::chrono::steady_clock::now() - m_startTime).count();
+        frameData.padding = 0.0f;
+
+        m_frameDataBuffer->loadData(&frameData, sizeof(FrameData), 0);
+        m_frameDataBuffer->bindUniform(FRAME_DATA_BINDING);
+    }
+
+    void SceneRenderer::render()
+    {
+        auto& sceneStats = m_scene->getStatistics();
+        sceneStats.drawCalls = 0;
+
+        // The counters are never reset: only the calls of this renderer are reported
+        auto& stateCache = OpenglStateCache::getInstance();
+        auto issuedStateCalls = stateCache.getCounters().issuedCalls;
+        auto skippedStateCalls = stateCache.getCounters().skippedCalls;
 
-                sceneStats.drawCalls++;
+        // Once per frame, for all the shaders
+        uploadFrameData();
+        MaterialRegistry::getInstance().bindMaterialTable();
+        m_scene->getLightBuffer().bind();
+        m_lightGrid->bind();
 
-                if (key.hasIndices)
+        if (m_cullingMode != CullingMode::CPU)
+        {
+            cullInstances();
+        }
+
+        if (m_depthPrePass)
+        {
+            renderDepthPrePass();
+        }
+
+        Shader* currentShader{nullptr};
+        const VertexFormat* currentFormat{nullptr};
+        auto drawPackets = [&](bool depthPrePassPackets)
+        {
+            for (auto& packet : m_renderQueue.getPackets())
+            {
+                auto pMaterialDrawContext = packet.drawContext;
+                if (m_depthPrePass && pMaterialDrawContext->hasDepthOnlyVariant != depthPrePassPackets)
                 {
-                    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr,
-                                    pMaterialDrawContext->commandBuffer->getCount(), 0);
+                    continue;
                 }
-                else
+
+                // Only the state that differs from the previous packet is bound
+                auto shader = pMaterialDrawContext->material->getShader();
+                if (shader != currentShader)
                 {
-                    glMultiDrawArraysIndirect(GL_TRIANGLES, nullptr,
-                                    pMaterialDrawContext->commandBuffer->getCount(), 0);
+                    currentShader = shader;
+                    currentShader->bind();
+
+                    // The material parameters are in the material table: only the textures are bound
+                    pMaterialDrawContext->material->loadUniforms();
                 }
+
+                drawIndirect(pMaterialDrawContext, currentFormat);
+
+                // The draw context material only binds the textures, each instance samples the ones of its own material
+                auto& materialRegistry = MaterialRegistry::getInstance();
+                for (auto [materialInstanceId, instanceCount] : pMaterialDrawContext->materialInstanceCounts)
+                {
+                    if (auto material = materialRegistry.getMaterialInstance(materialInstanceId))
+                    {
+                        material->markTexturesUsed();
+                    }
+                }
+
+                // The region can be written again once the culling pass and these draw calls have been executed
+                pMaterialDrawContext->instanceBuffer->fenceRegion();
             }
+        };
+
+        // Without depth pre-pass, every packet is drawn here
+        drawPackets(true);
+        if (m_depthPrePass)
+        {
+            // The packets left out of the pre-pass are depth tested and written as usual
+            stateCache.setDepthFunc(GL_LESS);
+            stateCache.setDepthMask(true);
+            drawPackets(false);
         }
+
+        auto& stateCounters = stateCache.getCounters();
+        sceneStats.issuedStateCalls = stateCounters.issuedCalls - issuedStateCalls;
+        sceneStats.skippedStateCalls = stateCounters.skippedCalls - skippedStateCalls;
     }
 
 } // namespace comet
\ No newline at end of file
@@ -25,6 +25,7 @@ namespace comet
 
         // Find 'shaderName' shader files
         uint8_t shaderFoundCount{0};
+        bool computeShaderFound{false};
         for (auto& p : fs::recursive_directory_iterator(shaderRootPath))
         {
             auto filenameWithoutExt = p.path().stem().string();
@@ -66,9 +67,11 @@ namespace comet
 
             shader->compileShaderFile(p.path().c_str(), shaderType);
             shaderFoundCount++;
+            computeShaderFound |= (shaderType == Shader::Type::COMPUTE);
         }
 
-        if (shaderFoundCount >= 2)
+        // A compute program is made of a single shader file
+        if (shaderFoundCount >= 2 || computeShaderFound)
         {
             // Link program
             CM_CORE_LOG_DEBUG("Linking shader program: {}", shader->getName());
@@ -2,6 +2,10 @@
 #include <comet/resourceManager.h>
 #include <core/objLoader.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 namespace comet
 {
     
@@ -9,9 +13,11 @@ namespace comet
     {
         auto meshResourcePath = ResourceManager::getInstance().getResourcePath(ResourceType::MESH, filename);
         ObjLoader loader;
-        loader.loadFile(meshResourcePath, m_vertices, m_indices);
+        std::vector<uint32_t> indices;
+        loader.loadFile(meshResourcePath, m_vertices, indices);
         m_vertexCount = m_vertices.size();
-        m_indexCount = m_indices.size();
+        setIndices(indices.data(), static_cast<uint32_t>(indices.size()));
+        computeBounds();
     }
 
     StaticMesh::StaticMesh(const char* name, Vertex* vertices, uint32_t vertexCount)
@@ -41,17 +47,64 @@ namespace comet
             m_vertices.push_back(data[i]);
         }
         m_vertexCount = vertexCount;
+        computeBounds();
     }
 
     void StaticMesh::setIndices(const uint32_t* indices, uint32_t indexCount)
     {
-        m_indices.clear();
-        m_indices.reserve(indexCount);
-        for(uint32_t i = 0; i < indexCount; ++i)
+        m_indices16.clear();
+        m_indices32.clear();
+
+        auto maxIndex = indexCount ? *std::max_element(indices, indices + indexCount) : 0;
+        m_indexType = (maxIndex <= std::numeric_limits<uint16_t>::max()) ? IndexType::UINT16 : IndexType::UINT32;
+        if (m_indexType == IndexType::UINT16)
+        {
+            m_indices16.assign(indices, indices + indexCount);
+        }
+        else
         {
-            m_indices.push_back(indices[i]);
+            m_indices32.assign(indices, indices + indexCount);
         }
         m_indexCount = indexCount;
     }
 
+    const void* StaticMesh::getIndexData() const
+    {
+        if (m_indexType == IndexType::UINT16)
+        {
+            return m_indices16.data();
+        }
+
+        return m_indices32.data();
+    }
+
+    void StaticMesh::computeBounds()
+    {
+        if (m_vertices.empty())
+        {
+            m_aabbMin = m_aabbMax = glm::vec3(0.0f);
+            m_boundingSphereCenter = glm::vec3(0.0f);
+            m_boundingSphereRadius = 0.0f;
+            return;
+        }
+
+        // Sphere centered on the AABB: not the tightest one, but good enough for culling
+        m_aabbMin = m_vertices[0].position;
+        m_aabbMax = m_vertices[0].position;
+        for (auto& vertex : m_vertices)
+        {
+            m_aabbMin = glm::min(m_aabbMin, vertex.position);
+            m_aabbMax = glm::max(m_aabbMax, vertex.position);
+        }
+
+        m_boundingSphereCenter = (m_aabbMin + m_aabbMax) * 0.5f;
+        float squaredRadius{0.0f};
+        for (auto& vertex : m_vertices)
+        {
+            auto offset = vertex.position - m_boundingSphereCenter;
+            squaredRadius = std::max(squaredRadius, glm::dot(offset, offset));
+        }
+        m_boundingSphereRadius = std::sqrt(squaredRadius);
+    }
+
 } // namespace comet
\ No newline at end of file
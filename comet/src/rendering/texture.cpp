@@ -3,9 +3,22 @@
 #include <comet/graphicApiConfig.h>
 #include <platforms/opengl/openglTexture.h>
 
+#include <algorithm>
+
 namespace comet
 {
 
+    uint32_t Texture::getMipLevelCount(uint32_t width, uint32_t height)
+    {
+        uint32_t levelCount = 1;
+        for (auto size = std::max(width, height); size > 1; size /= 2)
+        {
+            levelCount++;
+        }
+
+        return levelCount;
+    }
+
     std::unique_ptr<Texture2D> Texture2D::create(uint32_t textureId)
     {
         switch (GraphicApiConfig::getApiImpl())
@@ -42,4 +55,16 @@ namespace comet
         return std::unique_ptr<OpenglTexture2DArray>(nullptr);
     }
 
+    std::unique_ptr<Texture2DArrayPool> Texture2DArrayPool::create()
+    {
+        switch (GraphicApiConfig::getApiImpl())
+        {
+            case GraphicApiConfig::API::OPENGL:
+                return std::make_unique<OpenglTexture2DArrayPool>();
+        }
+        
+        ASSERT(false, "Graphic API not supported for now!");
+        return std::unique_ptr<OpenglTexture2DArrayPool>(nullptr);
+    }
+
 } // namespace comet
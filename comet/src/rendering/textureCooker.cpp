@@ -0,0 +1,64 @@
+#include <comet/textureCooker.h>
+#include <comet/resourceManager.h>
+#include <comet/log.h>
+#include <rendering/textureImage.h>
+#include <rendering/bcEncoder.h>
+
+namespace comet
+{
+
+    std::string TextureCooker::getCookedFilepath(const std::string& sourceFilepath)
+    {
+        return fs::path(sourceFilepath).replace_extension(".dds").string();
+    }
+
+    bool TextureCooker::cook(const std::string& filename, TextureFormat format /*= TextureFormat::BC1*/)
+    {
+        if (format != TextureFormat::BC1 && format != TextureFormat::BC3)
+        {
+            CM_CORE_LOG_ERROR("Textures can only be cooked to BC1 or BC3 (check file {})", filename);
+            return false;
+        }
+
+        auto sourceFilepath = ResourceManager::getInstance().getResourcePath(ResourceType::TEXTURE, filename.c_str()).string();
+        auto source = DecodedImage::decode(sourceFilepath, true, false);
+        if (!source.isValid() || source.format != TextureFormat::RGBA8)
+        {
+            CM_CORE_LOG_ERROR("Failed cooking texture file {}: the source can't be decoded", sourceFilepath);
+            return false;
+        }
+
+        // All the levels are compressed in a single buffer, in the same order as the source
+        DecodedImage cooked;
+        cooked.format = format;
+        cooked.width = source.width;
+        cooked.height = source.height;
+
+        size_t cookedSize = 0;
+        for (const auto& level : source.levels)
+        {
+            cookedSize += getTextureFormatLevelSize(format, level.width, level.height);
+        }
+        cooked.levelsData.resize(cookedSize);
+
+        auto pCooked = cooked.levelsData.data();
+        for (const auto& level : source.levels)
+        {
+            auto levelSize = getTextureFormatLevelSize(format, level.width, level.height);
+            encodeBCImage(format, level.data, level.width, level.height, pCooked);
+            cooked.levels.push_back({level.width, level.height, pCooked, levelSize});
+            pCooked += levelSize;
+        }
+
+        auto cookedFilepath = getCookedFilepath(sourceFilepath);
+        if (!cooked.saveDDS(cookedFilepath))
+        {
+            CM_CORE_LOG_ERROR("Failed writing cooked texture file {}", cookedFilepath);
+            return false;
+        }
+
+        CM_CORE_LOG_INFO("Texture {} cooked to {}: {} levels, {} KB", sourceFilepath, cookedFilepath, cooked.levels.size(), cookedSize / 1024);
+        return true;
+    }
+
+} // namespace comet
@@ -0,0 +1,553 @@
+#include "textureImage.h"
+
+#include <comet/textureCooker.h>
+#include <comet/log.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <experimental/filesystem>
+#include <fstream>
+
+#include <stb/stb_image.h>
+
+namespace comet
+{
+    namespace fs = std::experimental::filesystem;
+
+    uint32_t getTextureFormatRowHeight(TextureFormat format)
+    {
+        return format == TextureFormat::RGBA8 ? 1 : 4;
+    }
+
+    size_t getTextureFormatRowSize(TextureFormat format, uint32_t width)
+    {
+        switch (format)
+        {
+            case TextureFormat::RGBA8: return static_cast<size_t>(width) * 4;
+            case TextureFormat::BC1: return static_cast<size_t>((width + 3) / 4) * 8;
+            case TextureFormat::BC3:
+            case TextureFormat::BC5:
+            case TextureFormat::BC7: return static_cast<size_t>((width + 3) / 4) * 16;
+        }
+
+        return 0;
+    }
+
+    size_t getTextureFormatLevelSize(TextureFormat format, uint32_t width, uint32_t height)
+    {
+        auto rowHeight = getTextureFormatRowHeight(format);
+        return getTextureFormatRowSize(format, width) * ((height + rowHeight - 1) / rowHeight);
+    }
+
+    void DecodedImage::PixelsDeleter::operator()(uint8_t* pixels) const
+    {
+        stbi_image_free(pixels);
+    }
+
+    // Containers
+    static constexpr uint32_t makeFourCC(char a, char b, char c, char d)
+    {
+        return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+    }
+
+    struct DDSPixelFormat
+    {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t fourCC;
+        uint32_t rgbBitCount;
+        uint32_t bitMasks[4];
+    };
+
+    struct DDSHeader
+    {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t height;
+        uint32_t width;
+        uint32_t pitchOrLinearSize;
+        uint32_t depth;
+        uint32_t mipMapCount;
+        uint32_t reserved1[11];
+        DDSPixelFormat pixelFormat;
+        uint32_t caps[4];
+        uint32_t reserved2;
+    };
+    static_assert(sizeof(DDSHeader) == 124, "DDSHeader must match the DDS file layout");
+
+    struct DDSHeaderDX10
+    {
+        uint32_t dxgiFormat;
+        uint32_t resourceDimension;
+        uint32_t miscFlag;
+        uint32_t arraySize;
+        uint32_t miscFlags2;
+    };
+
+    static constexpr uint32_t DDS_MAGIC = makeFourCC('D', 'D', 'S', ' ');
+    static constexpr uint32_t DDS_FOURCC = 0x4;
+    static constexpr uint32_t DDS_HEADER_FLAGS = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // caps, height, width, pixel format, mip count, linear size
+    static constexpr uint32_t DDS_CAPS_TEXTURE = 0x1000;
+    static constexpr uint32_t DDS_CAPS_MIPMAP = 0x8 | 0x400000; // complex, mipmap
+    static constexpr uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+    static constexpr uint8_t KTX2_IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+    // sRGB variants are read as their UNORM format: the textures are not sampled as sRGB
+    static bool getFormatFromDXGI(uint32_t dxgiFormat, TextureFormat& format)
+    {
+        switch (dxgiFormat)
+        {
+            case 28: case 29: format = TextureFormat::RGBA8; return true;
+            case 71: case 72: format = TextureFormat::BC1; return true;
+            case 77: case 78: format = TextureFormat::BC3; return true;
+            case 83: format = TextureFormat::BC5; return true;
+            case 98: case 99: format = TextureFormat::BC7; return true;
+        }
+
+        return false;
+    }
+
+    static uint32_t getDXGIFormat(TextureFormat format)
+    {
+        switch (format)
+        {
+            case TextureFormat::RGBA8: return 28;
+            case TextureFormat::BC1: return 71;
+            case TextureFormat::BC3: return 77;
+            case TextureFormat::BC5: return 83;
+            case TextureFormat::BC7: return 98;
+        }
+
+        return 0;
+    }
+
+    static bool getFormatFromVulkan(uint32_t vkFormat, TextureFormat& format)
+    {
+        switch (vkFormat)
+        {
+            case 37: case 43: format = TextureFormat::RGBA8; return true;
+            case 131: case 132: case 133: case 134: format = TextureFormat::BC1; return true;
+            case 137: case 138: format = TextureFormat::BC3; return true;
+            case 141: format = TextureFormat::BC5; return true;
+            case 145: case 146: format = TextureFormat::BC7; return true;
+        }
+
+        return false;
+    }
+
+    static bool readFile(const std::string& filepath, std::vector<uint8_t>& content)
+    {
+        std::ifstream ifs(filepath, std::ios::binary | std::ios::ate);
+        if (!ifs)
+        {
+            return false;
+        }
+
+        content.resize(static_cast<size_t>(ifs.tellg()));
+        ifs.seekg(0);
+        return static_cast<bool>(ifs.read(reinterpret_cast<char*>(content.data()), content.size()));
+    }
+
+    // Reverses the first 'rowCount' rows of 4 texels of a BC1 color block: one byte of 2 bits indices per row
+    static void flipBC1Block(uint8_t* block, uint32_t rowCount)
+    {
+        std::reverse(block + 4, block + 4 + rowCount);
+    }
+
+    // Same for a BC4 block (alpha of BC3, channels of BC5): 12 bits of 3 bits indices per row, after the 2 endpoints
+    static void flipBC4Block(uint8_t* block, uint32_t rowCount)
+    {
+        uint64_t indices = 0;
+        for (uint32_t i = 0; i < 6; ++i)
+        {
+            indices |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+        }
+
+        uint64_t flipped = indices;
+        for (uint32_t row = 0; row < rowCount; ++row)
+        {
+            auto shift = 12 * (rowCount - 1 - row);
+            flipped = (flipped & ~(uint64_t{0xFFF} << shift)) | (((indices >> (12 * row)) & 0xFFF) << shift);
+        }
+
+        for (uint32_t i = 0; i < 6; ++i)
+        {
+            block[2 + i] = static_cast<uint8_t>(flipped >> (8 * i));
+        }
+    }
+
+    // The containers store the first row at the top, the textures at the bottom: the order of the rows of blocks is reversed,
+    // then the rows of texels inside each block. Exact when the height is a multiple of 4, or under 4 (the rows of the
+    // partial blocks of the other heights keep their block). The BC7 blocks can't be flipped without decoding them.
+    static void flipLevel(TextureFormat format, uint32_t width, uint32_t height, uint8_t* data)
+    {
+        auto rowSize = getTextureFormatRowSize(format, width);
+        auto rowHeight = getTextureFormatRowHeight(format);
+        auto rowCount = (height + rowHeight - 1) / rowHeight;
+        for (uint32_t row = 0; row < rowCount / 2; ++row)
+        {
+            std::swap_ranges(data + row * rowSize, data + (row + 1) * rowSize, data + (rowCount - 1 - row) * rowSize);
+        }
+
+        auto texelRowCount = std::min(height, rowHeight);
+        auto levelSize = rowSize * rowCount;
+        switch (format)
+        {
+            case TextureFormat::BC1:
+                for (size_t offset = 0; offset < levelSize; offset += 8)
+                {
+                    flipBC1Block(data + offset, texelRowCount);
+                }
+                break;
+            case TextureFormat::BC3:
+                for (size_t offset = 0; offset < levelSize; offset += 16)
+                {
+                    flipBC4Block(data + offset, texelRowCount);
+                    flipBC1Block(data + offset + 8, texelRowCount);
+                }
+                break;
+            case TextureFormat::BC5:
+                for (size_t offset = 0; offset < levelSize; offset += 8)
+                {
+                    flipBC4Block(data + offset, texelRowCount);
+                }
+                break;
+            case TextureFormat::RGBA8:
+            case TextureFormat::BC7:
+                break;
+        }
+    }
+
+    // Level 'level' at 'offset' in the file content, flipped in place. False if the file is too short
+    static bool addLevel(DecodedImage& image, uint32_t level, size_t offset)
+    {
+        auto width = std::max(image.width >> level, 1u);
+        auto height = std::max(image.height >> level, 1u);
+        auto size = getTextureFormatLevelSize(image.format, width, height);
+        if (offset > image.levelsData.size() || size > image.levelsData.size() - offset)
+        {
+            return false;
+        }
+
+        flipLevel(image.format, width, height, image.levelsData.data() + offset);
+        image.levels.push_back({width, height, image.levelsData.data() + offset, size});
+        return true;
+    }
+
+    static DecodedImage readDDS(const std::string& filepath)
+    {
+        DecodedImage image;
+        if (!readFile(filepath, image.levelsData))
+        {
+            return {};
+        }
+
+        auto& content = image.levelsData;
+        uint32_t magic;
+        DDSHeader header;
+        if (content.size() < sizeof(magic) + sizeof(header))
+        {
+            CM_CORE_LOG_ERROR("Invalid DDS file {}", filepath);
+            return {};
+        }
+        memcpy(&magic, content.data(), sizeof(magic));
+        memcpy(&header, content.data() + sizeof(magic), sizeof(header));
+        size_t offset = sizeof(magic) + sizeof(header);
+
+        bool isSupported = magic == DDS_MAGIC && (header.pixelFormat.flags & DDS_FOURCC);
+        if (isSupported)
+        {
+            switch (header.pixelFormat.fourCC)
+            {
+                case makeFourCC('D', 'X', 'T', '1'): image.format = TextureFormat::BC1; break;
+                case makeFourCC('D', 'X', 'T', '4'):
+                case makeFourCC('D', 'X', 'T', '5'): image.format = TextureFormat::BC3; break;
+                case makeFourCC('A', 'T', 'I', '2'):
+                case makeFourCC('B', 'C', '5', 'U'): image.format = TextureFormat::BC5; break;
+                case makeFourCC('D', 'X', '1', '0'):
+                {
+                    DDSHeaderDX10 headerDX10;
+                    isSupported = content.size() >= offset + sizeof(headerDX10);
+                    if (isSupported)
+                    {
+                        memcpy(&headerDX10, content.data() + offset, sizeof(headerDX10));
+                        offset += sizeof(headerDX10);
+                        isSupported = headerDX10.resourceDimension == DDS_DIMENSION_TEXTURE2D &&
+                                      getFormatFromDXGI(headerDX10.dxgiFormat, image.format);
+                    }
+                    break;
+                }
+                default:
+                    isSupported = false;
+            }
+        }
+
+        if (!isSupported)
+        {
+            CM_CORE_LOG_ERROR("Only the BC1, BC3, BC5, BC7 and RGBA8 2D textures are supported in DDS files (check file {})", filepath);
+            return {};
+        }
+        if (image.format == TextureFormat::BC7)
+        {
+            CM_CORE_LOG_WARN("The BC7 blocks are not flipped: the texels of each block stay upside down (check file {})", filepath);
+        }
+
+        if (header.width == 0 || header.height == 0)
+        {
+            CM_CORE_LOG_ERROR("Invalid DDS file {}: empty image", filepath);
+            return {};
+        }
+
+        // Only the first layer (or face) of the file is read, the levels past 1x1 are ignored
+        image.width = header.width;
+        image.height = header.height;
+        auto levelCount = std::clamp(header.mipMapCount, 1u, Texture::getMipLevelCount(image.width, image.height));
+        for (uint32_t level = 0; level < levelCount; ++level)
+        {
+            if (!addLevel(image, level, offset))
+            {
+                CM_CORE_LOG_ERROR("Truncated DDS file {}", filepath);
+                return {};
+            }
+            offset += image.levels.back().size;
+        }
+
+        return image;
+    }
+
+    static DecodedImage readKTX2(const std::string& filepath)
+    {
+        struct KTX2Header
+        {
+            uint8_t identifier[12];
+            uint32_t vkFormat;
+            uint32_t typeSize;
+            uint32_t pixelWidth;
+            uint32_t pixelHeight;
+            uint32_t pixelDepth;
+            uint32_t layerCount;
+            uint32_t faceCount;
+            uint32_t levelCount;
+            uint32_t supercompressionScheme;
+            uint32_t dfdByteOffset;
+            uint32_t dfdByteLength;
+            uint32_t kvdByteOffset;
+            uint32_t kvdByteLength;
+            uint64_t sgdByteOffset;
+            uint64_t sgdByteLength;
+        };
+        static_assert(sizeof(KTX2Header) == 80, "KTX2Header must match the KTX2 file layout");
+
+        struct KTX2Level
+        {
+            uint64_t byteOffset;
+            uint64_t byteLength;
+            uint64_t uncompressedByteLength;
+        };
+
+        DecodedImage image;
+        if (!readFile(filepath, image.levelsData))
+        {
+            return {};
+        }
+
+        auto& content = image.levelsData;
+        KTX2Header header;
+        if (content.size() < sizeof(header))
+        {
+            CM_CORE_LOG_ERROR("Invalid KTX2 file {}", filepath);
+            return {};
+        }
+        memcpy(&header, content.data(), sizeof(header));
+
+        if (memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0 || header.supercompressionScheme != 0 ||
+            header.pixelDepth > 1 || !getFormatFromVulkan(header.vkFormat, image.format))
+        {
+            CM_CORE_LOG_ERROR("Only the BC1, BC3, BC5, BC7 and RGBA8 2D textures without supercompression are supported in KTX2 files (check file {})",
+                              filepath);
+            return {};
+        }
+        if (image.format == TextureFormat::BC7)
+        {
+            CM_CORE_LOG_WARN("The BC7 blocks are not flipped: the texels of each block stay upside down (check file {})", filepath);
+        }
+
+        if (header.pixelWidth == 0 || header.pixelHeight == 0)
+        {
+            CM_CORE_LOG_ERROR("Invalid KTX2 file {}: empty image", filepath);
+            return {};
+        }
+
+        // The levels past 1x1 are ignored
+        image.width = header.pixelWidth;
+        image.height = header.pixelHeight;
+        auto levelCount = std::clamp(header.levelCount, 1u, Texture::getMipLevelCount(image.width, image.height));
+        if (content.size() < sizeof(header) + levelCount * sizeof(KTX2Level))
+        {
+            CM_CORE_LOG_ERROR("Truncated KTX2 file {}", filepath);
+            return {};
+        }
+
+        // The level index starts with level 0, only the first layer (or face) of each level is read
+        for (uint32_t level = 0; level < levelCount; ++level)
+        {
+            KTX2Level levelIndex;
+            memcpy(&levelIndex, content.data() + sizeof(header) + level * sizeof(KTX2Level), sizeof(levelIndex));
+            if (!addLevel(image, level, levelIndex.byteOffset))
+            {
+                CM_CORE_LOG_ERROR("Truncated KTX2 file {}", filepath);
+                return {};
+            }
+        }
+
+        return image;
+    }
+
+    DecodedImage DecodedImage::decode(const std::string& filepath, bool generateMipmaps, bool useCookedFile /*= true*/)
+    {
+        auto imagePath = filepath;
+        if (useCookedFile)
+        {
+            auto cookedFilepath = TextureCooker::getCookedFilepath(filepath);
+            std::error_code error;
+            if (cookedFilepath != filepath && fs::exists(cookedFilepath, error) &&
+                fs::last_write_time(cookedFilepath, error) >= fs::last_write_time(filepath, error))
+            {
+                imagePath = cookedFilepath;
+            }
+        }
+
+        auto extension = fs::path(imagePath).extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (extension == ".dds")
+        {
+            return readDDS(imagePath);
+        }
+        if (extension == ".ktx2")
+        {
+            return readKTX2(imagePath);
+        }
+
+        DecodedImage image;
+
+        // Always expanded to 4 channels: the rows are 4 bytes aligned and all the textures share the same format
+        int width, height, channels;
+        stbi_set_flip_vertically_on_load_thread(1);
+        auto pixels = stbi_load(imagePath.c_str(), &width, &height, &channels, 4);
+        if (pixels)
+        {
+            image.width = width;
+            image.height = height;
+            image.pixels.reset(pixels);
+            image.levels.push_back({image.width, image.height, pixels, getTextureFormatLevelSize(TextureFormat::RGBA8, width, height)});
+
+            if (generateMipmaps)
+            {
+                image.generateMipmaps();
+            }
+        }
+
+        return image;
+    }
+
+    // 2x2 box filter of the previous level (the last row or column is repeated for odd sizes)
+    void DecodedImage::generateMipmaps()
+    {
+        if (format != TextureFormat::RGBA8 || levels.size() != 1)
+        {
+            return;
+        }
+
+        auto levelCount = Texture::getMipLevelCount(width, height);
+
+        size_t mipmapSize = 0;
+        for (uint32_t level = 1; level < levelCount; ++level)
+        {
+            mipmapSize += getTextureFormatLevelSize(format, std::max(width >> level, 1u), std::max(height >> level, 1u));
+        }
+        levelsData.resize(mipmapSize);
+
+        auto pDestination = levelsData.data();
+        for (uint32_t level = 1; level < levelCount; ++level)
+        {
+            const auto source = levels.back();
+            Level destination{std::max(source.width / 2, 1u), std::max(source.height / 2, 1u), pDestination};
+            destination.size = getTextureFormatLevelSize(format, destination.width, destination.height);
+
+            for (uint32_t y = 0; y < destination.height; ++y)
+            {
+                auto row0 = source.data + static_cast<size_t>(std::min(2 * y, source.height - 1)) * source.width * 4;
+                auto row1 = source.data + static_cast<size_t>(std::min(2 * y + 1, source.height - 1)) * source.width * 4;
+                for (uint32_t x = 0; x < destination.width; ++x)
+                {
+                    auto column0 = std::min(2 * x, source.width - 1) * 4;
+                    auto column1 = std::min(2 * x + 1, source.width - 1) * 4;
+                    for (uint32_t channel = 0; channel < 4; ++channel)
+                    {
+                        uint32_t sum = row0[column0 + channel] + row0[column1 + channel] + row1[column0 + channel] + row1[column1 + channel];
+                        *pDestination++ = static_cast<uint8_t>((sum + 2) / 4);
+                    }
+                }
+            }
+
+            levels.push_back(destination);
+        }
+    }
+
+    bool DecodedImage::saveDDS(const std::string& filepath) const
+    {
+        if (!isValid())
+        {
+            return false;
+        }
+
+        DDSHeader header{};
+        header.size = sizeof(DDSHeader);
+        header.flags = DDS_HEADER_FLAGS;
+        header.width = width;
+        header.height = height;
+        header.pitchOrLinearSize = static_cast<uint32_t>(levels.front().size);
+        header.mipMapCount = static_cast<uint32_t>(levels.size());
+        header.pixelFormat.size = sizeof(DDSPixelFormat);
+        header.pixelFormat.flags = DDS_FOURCC;
+        header.caps[0] = DDS_CAPS_TEXTURE | (levels.size() > 1 ? DDS_CAPS_MIPMAP : 0);
+
+        // Legacy FourCC when there is one, the other formats need the DX10 header
+        DDSHeaderDX10 headerDX10{getDXGIFormat(format), DDS_DIMENSION_TEXTURE2D, 0, 1, 0};
+        bool writeHeaderDX10{false};
+        switch (format)
+        {
+            case TextureFormat::BC1: header.pixelFormat.fourCC = makeFourCC('D', 'X', 'T', '1'); break;
+            case TextureFormat::BC3: header.pixelFormat.fourCC = makeFourCC('D', 'X', 'T', '5'); break;
+            default:
+                header.pixelFormat.fourCC = makeFourCC('D', 'X', '1', '0');
+                writeHeaderDX10 = true;
+        }
+
+        std::ofstream ofs(filepath, std::ios::binary);
+        if (!ofs)
+        {
+            return false;
+        }
+
+        ofs.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (writeHeaderDX10)
+        {
+            ofs.write(reinterpret_cast<const char*>(&headerDX10), sizeof(headerDX10));
+        }
+        // Written top-down, like the files of the other tools
+        std::vector<uint8_t> flippedLevel;
+        for (const auto& level : levels)
+        {
+            flippedLevel.assign(level.data, level.data + level.size);
+            flipLevel(format, level.width, level.height, flippedLevel.data());
+            ofs.write(reinterpret_cast<const char*>(flippedLevel.data()), flippedLevel.size());
+        }
+
+        return static_cast<bool>(ofs);
+    }
+
+} // namespace comet
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <comet/texture.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace comet
+{
+
+    // Rows of pixels, or rows of blocks for the compressed formats (4 rows of pixels each)
+    uint32_t getTextureFormatRowHeight(TextureFormat format);
+    size_t getTextureFormatRowSize(TextureFormat format, uint32_t width);
+    size_t getTextureFormatLevelSize(TextureFormat format, uint32_t width, uint32_t height);
+
+    // Image decoded on a worker thread, first row at the bottom.
+    // The images decoded by stb_image are RGBA8, their mip levels are box filtered when requested.
+    // The images read from a DDS or KTX2 container keep their format and the levels stored in the file, flipped on load.
+    struct DecodedImage
+    {
+        struct PixelsDeleter
+        {
+            void operator()(uint8_t* pixels) const;
+        };
+
+        struct Level
+        {
+            uint32_t width{0};
+            uint32_t height{0};
+            const uint8_t* data{nullptr};
+            size_t size{0};
+        };
+
+        TextureFormat format{TextureFormat::RGBA8};
+        uint32_t width{0};
+        uint32_t height{0};
+        // Level 0 of the images decoded by stb_image
+        std::unique_ptr<uint8_t, PixelsDeleter> pixels;
+        // The next levels, or the whole container file
+        std::vector<uint8_t> levelsData;
+        std::vector<Level> levels;
+
+        bool isValid() const { return !levels.empty(); }
+
+        // With 'useCookedFile', the file cooked next to the source (see TextureCooker) is read instead when it is up to date
+        static DecodedImage decode(const std::string& filepath, bool generateMipmaps, bool useCookedFile = true);
+
+        // Full chain of an RGBA8 image, from its level 0
+        void generateMipmaps();
+
+        // DDS container, flipped back to the first row at the top
+        bool saveDDS(const std::string& filepath) const;
+    };
+
+} // namespace comet
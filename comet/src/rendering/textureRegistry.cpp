@@ -1,16 +1,26 @@
 #include <comet/textureRegistry.h>
+#include <comet/textureResidencyManager.h>
 
 namespace comet
 {
     
-    Texture2D* TextureRegistry::getTexture2D(const std::string& filepath)
+    // The textures unregister from the residency manager when they are deleted: it must be destroyed after the registry
+    TextureRegistry::TextureRegistry()
     {
-        if (m_texture2DRegistry.find(filepath) == m_texture2DRegistry.end())
+        TextureResidencyManager::getInstance();
+    }
+
+    Texture2DHandle TextureRegistry::getTexture2D(const std::string& filepath)
+    {
+        if (auto texture = m_texture2DRegistry[filepath].lock())
         {
-            m_texture2DRegistry[filepath] = Texture2D::create(filepath.c_str());
+            return texture;
         }
 
-        return m_texture2DRegistry[filepath].get();
+        Texture2DHandle texture = Texture2D::create(filepath.c_str());
+        m_texture2DRegistry[filepath] = texture;
+
+        return texture;
     }
 
     Texture2D* TextureRegistry::getWhiteTexture2D()
@@ -35,4 +45,14 @@ namespace comet
         return m_texture2DArrayRegistry[uniqueName].get();
     }
 
+    Texture2DArrayPool* TextureRegistry::getTexture2DArrayPool(const std::string& uniqueName)
+    {
+        if (m_texture2DArrayPoolRegistry.find(uniqueName) == m_texture2DArrayPoolRegistry.end())
+        {
+            m_texture2DArrayPoolRegistry[uniqueName] = Texture2DArrayPool::create();
+        }
+
+        return m_texture2DArrayPoolRegistry[uniqueName].get();
+    }
+
 } // namespace comet
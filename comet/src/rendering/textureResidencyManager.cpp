@@ -0,0 +1,125 @@
+#include <comet/textureResidencyManager.h>
+#include <comet/log.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace comet
+{
+
+    // A texture registered now has a full frame to be used before it can be evicted
+    void TextureResidencyManager::registerTexture(ResidentTexture* texture)
+    {
+        m_textures[texture] = {texture, m_frame};
+    }
+
+    void TextureResidencyManager::unregisterTexture(const ResidentTexture* texture)
+    {
+        m_textures.erase(texture);
+    }
+
+    void TextureResidencyManager::markUsed(const ResidentTexture* texture)
+    {
+        if (auto it = m_textures.find(texture); it != m_textures.end())
+        {
+            it->second.lastUsedFrame = m_frame;
+        }
+    }
+
+    void TextureResidencyManager::update()
+    {
+        // The textures used during the last frame are streamed back first, the budget is made on the other ones
+        size_t residentBytes{0};
+        for (auto& [key, entry] : m_textures)
+        {
+            if (entry.lastUsedFrame == m_frame && (entry.texture->isEvicted() || entry.texture->getDroppedLevelCount()))
+            {
+                entry.texture->restore();
+            }
+            residentBytes += entry.texture->getResidentSize();
+        }
+
+        if (residentBytes > m_budget)
+        {
+            enforceBudget(residentBytes);
+        }
+        else
+        {
+            m_overBudgetReported = false;
+        }
+
+        m_statistics = {};
+        m_statistics.budget = m_budget;
+        for (auto& [key, entry] : m_textures)
+        {
+            if (entry.texture->isEvicted())
+            {
+                m_statistics.evictedTexturesCount++;
+                continue;
+            }
+
+            m_statistics.residentBytes += entry.texture->getResidentSize();
+            m_statistics.residentTexturesCount++;
+            if (entry.texture->getDroppedLevelCount())
+            {
+                m_statistics.reducedTexturesCount++;
+            }
+        }
+
+        m_frame++;
+    }
+
+    void TextureResidencyManager::enforceBudget(size_t residentBytes)
+    {
+        std::vector<Entry> candidates;
+        for (auto& [key, entry] : m_textures)
+        {
+            if (entry.lastUsedFrame < m_frame && !entry.texture->isEvicted())
+            {
+                candidates.push_back(entry);
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [](const Entry& a, const Entry& b)
+        {
+            return a.lastUsedFrame < b.lastUsedFrame;
+        });
+
+        // Dropping the top level frees 3/4 of a texture and keeps it sampled: all the candidates are reduced before any eviction
+        for (auto& candidate : candidates)
+        {
+            while (residentBytes > m_budget)
+            {
+                auto size = candidate.texture->getResidentSize();
+                if (!candidate.texture->dropTopLevel(MIN_TOP_LEVEL_SIZE))
+                {
+                    break;
+                }
+                residentBytes -= size - candidate.texture->getResidentSize();
+            }
+        }
+
+        for (auto& candidate : candidates)
+        {
+            if (residentBytes <= m_budget)
+            {
+                break;
+            }
+
+            auto size = candidate.texture->getResidentSize();
+            if (candidate.texture->evict())
+            {
+                residentBytes -= size;
+            }
+        }
+
+        // The textures used by the frame don't fit: reported once, until the memory is back under budget
+        if (residentBytes > m_budget && !m_overBudgetReported)
+        {
+            CM_CORE_LOG_WARN("Texture memory over budget: {} MB resident for a {} MB budget",
+                             residentBytes / (1024 * 1024), m_budget / (1024 * 1024));
+            m_overBudgetReported = true;
+        }
+    }
+
+} // namespace comet
@@ -0,0 +1,21 @@
+#include <rendering/uniformBuffer.h>
+#include <comet/assert.h>
+#include <comet/graphicApiConfig.h>
+#include <platforms/opengl/openglUniformBuffer.h>
+
+namespace comet
+{
+
+    std::unique_ptr<UniformBuffer> UniformBuffer::create(uint32_t usage)
+    {
+        switch (GraphicApiConfig::getApiImpl())
+        {
+            case GraphicApiConfig::API::OPENGL:
+                return std::make_unique<OpenglUniformBuffer>(usage);
+        }
+        
+        ASSERT(false, "Graphic API not supported for now!");
+        return std::unique_ptr<OpenglUniformBuffer>(nullptr);
+    }
+
+}
\ No newline at end of file
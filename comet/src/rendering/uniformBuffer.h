@@ -0,0 +1,19 @@
+#pragma once
+
+#include <rendering/buffer.h>
+
+#include <memory>
+
+namespace comet
+{
+    class UniformBuffer : public Buffer
+    {
+    public:
+        virtual ~UniformBuffer() {};
+
+        // Bind [offset, offset + size[ of the buffer to a uniform block binding point (whole buffer when size is 0)
+        virtual void bindUniform(uint32_t bindingIndex, size_t offset = 0, size_t size = 0) const = 0;
+
+        static std::unique_ptr<UniformBuffer> create(uint32_t usage);
+    };
+}
\ No newline at end of file
@@ -12,6 +12,16 @@ namespace comet
 
         virtual void loadDataInMappedMemory(const void* data, size_t size, uint32_t count, uint32_t offset = 0) = 0;
 
+        // Streaming mode: persistently mapped storage split in 'regionCount' frame regions
+        // of the size defined by setSize(). Each frame writes in its own region (ring buffer)
+        // and the region is reused only once the GPU has consumed it (fence).
+        virtual void allocateStreaming(uint32_t regionCount) = 0;
+        virtual void* acquireRegion() = 0;
+        virtual void fenceRegion() = 0;
+        virtual bool isStreaming() const = 0;
+        virtual uint32_t getRegionIndex() const = 0;
+        virtual uint32_t getRegionCount() const = 0;
+
         static std::unique_ptr<VertexBuffer> create(uint32_t usage);
     };
 }
\ No newline at end of file
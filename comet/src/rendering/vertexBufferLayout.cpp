@@ -18,4 +18,26 @@ namespace comet
         return std::unique_ptr<OpenglVertexBufferLayout>(nullptr);
     }
 
+    uint64_t VertexBufferLayout::getHash() const
+    {
+        // FNV-1a over the attributes fields
+        uint64_t hash = 14695981039346656037ull;
+        auto combine = [&hash](uint32_t value)
+        {
+            hash = (hash ^ value) * 1099511628211ull;
+        };
+
+        combine(getStride());
+        for (const auto& attr : getAttributes())
+        {
+            combine(attr.loc);
+            combine(attr.type);
+            combine(attr.count);
+            combine(attr.divisor);
+            combine(attr.normalized);
+        }
+
+        return hash;
+    }
+
 } // namespace comet
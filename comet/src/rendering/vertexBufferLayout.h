@@ -35,6 +35,12 @@ namespace comet
         virtual void addFloat(uint32_t count, bool normalized, uint32_t loc, uint32_t divisor = 0) = 0;
         virtual void addUInt(uint32_t count, bool normalized, uint32_t loc, uint32_t divisor = 0) = 0;
         virtual void addInt(uint32_t count, bool normalized, uint32_t loc, uint32_t divisor = 0) = 0;
+        // Normalized shorts are read as floats in [-1, 1], the other ones as integers
+        virtual void addShort(uint32_t count, bool normalized, uint32_t loc, uint32_t divisor = 0) = 0;
+        virtual void addHalf(uint32_t count, uint32_t loc, uint32_t divisor = 0) = 0;
+
+        // Identifies the attributes formats of the layout
+        uint64_t getHash() const;
     };
 
 } // namespace comet
@@ -0,0 +1,41 @@
+#include "vertexFormat.h"
+#include <comet/assert.h>
+#include <comet/graphicApiConfig.h>
+#include <platforms/opengl/openglVertexFormat.h>
+
+namespace comet
+{
+
+    std::unique_ptr<VertexFormat> VertexFormat::create(const std::vector<const VertexBufferLayout*>& layouts)
+    {
+        switch (GraphicApiConfig::getApiImpl())
+        {
+            case GraphicApiConfig::API::OPENGL:
+                return std::make_unique<OpenglVertexFormat>(layouts);
+        }
+
+        ASSERT(false, "Graphic API not supported for now!");
+        return std::unique_ptr<OpenglVertexFormat>(nullptr);
+    }
+
+    VertexFormat* VertexFormatRegistry::getVertexFormat(const std::vector<const VertexBufferLayout*>& layouts)
+    {
+        // The binding point of each layout is part of the format
+        uint64_t hash = 14695981039346656037ull;
+        for (auto layout : layouts)
+        {
+            hash = (hash ^ layout->getHash()) * 1099511628211ull;
+        }
+
+        auto& vertexFormat = m_vertexFormats[hash];
+        if (!vertexFormat)
+        {
+            CM_CORE_LOG_DEBUG("New vertex format: {} layouts, hash = {}", layouts.size(), hash);
+            vertexFormat = VertexFormat::create(layouts);
+            vertexFormat->m_sortId = static_cast<uint16_t>(m_vertexFormats.size() - 1);
+        }
+
+        return vertexFormat.get();
+    }
+
+} // namespace comet
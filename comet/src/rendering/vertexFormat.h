@@ -0,0 +1,55 @@
+#pragma once
+
+#include <comet/singleton.h>
+#include <rendering/vertexBufferLayout.h>
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace comet
+{
+    class Buffer;
+
+    // Vertex attributes formats of a list of buffer layouts, independent of the buffers that are read.
+    // The layout i is read from the buffer binding point i: the buffers are attached when drawing,
+    // so every draw using the same layouts shares the same format (and vertex array).
+    class VertexFormat
+    {
+        friend class VertexFormatRegistry;
+
+    public:
+        VertexFormat() = default;
+        virtual ~VertexFormat() {};
+
+        static std::unique_ptr<VertexFormat> create(const std::vector<const VertexBufferLayout*>& layouts);
+
+        VertexFormat(const VertexFormat&) = delete;
+        void operator=(const VertexFormat&) = delete;
+
+        virtual void bind() const = 0;
+        virtual void unbind() const = 0;
+
+        // Attach the buffers read by the format, only the ones that changed are attached again
+        virtual void bindVertexBuffer(uint32_t bindingIndex, const Buffer& vbo) const = 0;
+        virtual void bindIndexBuffer(const Buffer& ibo) const = 0;
+
+        // Registration order, used to group the draws by vertex array
+        uint16_t getSortId() const { return m_sortId; }
+
+    private:
+        uint16_t m_sortId{0};
+    };
+
+    // Formats shared by layout hash
+    class VertexFormatRegistry : public Singleton<VertexFormatRegistry>
+    {
+    public:
+        VertexFormat* getVertexFormat(const std::vector<const VertexBufferLayout*>& layouts);
+
+    private:
+        std::unordered_map<uint64_t, std::unique_ptr<VertexFormat>> m_vertexFormats;
+    };
+
+} // namespace comet
@@ -3,6 +3,7 @@
 #include <core/imguiWrapper.h>
 #include <core/sceneSerializer.h>
 #include <core/imguiUtils.h>
+#include <platforms/opengl/openglStateCache.h>
 
 namespace comet
 {
@@ -231,6 +232,24 @@ namespace comet
         ImGui::Text("Entities: %d", stats.entitiesCount);
         ImGui::Text("Vertices: %d / Indices: %d", stats.verticesCount, stats.indicesCount);
         ImGui::Text("Draw calls: %d / Draw commands: %d", stats.drawCalls, stats.drawCommandsCount);
+        ImGui::Text("Updated instances: %d", stats.updatedInstancesCount);
+        ImGui::Text("State calls: %d issued / %d skipped", stats.issuedStateCalls, stats.skippedStateCalls);
+        ImGui::Text("Textures: %d resident (%d reduced) / %d evicted", stats.residentTexturesCount,
+                    stats.reducedTexturesCount, stats.evictedTexturesCount);
+        ImGui::Text("Texture memory: %.1f / %.1f MB", stats.textureResidentBytes / (1024.0f * 1024.0f),
+                    stats.textureBudgetBytes / (1024.0f * 1024.0f));
+        if (stats.visibleInstancesCount || stats.culledInstancesCount)
+        {
+            ImGui::Text("CPU culling: %d visible / %d culled (%.2f ns/instance)",
+                        stats.visibleInstancesCount, stats.culledInstancesCount, stats.cullingNsPerInstance);
+        }
+
+        // Editor viewport pass
+        auto& renderPasses = m_editorScene.getRenderPasses();
+        if (!renderPasses.empty())
+        {
+            ImGui::Checkbox("Depth pre-pass", &renderPasses.front()->getSpec().depthPrePass);
+        }
 
         ImGui::End();
     }
@@ -258,6 +277,10 @@ namespace comet
         if (m_imguiWrapper)
         {
             m_imguiWrapper->render();
+
+            // The ImGui backend calls OpenGL directly and doesn't restore everything it binds
+            // (buffers, texture units, viewport windows contexts): the cached state is stale
+            OpenglStateCache::getInstance().invalidate();
         }
     }
 }
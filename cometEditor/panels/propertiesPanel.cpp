@@ -56,7 +56,6 @@ namespace comet
                         {
                             auto meshHandler = ResourceManager::getInstance().loadStaticMesh(predefineMesh.second);
                             selectedEntity.addComponent<MeshComponent>(meshHandler.resourceId);
-                            activeScene.reload();
                         }
                     }
                     ImGui::EndMenu();
@@ -82,7 +81,6 @@ namespace comet
                             if (ImGui::MenuItem(materialInstance->getName().c_str()))
                             {
                                 selectedEntity.addComponent<MaterialComponent>(materialInstance->getInstanceId());
-                                activeScene.reload();
                             }
                         }
                         ImGui::EndMenu();
@@ -99,7 +97,6 @@ namespace comet
                         newMaterialInstance->setShininess(1.1f);
 
                         selectedEntity.addComponent<MaterialComponent>(newMaterialInstance->getInstanceId());
-                        activeScene.reload();
                     }
 
                     ImGui::EndMenu();
@@ -223,7 +220,8 @@ namespace comet
             {
                 static constexpr float firstColWidth = 120.0f;
                 ImGui::TableSetupColumn("", ImGuiTableColumnFlags_WidthFixed, firstColWidth);
-                auto& transformComponent = entity.getComponent<TransformComponent>();
+                // Edit a copy, so that the renderer is only notified of actual changes
+                auto transformComponent = entity.getComponent<TransformComponent>();
                 
                 auto& translation = transformComponent.translation;
                 drawVec3("Translation", translation, firstColWidth);
@@ -239,6 +237,14 @@ namespace comet
 
                 auto& scale = transformComponent.scale;
                 drawVec3("Scale", scale, firstColWidth, 1.0f);
+
+                auto& currentTransform = entity.getComponent<TransformComponent>();
+                if (currentTransform.translation != translation || currentTransform.rotation != rotation || currentTransform.scale != scale)
+                {
+                    entity.patchComponent<TransformComponent>([&transformComponent](auto& transform) {
+                        transform = transformComponent;
+                    });
+                }
             }
             ImGui::EndTable();
         }
@@ -265,7 +271,6 @@ namespace comet
         if (clicked)
         {
             entity.removeComponent<T>();
-            entity.getScene()->reload();
             ImGui::PopID();
             return;
         }
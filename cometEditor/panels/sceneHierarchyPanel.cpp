@@ -86,7 +86,6 @@ namespace comet
                     if (activeScene)
                     {
                         activeScene->destroyEntity(entity);
-                        activeScene->reload();
                     }
                 }
                 ImGui::PopID();
@@ -17,9 +17,10 @@ public:
 
     virtual void onUpdate(Entity& entity, double deltaTime) override
     {
-        auto& transformComponent = getComponent<TransformComponent>(entity);
         float angle = 0.001f * deltaTime;
-        transformComponent.rotation.x += angle;
+        patchComponent<TransformComponent>(entity, [angle](auto& transformComponent) {
+            transformComponent.rotation.x += angle;
+        });
     }
 };
 
@@ -36,8 +36,9 @@ public:
 
     virtual void onUpdate(Entity& entity, double deltaTime) override
     {
-        auto& transformComponent = getComponent<TransformComponent>(entity);
-        transformComponent.rotation += m_rotation * (float)(m_speed * deltaTime);
+        patchComponent<TransformComponent>(entity, [&](auto& transformComponent) {
+            transformComponent.rotation += m_rotation * (float)(m_speed * deltaTime);
+        });
     }
 
     const float& getSpeed() const { return m_speed; }
@@ -77,9 +78,10 @@ public:
 
     virtual void onUpdate(Entity& entity, double deltaTime) override
     {
-        auto& transformComponent = getComponent<TransformComponent>(entity);
         m_delta += m_speed * deltaTime;
-        transformComponent.translation += m_translation * (float)(glm::cos(m_delta));
+        patchComponent<TransformComponent>(entity, [&](auto& transformComponent) {
+            transformComponent.translation += m_translation * (float)(glm::cos(m_delta));
+        });
     }
 
     const float& getSpeed() const { return m_speed; }